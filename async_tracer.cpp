@@ -0,0 +1,103 @@
+#include "async_tracer.h"
+#include <cstdint>
+
+/**
+* Sets up the replaying hart the way rv32i-trace does and starts the
+* rendering thread.
+*
+* @param mem_size is the size of the memory of the simulated hart.
+* @param entry is the address execution starts at.
+* @param compressed tells that the C extension is on.
+* @param insns is where to render the instructions, like -i, or nullptr.
+* @param dumps is where to render the registers before each, like -r,
+* or nullptr.
+* @param warnings is where the memory warns, or nullptr.
+***********************************************************************/
+template<uint32_t XLEN>
+async_tracer<XLEN>::async_tracer(uint64_t mem_size, uint32_t entry, bool compressed, std::ostream *insns,
+	std::ostream *dumps, std::ostream *warnings)
+	: mem(mem_size, true), hart(&mem)
+{
+	mem.set_warnings(warnings);
+	hart.set_output(insns);
+	hart.set_dump_output(dumps);
+	hart.set_entry(entry);
+	hart.set_compressed(compressed);
+	hart.set_show_instructions(insns != nullptr);
+	hart.set_show_registers(dumps != nullptr);
+	hart.start_replay();
+
+	synced = 0;
+	syncs = 0;
+	stop = false;
+	worker = std::thread(&async_tracer<XLEN>::render, this);
+}
+
+/**
+* Stops the rendering thread. Records that were not followed by sync()
+* are dropped.
+***********************************************************************/
+template<uint32_t XLEN>
+async_tracer<XLEN>::~async_tracer()
+{
+	stop = true;
+	ring.wake();
+	worker.join();
+}
+
+/**
+* Waits until everything recorded so far is rendered into the streams,
+* so that the caller can print after it. Called by the simulating
+* thread only.
+*
+* @param insn_count is the number of instructions executed.
+***********************************************************************/
+template<uint32_t XLEN>
+void async_tracer<XLEN>::sync(uint64_t insn_count)
+{
+	ring.record_end(insn_count);
+	++syncs;
+	while(synced.load(std::memory_order_acquire) != syncs)
+		std::this_thread::yield();
+}
+
+/**
+* The body of the rendering thread: replays the records as they come
+* and tells sync() at every trace_end record. When the ring stays empty
+* for spin_limit polls (the guest is blocked in a system call, or the
+* simulation is between runs) the thread parks in trace_ring::wait()
+* rather than keep a host core busy.
+***********************************************************************/
+template<uint32_t XLEN>
+void async_tracer<XLEN>::render()
+{
+	trace_record r;
+	uint32_t spins = 0;
+
+	while(!stop.load(std::memory_order_relaxed))
+	{
+		if(!ring.pop(r))
+		{
+			if(++spins < spin_limit)
+				std::this_thread::yield();
+			else
+			{
+				ring.wait();
+				spins = 0;
+			}
+			continue;
+		}
+		spins = 0;
+
+		if(r.flags & trace_record::trace_end)
+		{
+			synced.fetch_add(1, std::memory_order_release);
+			continue;
+		}
+
+		hart.replay(r);
+	}
+}
+
+template class async_tracer<32>;
+template class async_tracer<64>;
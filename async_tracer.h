@@ -0,0 +1,65 @@
+#ifndef async_tracer_H
+#define async_tracer_H
+
+#include <cstdint>
+#include <atomic>
+#include <ostream>
+#include <thread>
+#include "memory.h"
+#include "rv32i.h"
+#include "trace.h"
+
+/*
+* The documentation of most of the functions is included in the .cpp file.
+*/
+
+/**
+* Renders the text of -i and -r on a thread of its own. The simulating
+* hart only pushes the record of every instruction into a trace_ring,
+* the same record the binary trace of -t holds. The thread replays the
+* records on a hart and a sparse memory of its own, like rv32i-trace,
+* and renders the text into the given streams (sinks, which write it
+* out in large batches.) The text is the same as that of a traced run,
+* the warnings of the memory included, so the memory of the simulating
+* hart must be kept quiet while it runs, and nothing else may write to
+* the streams until sync() has returned. XLEN is that of the harts.
+***********************************************************************/
+template<uint32_t XLEN>
+class async_tracer
+{
+public:
+	async_tracer(uint64_t mem_size, uint32_t entry, bool compressed, std::ostream *insns,
+		std::ostream *dumps, std::ostream *warnings);
+	~async_tracer();
+
+	/**
+	* @return the ring the simulating hart records into.
+	***************************************************************/
+	trace_ring &get_ring()
+	{
+		return ring;
+	}
+
+	void sync(uint64_t insn_count);
+
+private:
+	async_tracer(const async_tracer &) = delete;
+	async_tracer &operator=(const async_tracer &) = delete;
+
+	void render();
+
+	static constexpr uint32_t spin_limit = 256;	// empty polls before the thread parks
+
+	trace_ring ring;
+	memory mem;			// the memory of the replaying hart
+	rv_hart<XLEN> hart;		// the replaying hart
+	std::atomic<uint64_t> synced;	// trace_end records rendered
+	uint64_t syncs;			// trace_end records sent
+	std::atomic<bool> stop;
+	std::thread worker;
+};
+
+extern template class async_tracer<32>;
+extern template class async_tracer<64>;
+
+#endif
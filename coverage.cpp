@@ -0,0 +1,84 @@
+#include "coverage.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/shm.h>
+
+/**
+* Allocates a private map with all the counters at zero.
+***********************************************************************/
+coverage::coverage()
+{
+	map = new uint8_t[map_size];
+	memset(map, 0, map_size);
+	shared = false;
+}
+
+/**
+* Frees or detaches the map.
+***********************************************************************/
+coverage::~coverage()
+{
+	if(shared)
+		shmdt(map);
+	else
+		delete[] map;
+}
+
+/**
+* Replaces the map with the shared memory segment shm_id, the way an
+* AFL-style fuzzer passes its bitmap in __AFL_SHM_ID. The counters of
+* the segment are left as they are, clearing them is up to the owner.
+*
+* @param shm_id is the id of the segment, at least map_size bytes.
+*
+* @return false (keeping the private map) if it can not be attached.
+***********************************************************************/
+bool coverage::attach(int shm_id)
+{
+	void *p = shmat(shm_id, nullptr, 0);
+	if(p == reinterpret_cast<void *>(-1))
+	{
+		std::cerr << "Can\'t attach shared memory segment " << shm_id << ".\n";
+		return false;
+	}
+
+	if(shared)
+		shmdt(map);
+	else
+		delete[] map;
+	map = static_cast<uint8_t *>(p);
+	shared = true;
+	return true;
+}
+
+/**
+* Writes the map_size counters to the file named fname.
+*
+* @param fname is the name of the file.
+*
+* @return false if the file can not be written.
+***********************************************************************/
+bool coverage::save(const std::string &fname) const
+{
+	std::ofstream out(fname, std::ios::out | std::ios::binary);
+	if(out)
+		out.write(reinterpret_cast<const char *>(map), map_size);
+	if(!out)
+	{
+		std::cerr << "Can\'t open file \'" << fname << "\' for writing.\n";
+		return false;
+	}
+	return true;
+}
+
+/**
+* Accessor for the map.
+*
+* @return the map_size counters.
+***********************************************************************/
+uint8_t *coverage::get_map() const
+{
+	return map;
+}
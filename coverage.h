@@ -0,0 +1,52 @@
+#ifndef coverage_H
+#define coverage_H
+
+#include <cstdint>
+#include <string>
+
+/*
+* The documentation of most of the functions is included in the .cpp file.
+*/
+
+/**
+* An AFL-style edge coverage bitmap. Every taken branch and jump counts
+* its (from, to) edge in one byte of the map, found by hashing the two
+* addresses. The counters wrap around like AFL's. The map is either
+* private or a System V shared memory segment handed over by a fuzzer.
+***********************************************************************/
+class coverage
+{
+public:
+	static constexpr uint32_t map_size = 1 << 16;	// AFL's MAP_SIZE
+
+	coverage();
+	~coverage();
+
+	bool attach(int shm_id);
+	bool save(const std::string &fname) const;
+
+	uint8_t *get_map() const;
+
+	/**
+	* Hashes an edge to its counter. Two different multipliers keep
+	* the edges a->b and b->a apart.
+	*
+	* @param from is the address of the branch or jump
+	* @param to is the address it went to
+	*
+	* @return the index of the counter of the edge
+	***************************************************************/
+	static uint32_t edge_index(uint32_t from, uint32_t to)
+	{
+		return (((from >> 1) * 2654435761u) ^ ((to >> 1) * 2246822519u)) >> 16;
+	}
+
+private:
+	coverage(const coverage &) = delete;
+	coverage &operator=(const coverage &) = delete;
+
+	uint8_t *map;		// the counters
+	bool shared;		// map is a shmat()ed segment
+};
+
+#endif
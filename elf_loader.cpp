@@ -0,0 +1,320 @@
+#include "hex.h"
+#include "elf_loader.h"
+#include <cstdint>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static constexpr uint8_t elfclass32 = 1;
+static constexpr uint8_t elfclass64 = 2;
+static constexpr uint8_t elfdata2lsb = 1;
+static constexpr uint16_t et_exec = 2;
+static constexpr uint16_t em_riscv = 243;
+static constexpr uint32_t ef_riscv_rvc = 1;
+static constexpr uint32_t pt_load = 1;
+static constexpr uint32_t sht_symtab = 2;
+static constexpr uint8_t stt_section = 3;
+static constexpr uint8_t stt_file = 4;
+
+/**
+* Where the fields the loader uses are in the headers, the program
+* headers, the section headers and the symbols of ELF32 and ELF64. An
+* address (or offset or size) takes addr_size bytes.
+***********************************************************************/
+struct elf_layout
+{
+	uint32_t addr_size;
+	uint32_t ehdr_size, e_entry, e_phoff, e_shoff, e_flags;
+	uint32_t e_phentsize, e_phnum, e_shentsize, e_shnum;
+	uint32_t phdr_size, p_offset, p_vaddr, p_filesz, p_memsz;
+	uint32_t shdr_size, sh_offset, sh_size, sh_link;
+	uint32_t sym_size, st_info, st_shndx, st_value;
+};
+
+static constexpr elf_layout elf32_layout =
+	{ 4, 52, 24, 28, 32, 36, 42, 44, 46, 48, 32, 4, 8, 16, 20, 40, 16, 20, 24, 16, 12, 14, 4 };
+static constexpr elf_layout elf64_layout =
+	{ 8, 64, 24, 32, 40, 48, 54, 56, 58, 60, 56, 8, 16, 32, 40, 64, 24, 32, 40, 24, 4, 6, 8 };
+
+/**
+* @param p points to the first byte of the value
+*
+* @return the 16-bit little-endian value at p
+***********************************************************************/
+static uint16_t get16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+/**
+* @param p points to the first byte of the value
+*
+* @return the 32-bit little-endian value at p
+***********************************************************************/
+static uint32_t get32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+* @param p points to the first byte of the value
+* @param l is the layout of the file
+*
+* @return the little-endian address, offset or size at p
+***********************************************************************/
+static uint64_t get_addr(const uint8_t *p, const elf_layout &l)
+{
+	return l.addr_size == 8 ? get32(p) | (uint64_t)get32(p + 4) << 32 : get32(p);
+}
+
+/**
+* Tells if the file named fname is a regular file that starts with the
+* ELF magic number. Pipes are never reported as ELF files, so that
+* reading their first bytes does not lose them for memory::load_file().
+*
+* @param fname is the name of the file.
+*
+* @return true if the file looks like an ELF file.
+***********************************************************************/
+bool elf_loader::is_elf(const std::string &fname)
+{
+	struct stat st;
+	if(stat(fname.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+		return false;
+
+	int fd = open(fname.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	uint8_t magic[4];
+	bool elf = read(fd, magic, 4) == 4 && magic[0] == 0x7f
+		&& magic[1] == 'E' && magic[2] == 'L' && magic[3] == 'F';
+	close(fd);
+	return elf;
+}
+
+/**
+* Maps the file named fname and loads it into mem with
+* load_segments(), then reads its symbol table. Prints an error message
+* to stderr if the file can not be opened, is not a little-endian ELF32
+* or ELF64 RISC-V executable, or a segment does not fit in the memory.
+*
+* @param fname is the name of the file.
+* @param mem is the memory to load the segments into.
+*
+* @return true if the file was loaded.
+***********************************************************************/
+bool elf_loader::load(const std::string &fname, memory *mem)
+{
+	int fd = open(fname.c_str(), O_RDONLY);
+	struct stat st;
+
+	if(fd < 0 || fstat(fd, &st) != 0)
+	{
+		std::cerr << "Can\'t open file \'" << fname << "\' for reading.\n";
+		if(fd >= 0)
+			close(fd);
+		return false;
+	}
+
+	uint64_t len = st.st_size;
+	void *p = len ? mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if(p == MAP_FAILED)
+	{
+		std::cerr << "Can\'t open file \'" << fname << "\' for reading.\n";
+		return false;
+	}
+
+	const uint8_t *data = static_cast<const uint8_t *>(p);
+	elf64 = len > 4 && data[4] == elfclass64;
+	const elf_layout &l = elf64 ? elf64_layout : elf32_layout;
+	bool ok = len >= l.ehdr_size && (data[4] == elfclass32 || elf64) && data[5] == elfdata2lsb
+		&& get16(data + 16) == et_exec && get16(data + 18) == em_riscv;
+
+	if(!ok)
+		std::cerr << "File \'" << fname << "\' is not a RISC-V ELF executable.\n";
+	else if(load_segments(data, len, mem, l))
+	{
+		entry = get_addr(data + l.e_entry, l);
+		flags = get32(data + l.e_flags);
+		load_symbols(data, len, l);
+	}
+	else
+		ok = false;
+
+	munmap(p, len);
+	return ok;
+}
+
+/**
+* Copies the file part of every PT_LOAD segment to its virtual address
+* and zeroes the rest of it. Sets image_end, where the heap of the
+* program can start.
+*
+* @param data is the mapped file.
+* @param len is the length of the file.
+* @param mem is the memory to load the segments into.
+* @param l is the layout of the file.
+*
+* @return false if the program headers are broken or a segment does
+* not fit in the memory.
+***********************************************************************/
+bool elf_loader::load_segments(const uint8_t *data, uint64_t len, memory *mem, const elf_layout &l)
+{
+	uint64_t phoff = get_addr(data + l.e_phoff, l);
+	uint64_t phentsize = get16(data + l.e_phentsize);
+	uint64_t phnum = get16(data + l.e_phnum);
+
+	if(phentsize < l.phdr_size || phoff > len || phentsize * phnum > len - phoff)
+	{
+		std::cerr << "Broken ELF program headers.\n";
+		return false;
+	}
+
+	for(uint64_t i = 0; i < phnum; i++)
+	{
+		const uint8_t *ph = data + phoff + i * phentsize;
+		if(get32(ph) != pt_load)
+			continue;
+
+		uint64_t offset = get_addr(ph + l.p_offset, l);
+		uint64_t vaddr = get_addr(ph + l.p_vaddr, l);
+		uint64_t filesz = get_addr(ph + l.p_filesz, l);
+		uint64_t memsz = get_addr(ph + l.p_memsz, l);
+
+		if(filesz > memsz || offset > len || filesz > len - offset)
+		{
+			std::cerr << "Broken ELF program headers.\n";
+			return false;
+		}
+		if(vaddr > mem->get_size() || memsz > mem->get_size() - vaddr)
+		{
+			std::cerr << "Segment at " << (vaddr >> 32 ? hex0x64(vaddr) : hex0x32(vaddr)) << " does not fit in memory.\n";
+			return false;
+		}
+
+		mem->set_block(vaddr, data + offset, filesz);
+		if(memsz > filesz)
+			mem->zero_block(vaddr + filesz, memsz - filesz);
+		if(vaddr + memsz > image_end)
+			image_end = vaddr + memsz;
+	}
+	return true;
+}
+
+/**
+* Reads the symbols of the SHT_SYMTAB section, if there is one. Section
+* and file symbols are left out, and the first symbol seen at an
+* address names it. A broken section table is ignored.
+*
+* @param data is the mapped file.
+* @param len is the length of the file.
+* @param l is the layout of the file.
+***********************************************************************/
+void elf_loader::load_symbols(const uint8_t *data, uint64_t len, const elf_layout &l)
+{
+	uint64_t shoff = get_addr(data + l.e_shoff, l);
+	uint64_t shentsize = get16(data + l.e_shentsize);
+	uint64_t shnum = get16(data + l.e_shnum);
+
+	if(shentsize < l.shdr_size || shoff > len || shentsize * shnum > len - shoff)
+		return;
+
+	for(uint64_t i = 0; i < shnum; i++)
+	{
+		const uint8_t *sh = data + shoff + i * shentsize;
+		if(get32(sh + 4) != sht_symtab)
+			continue;
+
+		uint64_t off = get_addr(sh + l.sh_offset, l);
+		uint64_t size = get_addr(sh + l.sh_size, l);
+		uint64_t link = get32(sh + l.sh_link);
+		if(off > len || size > len - off || link >= shnum)
+			return;
+
+		const uint8_t *strsh = data + shoff + link * shentsize;
+		uint64_t stroff = get_addr(strsh + l.sh_offset, l);
+		uint64_t strsize = get_addr(strsh + l.sh_size, l);
+		if(stroff > len || strsize > len - stroff)
+			return;
+		const char *strtab = reinterpret_cast<const char *>(data + stroff);
+
+		for(uint64_t s = l.sym_size; s + l.sym_size <= size; s += l.sym_size)
+		{
+			const uint8_t *sym = data + off + s;
+			uint32_t name = get32(sym);
+			uint8_t type = sym[l.st_info] & 0xf;
+
+			if(name == 0 || name >= strsize || get16(sym + l.st_shndx) == 0
+				|| type == stt_section || type == stt_file)
+				continue;
+
+			uint64_t n = name;
+			while(n < strsize && strtab[n])
+				++n;
+			symbols.emplace(get_addr(sym + l.st_value, l), std::string(strtab + name, n - name));
+		}
+		return;
+	}
+}
+
+/**
+* Accessor for the entry point.
+*
+* @return e_entry of the loaded file, or zero if none was loaded.
+***********************************************************************/
+uint64_t elf_loader::get_entry() const
+{
+	return entry;
+}
+
+/**
+* Accessor for image_end.
+*
+* @return the address after the highest loaded segment, or zero if
+* none was loaded.
+***********************************************************************/
+uint64_t elf_loader::get_image_end() const
+{
+	return image_end;
+}
+
+/**
+* @return true if the loaded file was built for the C extension
+* (EF_RISCV_RVC is set in e_flags.)
+***********************************************************************/
+bool elf_loader::uses_compressed() const
+{
+	return flags & ef_riscv_rvc;
+}
+
+/**
+* @return true if the loaded file is an ELF64 one, for an RV64 hart.
+***********************************************************************/
+bool elf_loader::is_rv64() const
+{
+	return elf64;
+}
+
+/**
+* Finds the symbol at or before addr.
+*
+* @param addr is the address to look up.
+* @param name is set to the name of the symbol.
+* @param offset is set to the distance from the symbol to addr.
+*
+* @return false if there is no symbol at or before addr.
+***********************************************************************/
+bool elf_loader::find_symbol(uint64_t addr, std::string &name, uint64_t &offset) const
+{
+	auto it = symbols.upper_bound(addr);
+	if(it == symbols.begin())
+		return false;
+	--it;
+	name = it->second;
+	offset = addr - it->first;
+	return true;
+}
@@ -0,0 +1,55 @@
+#ifndef elf_loader_H
+#define elf_loader_H
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include "memory.h"
+
+/*
+* The documentation of most of the functions is included in the .cpp file.
+*/
+
+struct elf_layout;
+
+/**
+* Loads a little-endian ELF32 (RV32) or ELF64 (RV64) RISC-V executable
+* into the simulated memory. Every PT_LOAD segment is copied to its
+* virtual address and the part of it that is not in the file (the .bss)
+* is zeroed with memory::zero_block(). The entry point and the symbol
+* table are kept so that the hart can start at the entry point and
+* addresses can be reported by name.
+***********************************************************************/
+class elf_loader
+{
+public:
+	elf_loader()
+	{
+		entry = 0;
+		flags = 0;
+		image_end = 0;
+		elf64 = false;
+	}
+
+	static bool is_elf(const std::string &fname);
+
+	bool load(const std::string &fname, memory *mem);
+
+	uint64_t get_entry() const;
+	uint64_t get_image_end() const;
+	bool uses_compressed() const;
+	bool is_rv64() const;
+	bool find_symbol(uint64_t addr, std::string &name, uint64_t &offset) const;
+
+private:
+	bool load_segments(const uint8_t *data, uint64_t len, memory *mem, const elf_layout &l);
+	void load_symbols(const uint8_t *data, uint64_t len, const elf_layout &l);
+
+	uint64_t entry;				// e_entry
+	uint32_t flags;				// e_flags
+	uint64_t image_end;			// end of the highest PT_LOAD segment
+	bool elf64;				// the file is ELF64
+	std::map<uint64_t, std::string> symbols;	// value -> name
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "hex.h"
+#include "fuzzer.h"
+#include <cstdint>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+/**
+* Runs the program from its entry point up to mark and takes the
+* snapshot that every case starts from.
+*
+* @param mark is the address to take the snapshot at.
+*
+* @return false if the program halted before getting to mark.
+***********************************************************************/
+template<uint32_t XLEN>
+bool fuzzer<XLEN>::prepare(uint32_t mark)
+{
+	if(!hart->run_to(mark))
+	{
+		std::cerr << "Program halted before reaching " << hex0x32(mark) << ".\n";
+		return false;
+	}
+	hart->snapshot();
+	return true;
+}
+
+/**
+* Runs one case: injects data into the buffer (cut to the size of the
+* buffer), runs the program until it halts or has executed limit
+* instructions since the snapshot, and restores the snapshot.
+*
+* @param data is the input.
+* @param len is the length of the input.
+* @param limit is the max amount of instructions to execute, or 0.
+* @param executed is set to the number of instructions executed.
+*
+* @return why the program stopped.
+***********************************************************************/
+template<uint32_t XLEN>
+typename fuzzer<XLEN>::outcome fuzzer<XLEN>::run_case(const uint8_t *data, uint32_t len, uint64_t limit, uint64_t &executed)
+{
+	if(len > buffer_len)
+		len = buffer_len;
+
+	uint64_t start = hart->get_insn_counter();
+	hart->inject(buffer, data, len);
+	hart->execute(limit ? start + limit : 0);
+	executed = hart->get_insn_counter() - start;
+
+	outcome o;
+	switch(hart->get_halt_reason())
+	{
+	case rv_hart<XLEN>::halt_illegal:
+		o = outcome_illegal;
+		break;
+	case rv_hart<XLEN>::halt_exit:
+		o = outcome_exit;
+		break;
+	case rv_hart<XLEN>::halt_limit:
+		o = outcome_limit;
+		break;
+	default:
+		o = outcome_ebreak;
+		break;
+	}
+
+	hart->restore();
+	return o;
+}
+
+/**
+* Runs one case for each file, printing its outcome and the number of
+* instructions it executed, then the number of cases per outcome.
+*
+* @param files are the names of the input files.
+* @param count is the number of files.
+* @param limit is the max amount of instructions per case, or 0.
+*
+* @return 0, or 1 if a file could not be read.
+***********************************************************************/
+template<uint32_t XLEN>
+int fuzzer<XLEN>::run_files(char **files, int count, uint64_t limit)
+{
+	uint64_t totals[outcome_count] = { 0 };
+	int status = 0;
+
+	for(int i = 0; i < count; ++i)
+	{
+		std::ifstream in(files[i], std::ios::in | std::ios::binary);
+		if(!in)
+		{
+			std::cerr << "Can\'t open file \'" << files[i] << "\' for reading.\n";
+			status = 1;
+			continue;
+		}
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+		uint64_t executed;
+		outcome o = run_case(data.data(), data.size(), limit, executed);
+		++totals[o];
+		std::cout << files[i] << ": " << outcome_name(o) << " after "
+			<< executed << " instructions\n";
+	}
+
+	std::cout << count << " cases: " << totals[outcome_ebreak] << " ebreak, "
+		<< totals[outcome_illegal] << " illegal, "
+		<< totals[outcome_exit] << " exit, "
+		<< totals[outcome_limit] << " limit\n";
+	return status;
+}
+
+/**
+* @param o is an outcome.
+*
+* @return the name of the outcome.
+***********************************************************************/
+template<uint32_t XLEN>
+const char *fuzzer<XLEN>::outcome_name(outcome o)
+{
+	switch(o)
+	{
+	case outcome_ebreak:
+		return "ebreak";
+	case outcome_illegal:
+		return "illegal";
+	case outcome_exit:
+		return "exit";
+	default:
+		return "limit";
+	}
+}
+
+template class fuzzer<32>;
+template class fuzzer<64>;
@@ -0,0 +1,57 @@
+#ifndef fuzzer_H
+#define fuzzer_H
+
+#include <cstdint>
+#include <string>
+#include "rv32i.h"
+
+/*
+* The documentation of most of the functions is included in the .cpp file.
+*/
+
+/**
+* Runs a program over and over on different inputs inside the same
+* process. The program is run once up to a marked address and a
+* snapshot of the hart is taken there. Every case then puts its input
+* in a buffer of the guest memory, runs until the program halts and
+* restores the snapshot, which only rewrites the pages of memory that
+* the case dirtied. XLEN is that of the hart.
+***********************************************************************/
+template<uint32_t XLEN>
+class fuzzer
+{
+public:
+	enum outcome
+	{
+		outcome_ebreak,		// stopped by an ebreak instruction
+		outcome_illegal,	// stopped by an illegal instruction
+		outcome_exit,		// stopped by an exit system call
+		outcome_limit,		// ran out of instructions
+		outcome_count
+	};
+
+	fuzzer(rv_hart<XLEN> *h, memory *m, uint32_t buf, uint32_t buf_len)
+	{
+		hart = h;
+		mem = m;
+		buffer = buf;
+		buffer_len = buf_len;
+	}
+
+	bool prepare(uint32_t mark);
+	outcome run_case(const uint8_t *data, uint32_t len, uint64_t limit, uint64_t &executed);
+	int run_files(char **files, int count, uint64_t limit);
+
+	static const char *outcome_name(outcome o);
+
+private:
+	rv_hart<XLEN> *hart;
+	memory *mem;
+	uint32_t buffer;	// guest address of the input buffer
+	uint32_t buffer_len;	// size of the input buffer
+};
+
+extern template class fuzzer<32>;
+extern template class fuzzer<64>;
+
+#endif
@@ -1,9 +1,20 @@
 #include "hex.h"
 
-#include<sstream>
-#include<iomanip>
 #include<cstdint>
-#include<iostream>
+#include<cstring>
+
+/**
+ * The two hex digits of every byte value, in order.
+ ***********************************************************************/
+static const char hex_pairs[513] =
+	"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+	"202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+	"404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+	"606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+	"808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+	"a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+	"c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+	"e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
 
 /**
  * Returns a std::string with exactly 2 hex digits representing the 8 bits of the i argument.			      
@@ -15,9 +26,8 @@
  ***********************************************************************/
 std::string hex8(uint8_t i)
 {
-	std::ostringstream os;
-	os << std::hex << std::setfill('0') << std::setw(2) << static_cast<uint16_t>(i);
-	return os.str();
+	char buf[2];
+	return std::string(buf, put_hex8(buf, i));
 }
 
 /**
@@ -30,9 +40,8 @@ std::string hex8(uint8_t i)
  ***********************************************************************/
 std::string hex32(uint32_t i)
 {
-	std::ostringstream os;
-	os << std::hex << std::setfill('0') << std::setw(8) << static_cast<uint32_t>(i);
-	return os.str();
+	char buf[8];
+	return std::string(buf, put_hex32(buf, i));
 }
 
 /**
@@ -45,5 +54,164 @@ std::string hex32(uint32_t i)
  ***********************************************************************/
 std::string hex0x32(uint32_t i)
 {
-	return std::string("0x")+hex32(i);
+	char buf[10];
+	return std::string(buf, put_hex0x32(buf, i));
+}
+
+/**
+ * Returns a std::string with exactly 16 hex digits representing the 64
+ * bits of the i argument.
+ *
+ * @param i is a uint64_t that contains the 64 bits to be converted.
+ *
+ * @return The std::string with exactly 16 hex digits representing the i
+ * argument
+ ***********************************************************************/
+std::string hex64(uint64_t i)
+{
+	char buf[16];
+	return std::string(buf, put_hex64(buf, i));
+}
+
+/**
+ * Returns a std::string beginning with 0x, followed by the 16 hex
+ * digits representing the 64 bits of the i argument.
+ *
+ * @param i is a uint64_t that contains the 64 bits to be converted.
+ *
+ * @return The std::string with formatting to represent the i argument
+ ***********************************************************************/
+std::string hex0x64(uint64_t i)
+{
+	char buf[18];
+	return std::string(buf, put_hex0x64(buf, i));
+}
+
+/**
+ * Writes exactly 2 hex digits representing the 8 bits of i into the
+ * buffer at p, with no terminating nul. The strings above are short
+ * enough to fit in a std::string without a heap allocation, but the
+ * put_xxx() formatters do not even make one.
+ *
+ * @param p is where to write the digits.
+ * @param i is the value to be converted.
+ *
+ * @return the address after the last digit.
+ ***********************************************************************/
+char *put_hex8(char *p, uint8_t i)
+{
+	memcpy(p, hex_pairs + 2*i, 2);
+	return p + 2;
+}
+
+/**
+ * Writes exactly 8 hex digits representing the 32 bits of i into the
+ * buffer at p.
+ *
+ * @param p is where to write the digits.
+ * @param i is the value to be converted.
+ *
+ * @return the address after the last digit.
+ ***********************************************************************/
+char *put_hex32(char *p, uint32_t i)
+{
+	memcpy(p, hex_pairs + 2*(i >> 24), 2);
+	memcpy(p + 2, hex_pairs + 2*((i >> 16) & 0xff), 2);
+	memcpy(p + 4, hex_pairs + 2*((i >> 8) & 0xff), 2);
+	memcpy(p + 6, hex_pairs + 2*(i & 0xff), 2);
+	return p + 8;
+}
+
+/**
+ * Writes 0x followed by the 8 hex digits of i into the buffer at p.
+ *
+ * @param p is where to write the digits.
+ * @param i is the value to be converted.
+ *
+ * @return the address after the last digit.
+ ***********************************************************************/
+char *put_hex0x32(char *p, uint32_t i)
+{
+	p[0] = '0';
+	p[1] = 'x';
+	return put_hex32(p + 2, i);
+}
+
+/**
+ * Writes exactly 16 hex digits representing the 64 bits of i into the
+ * buffer at p.
+ *
+ * @param p is where to write the digits.
+ * @param i is the value to be converted.
+ *
+ * @return the address after the last digit.
+ ***********************************************************************/
+char *put_hex64(char *p, uint64_t i)
+{
+	return put_hex32(put_hex32(p, i >> 32), i);
+}
+
+/**
+ * Writes 0x followed by the 16 hex digits of i into the buffer at p.
+ *
+ * @param p is where to write the digits.
+ * @param i is the value to be converted.
+ *
+ * @return the address after the last digit.
+ ***********************************************************************/
+char *put_hex0x64(char *p, uint64_t i)
+{
+	p[0] = '0';
+	p[1] = 'x';
+	return put_hex64(p + 2, i);
+}
+
+/**
+ * Writes i in hex with no leading zeros (but one digit for zero) into
+ * the buffer at p, like std::hex does.
+ *
+ * @param p is where to write the digits, room for 16 of them.
+ * @param i is the value to be converted.
+ *
+ * @return the address after the last digit.
+ ***********************************************************************/
+char *put_hex(char *p, uint64_t i)
+{
+	char digits[16];
+	char *end = i >> 32 ? put_hex64(digits, i) : put_hex32(digits, i);
+	char *first = digits;
+	while(first < end - 1 && *first == '0')
+		++first;
+	memcpy(p, first, end - first);
+	return p + (end - first);
+}
+
+/**
+ * Writes i in decimal, with a - if it is negative, into the buffer at p.
+ *
+ * @param p is where to write the digits, room for 20 of them.
+ * @param i is the value to be converted.
+ *
+ * @return the address after the last digit.
+ ***********************************************************************/
+char *put_dec(char *p, int64_t i)
+{
+	uint64_t u = i;
+	if(i < 0)
+	{
+		*p++ = '-';
+		u = -u;
+	}
+
+	char digits[20];
+	char *d = digits + sizeof(digits);
+	do
+	{
+		*--d = '0' + u % 10;
+		u /= 10;
+	} while(u);
+
+	size_t n = digits + sizeof(digits) - d;
+	memcpy(p, d, n);
+	return p + n;
 }
@@ -2,7 +2,9 @@
 #define hex_H
 
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <ostream>
 
 /*
 * The documentation of each function is included in the .cpp file.
@@ -11,5 +13,183 @@
 std::string hex8(uint8_t i);
 std::string hex32(uint32_t i);
 std::string hex0x32(uint32_t i);
+std::string hex64(uint64_t i);
+std::string hex0x64(uint64_t i);
+
+char *put_hex8(char *p, uint8_t i);
+char *put_hex32(char *p, uint32_t i);
+char *put_hex0x32(char *p, uint32_t i);
+char *put_hex64(char *p, uint64_t i);
+char *put_hex0x64(char *p, uint64_t i);
+char *put_hex(char *p, uint64_t i);
+char *put_dec(char *p, int64_t i);
+
+/**
+* A line of text put together in a buffer of its own with the put_xxx()
+* formatters, so that rendering it allocates nothing. Text that does
+* not fit is dropped. The appenders are defined here so that they can
+* be inlined into the rendering code.
+***********************************************************************/
+class text_line
+{
+public:
+	text_line()
+	{
+		len = 0;
+	}
+
+	text_line &operator<<(const char *s)
+	{
+		return append(s, strlen(s));
+	}
+
+	text_line &operator<<(const std::string &s)
+	{
+		return *this << s.c_str();
+	}
+
+	text_line &operator<<(char c)
+	{
+		if(len < capacity)
+			buf[len++] = c;
+		return *this;
+	}
+
+	text_line &operator<<(int32_t i)
+	{
+		if(capacity - len >= max_number)
+			len = put_dec(buf + len, i) - buf;
+		return *this;
+	}
+
+	text_line &operator<<(uint32_t i)
+	{
+		if(capacity - len >= max_number)
+			len = put_dec(buf + len, i) - buf;
+		return *this;
+	}
+
+	text_line &operator<<(int64_t i)
+	{
+		if(capacity - len >= max_number)
+			len = put_dec(buf + len, i) - buf;
+		return *this;
+	}
+
+	/**
+	* Appends the n characters at s.
+	***************************************************************/
+	text_line &append(const char *s, size_t n)
+	{
+		if(n > capacity - len)
+			n = capacity - len;
+		memcpy(buf + len, s, n);
+		len += n;
+		return *this;
+	}
+
+	/**
+	* Appends the first n characters of the array s. When there is
+	* room, the whole array is copied with a few fixed-size moves,
+	* which is a lot cheaper than a memcpy() of a variable n.
+	***************************************************************/
+	template<size_t size>
+	text_line &append_prefix(const char (&s)[size], size_t n)
+	{
+		if(capacity - len < size)
+			return append(s, n);
+		memcpy(buf + len, s, size);
+		len += n;
+		return *this;
+	}
+
+	/**
+	* Appends exactly 2 hex digits of i, like hex8().
+	***************************************************************/
+	text_line &hex8(uint8_t i)
+	{
+		if(capacity - len >= 2)
+			len = put_hex8(buf + len, i) - buf;
+		return *this;
+	}
+
+	/**
+	* Appends exactly 8 hex digits of i, like hex32().
+	***************************************************************/
+	text_line &hex32(uint32_t i)
+	{
+		if(capacity - len >= 8)
+			len = put_hex32(buf + len, i) - buf;
+		return *this;
+	}
+
+	/**
+	* Appends exactly 16 hex digits of i, like hex64().
+	***************************************************************/
+	text_line &hex64(uint64_t i)
+	{
+		if(capacity - len >= 16)
+			len = put_hex64(buf + len, i) - buf;
+		return *this;
+	}
+
+	/**
+	* Appends i in hex without leading zeros, like std::hex does.
+	***************************************************************/
+	text_line &hex(uint64_t i)
+	{
+		if(capacity - len >= max_number)
+			len = put_hex(buf + len, i) - buf;
+		return *this;
+	}
+
+	/**
+	* Cuts the line to n characters or fills it up to n characters
+	* with c, like std::string::resize().
+	***************************************************************/
+	void resize(size_t n, char c)
+	{
+		if(n > capacity)
+			n = capacity;
+		if(n > len)
+			memset(buf + len, c, n - len);
+		len = n;
+	}
+
+	/**
+	* Appends spaces until the line is n characters long, if it is
+	* shorter, like std::setw() with std::left.
+	***************************************************************/
+	void pad(size_t n)
+	{
+		if(n > len)
+			resize(n, ' ');
+	}
+
+	const char *data() const
+	{
+		return buf;
+	}
+
+	size_t size() const
+	{
+		return len;
+	}
+
+private:
+	static constexpr size_t capacity = 256;
+	static constexpr size_t max_number = 20;	// longest put_dec() or put_hex()
+
+	char buf[capacity];
+	size_t len;
+};
+
+/**
+* Writes the line to os in one piece.
+***********************************************************************/
+inline std::ostream &operator<<(std::ostream &os, const text_line &line)
+{
+	return os.write(line.data(), line.size());
+}
 
 #endif
@@ -0,0 +1,552 @@
+#include "jit.h"
+#include "rv32i.h"
+#include "coverage.h"
+#include <cstdint>
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#define JIT_X86_64 1
+#endif
+
+/*
+* Register usage of the generated code:
+*	rbx	pointer to the guest register array (callee-saved)
+*	r12	pointer to the rv32i hart (callee-saved)
+*	eax	scratch, result, the next pc on return
+*	ecx	scratch, shift amount, the other branch target
+*	esi	address argument of the load/store helpers
+*	edx	value argument of the store helpers
+*	rcx	address of a coverage counter
+*/
+
+/**
+* Maps the executable code buffer. If that is not possible the JIT
+* stays unavailable.
+***********************************************************************/
+jit::jit()
+{
+	buffer = nullptr;
+	used = 0;
+	cur = 0;
+	overflow = false;
+
+#ifdef JIT_X86_64
+	void *p = mmap(nullptr, buffer_size, PROT_READ|PROT_WRITE|PROT_EXEC,
+		MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if(p != MAP_FAILED)
+		buffer = static_cast<uint8_t *>(p);
+#endif
+}
+
+/**
+* Unmaps the executable code buffer.
+***********************************************************************/
+jit::~jit()
+{
+#ifdef JIT_X86_64
+	if(buffer)
+		munmap(buffer, buffer_size);
+#endif
+}
+
+/**
+* @return true if blocks can be compiled on this host.
+***********************************************************************/
+bool jit::is_available() const
+{
+	return buffer != nullptr;
+}
+
+/**
+* @return true if the last compile() failed because the buffer is full.
+***********************************************************************/
+bool jit::is_full() const
+{
+	return overflow;
+}
+
+/**
+* Forgets all the generated code. Every native_block handed out before
+* becomes invalid.
+***********************************************************************/
+void jit::reset()
+{
+	used = 0;
+}
+
+void jit::emit8(uint8_t b)
+{
+	if(cur < buffer_size)
+		buffer[cur++] = b;
+	else
+		overflow = true;
+}
+
+void jit::emit32(uint32_t v)
+{
+	for(int i = 0; i < 4; ++i)
+		emit8(v >> (8*i));
+}
+
+void jit::emit64(uint64_t v)
+{
+	for(int i = 0; i < 8; ++i)
+		emit8(v >> (8*i));
+}
+
+/**
+* Emits mov reg32,[rbx+4*r] or, with a different opcode before it, any
+* other op reg32,[rbx+4*r].
+*
+* @param modrm_reg is the x86 register number of reg32
+*
+* @param r is the guest register
+***********************************************************************/
+void jit::emit_load(uint8_t modrm_reg, uint32_t r)
+{
+	emit8(0x43 | (modrm_reg << 3));		// [rbx+disp8]
+	emit8(r * 4);
+}
+
+/**
+* Emits mov [rbx+4*r],eax unless r is x0.
+*
+* @param r is the guest register
+***********************************************************************/
+void jit::emit_store_eax(uint32_t r)
+{
+	if(r == 0)
+		return;
+	emit8(0x89);
+	emit_load(0, r);
+}
+
+/**
+* Emits a call to a helper. rdi is loaded with the hart pointer.
+*
+* @param fn is the address of the helper
+***********************************************************************/
+void jit::emit_call(const void *fn)
+{
+	emit8(0x4c); emit8(0x89); emit8(0xe7);	// mov rdi,r12
+	emit8(0x48); emit8(0xb8);		// mov rax,imm64
+	emit64(reinterpret_cast<uintptr_t>(fn));
+	emit8(0xff); emit8(0xd0);		// call rax
+}
+
+/**
+* Emits an increment of the given coverage counter.
+*
+* @param counter is the address of the counter
+***********************************************************************/
+void jit::emit_count(uint8_t *counter)
+{
+	emit8(0x48); emit8(0xb9);		// mov rcx,imm64
+	emit64(reinterpret_cast<uintptr_t>(counter));
+	emit8(0xfe); emit8(0x01);		// inc byte [rcx]
+}
+
+/**
+* Emits the epilogue, returning whatever is in eax.
+***********************************************************************/
+void jit::emit_return_eax()
+{
+	emit8(0x5d);				// pop rbp
+	emit8(0x41); emit8(0x5c);		// pop r12
+	emit8(0x5b);				// pop rbx
+	emit8(0xc3);				// ret
+}
+
+/**
+* Emits the epilogue, returning the given pc.
+*
+* @param next_pc is the address execution continues at
+***********************************************************************/
+void jit::emit_return(uint32_t next_pc)
+{
+	emit8(0xb8);				// mov eax,imm32
+	emit32(next_pc);
+	emit_return_eax();
+}
+
+/**
+* Translates the given block into native code. Loads and stores are
+* done by calling the rv32i::jit_xxx() helpers so that they behave
+* (and warn) exactly like the interpreter. A store that hits the code
+* of a translated block makes the native code return right after it,
+* so that the blocks can be discarded before anything stale runs.
+* Blocks ending with ecall, ebreak or an illegal instruction are left
+* to the interpreter. With a coverage map, the taken branches and jumps count
+* their edges in it.
+*
+* @param b is the block to translate
+*
+* @param cov_map is the coverage map or nullptr
+*
+* @return the native code, or nullptr if the block can not be compiled
+* (no JIT on this host, unsupported block, or the buffer is full.)
+***********************************************************************/
+jit::native_block jit::compile(const translated_block<32> &b, uint8_t *cov_map)
+{
+	if(!buffer)
+		return nullptr;
+
+	const rv32i::decoded_insn &last = b.ops.back();
+	if(last.kind == rv32i::kind_ebreak || last.kind == rv32i::kind_ecall ||
+	   last.kind == rv32i::kind_illegal)
+		return nullptr;
+
+	cur = used;
+	overflow = false;
+	uint8_t *entry = buffer + cur;
+
+	emit8(0x53);				// push rbx
+	emit8(0x41); emit8(0x54);		// push r12
+	emit8(0x55);				// push rbp (aligns the stack)
+	emit8(0x48); emit8(0x89); emit8(0xfb);	// mov rbx,rdi
+	emit8(0x49); emit8(0x89); emit8(0xf4);	// mov r12,rsi
+
+	uint32_t pc = b.start;
+	bool returned = false;
+	uint8_t cc;
+
+	for(const rv32i::decoded_insn &d : b.ops)
+	{
+		switch(d.kind)
+		{
+		default:
+			// kind_decode can not be in a block, ecall/ebreak/
+			// illegal were rejected above
+			cur = used;
+			return nullptr;
+
+		case rv32i::kind_fence:
+			break;
+
+		case rv32i::kind_lui:
+		case rv32i::kind_auipc:
+			if(d.rd != 0)
+			{
+				emit8(0xc7);		// mov dword [rbx+disp8],imm32
+				emit_load(0, d.rd);
+				emit32(d.kind == rv32i::kind_lui ? d.imm : d.imm + pc);
+			}
+			break;
+
+		case rv32i::kind_addi:
+		case rv32i::kind_xori:
+		case rv32i::kind_ori:
+		case rv32i::kind_andi:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			switch(d.kind)
+			{
+			default:
+			case rv32i::kind_addi:	emit8(0x05); break;	// add eax,imm32
+			case rv32i::kind_xori:	emit8(0x35); break;	// xor eax,imm32
+			case rv32i::kind_ori:	emit8(0x0d); break;	// or eax,imm32
+			case rv32i::kind_andi:	emit8(0x25); break;	// and eax,imm32
+			}
+			emit32(d.imm);
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_slti:
+		case rv32i::kind_sltiu:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0x3d); emit32(d.imm);		// cmp eax,imm32
+			emit8(0x0f); emit8(d.kind == rv32i::kind_slti ? 0x9c : 0x92);
+			emit8(0xc0);				// setl/setb al
+			emit8(0x0f); emit8(0xb6); emit8(0xc0);	// movzx eax,al
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_slli:
+		case rv32i::kind_srli:
+		case rv32i::kind_srai:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0xc1);				// shl/shr/sar eax,imm8
+			emit8(d.kind == rv32i::kind_slli ? 0xe0 : d.kind == rv32i::kind_srli ? 0xe8 : 0xf8);
+			emit8(d.imm);
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_add:
+		case rv32i::kind_sub:
+		case rv32i::kind_xor:
+		case rv32i::kind_or:
+		case rv32i::kind_and:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			switch(d.kind)
+			{
+			default:
+			case rv32i::kind_add:	emit8(0x03); break;	// add eax,[rs2]
+			case rv32i::kind_sub:	emit8(0x2b); break;	// sub eax,[rs2]
+			case rv32i::kind_xor:	emit8(0x33); break;	// xor eax,[rs2]
+			case rv32i::kind_or:	emit8(0x0b); break;	// or eax,[rs2]
+			case rv32i::kind_and:	emit8(0x23); break;	// and eax,[rs2]
+			}
+			emit_load(0, d.rs2);
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_mul:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0x0f); emit8(0xaf); emit_load(0, d.rs2);	// imul eax,[rs2]
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_mulh:
+		case rv32i::kind_mulhu:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0xf7); emit_load(d.kind == rv32i::kind_mulh ? 5 : 4, d.rs2);	// imul/mul dword [rs2]
+			emit8(0x89); emit8(0xd0);		// mov eax,edx
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_mulhsu:
+			emit8(0x48); emit8(0x63); emit_load(0, d.rs1);	// movsxd rax,[rs1]
+			emit8(0x8b); emit_load(1, d.rs2);	// mov ecx,[rs2]
+			emit8(0x48); emit8(0x0f); emit8(0xaf); emit8(0xc1);	// imul rax,rcx
+			emit8(0x48); emit8(0xc1); emit8(0xe8); emit8(32);	// shr rax,32
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_div:
+		case rv32i::kind_divu:
+		case rv32i::kind_rem:
+		case rv32i::kind_remu:
+			emit8(0x8b); emit_load(6, d.rs1);	// mov esi,[rs1]
+			emit8(0x8b); emit_load(2, d.rs2);	// mov edx,[rs2]
+			switch(d.kind)
+			{
+			default:
+			case rv32i::kind_div:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_div)); break;
+			case rv32i::kind_divu:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_divu)); break;
+			case rv32i::kind_rem:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_rem)); break;
+			case rv32i::kind_remu:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_remu)); break;
+			}
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_sh1add:
+		case rv32i::kind_sh2add:
+		case rv32i::kind_sh3add:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0x8b); emit_load(1, d.rs2);	// mov ecx,[rs2]
+			emit8(0x8d); emit8(0x04);		// lea eax,[rcx+rax*scale]
+			emit8(d.kind == rv32i::kind_sh1add ? 0x41 : d.kind == rv32i::kind_sh2add ? 0x81 : 0xc1);
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_andn:
+		case rv32i::kind_orn:
+			emit8(0x8b); emit_load(0, d.rs2);	// mov eax,[rs2]
+			emit8(0xf7); emit8(0xd0);		// not eax
+			emit8(d.kind == rv32i::kind_andn ? 0x23 : 0x0b);
+			emit_load(0, d.rs1);			// and/or eax,[rs1]
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_xnor:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0x33); emit_load(0, d.rs2);	// xor eax,[rs2]
+			emit8(0xf7); emit8(0xd0);		// not eax
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_min:
+		case rv32i::kind_minu:
+		case rv32i::kind_max:
+		case rv32i::kind_maxu:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0x8b); emit_load(1, d.rs2);	// mov ecx,[rs2]
+			emit8(0x39); emit8(0xc8);		// cmp eax,ecx
+			switch(d.kind)
+			{
+			default:
+			case rv32i::kind_min:	cc = 0xf; break;	// g
+			case rv32i::kind_minu:	cc = 0x7; break;	// a
+			case rv32i::kind_max:	cc = 0xc; break;	// l
+			case rv32i::kind_maxu:	cc = 0x2; break;	// b
+			}
+			emit8(0x0f); emit8(0x40 | cc);		// cmovcc eax,ecx
+			emit8(0xc1);
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_rol:
+		case rv32i::kind_ror:
+			emit8(0x8b); emit_load(1, d.rs2);	// mov ecx,[rs2]
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0xd3);				// rol/ror eax,cl
+			emit8(d.kind == rv32i::kind_rol ? 0xc0 : 0xc8);
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_rori:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0xc1); emit8(0xc8); emit8(d.imm);	// ror eax,imm8
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_sext_b:
+		case rv32i::kind_sext_h:
+		case rv32i::kind_zext_h:
+			emit8(0x0f);				// movsx/movzx eax,byte/word [rs1]
+			emit8(d.kind == rv32i::kind_sext_b ? 0xbe : d.kind == rv32i::kind_sext_h ? 0xbf : 0xb7);
+			emit_load(0, d.rs1);
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_rev8:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0x0f); emit8(0xc8);		// bswap eax
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_clz:
+		case rv32i::kind_ctz:
+		case rv32i::kind_cpop:
+		case rv32i::kind_orc_b:
+			emit8(0x8b); emit_load(6, d.rs1);	// mov esi,[rs1]
+			switch(d.kind)
+			{
+			default:
+			case rv32i::kind_clz:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_clz)); break;
+			case rv32i::kind_ctz:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_ctz)); break;
+			case rv32i::kind_cpop:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_cpop)); break;
+			case rv32i::kind_orc_b:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_orc_b)); break;
+			}
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_sll:
+		case rv32i::kind_srl:
+		case rv32i::kind_sra:
+			emit8(0x8b); emit_load(1, d.rs2);	// mov ecx,[rs2]
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0xd3);				// shl/shr/sar eax,cl
+			emit8(d.kind == rv32i::kind_sll ? 0xe0 : d.kind == rv32i::kind_srl ? 0xe8 : 0xf8);
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_slt:
+		case rv32i::kind_sltu:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0x3b); emit_load(0, d.rs2);	// cmp eax,[rs2]
+			emit8(0x0f); emit8(d.kind == rv32i::kind_slt ? 0x9c : 0x92);
+			emit8(0xc0);				// setl/setb al
+			emit8(0x0f); emit8(0xb6); emit8(0xc0);	// movzx eax,al
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_lb:
+		case rv32i::kind_lh:
+		case rv32i::kind_lw:
+		case rv32i::kind_lbu:
+		case rv32i::kind_lhu:
+			emit8(0x8b); emit_load(6, d.rs1);	// mov esi,[rs1]
+			emit8(0x81); emit8(0xc6); emit32(d.imm);	// add esi,imm32
+			switch(d.kind)
+			{
+			default:
+			case rv32i::kind_lb:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_lb)); break;
+			case rv32i::kind_lh:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_lh)); break;
+			case rv32i::kind_lw:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_lw)); break;
+			case rv32i::kind_lbu:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_lbu)); break;
+			case rv32i::kind_lhu:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_lhu)); break;
+			}
+			emit_store_eax(d.rd);
+			break;
+
+		case rv32i::kind_sb:
+		case rv32i::kind_sh:
+		case rv32i::kind_sw:
+			emit8(0x8b); emit_load(6, d.rs1);	// mov esi,[rs1]
+			emit8(0x81); emit8(0xc6); emit32(d.imm);	// add esi,imm32
+			emit8(0x8b); emit_load(2, d.rs2);	// mov edx,[rs2]
+			switch(d.kind)
+			{
+			default:
+			case rv32i::kind_sb:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_sb)); break;
+			case rv32i::kind_sh:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_sh)); break;
+			case rv32i::kind_sw:	emit_call(reinterpret_cast<const void *>(&rv32i::jit_sw)); break;
+			}
+			emit8(0x84); emit8(0xc0);		// test al,al
+			emit8(0x74); emit8(10);			// jz over the return
+			emit_return(pc + d.len);		// 10 bytes
+			break;
+
+		case rv32i::kind_jal:
+			emit8(0xb8); emit32(pc + d.len);		// mov eax,pc+len
+			emit_store_eax(d.rd);
+			if(cov_map)
+				emit_count(&cov_map[coverage::edge_index(pc, pc + d.imm)]);
+			emit_return(pc + d.imm);
+			returned = true;
+			break;
+
+		case rv32i::kind_jalr:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0x05); emit32(d.imm);		// add eax,imm32
+			emit8(0x25); emit32(0xfffffffe);	// and eax,-2
+			if(cov_map)
+			{
+				emit8(0x89); emit8(0xc6);	// mov esi,eax
+				emit8(0xba); emit32(pc);	// mov edx,pc
+				emit_call(reinterpret_cast<const void *>(&rv32i::jit_edge));
+			}
+			if(d.rd != 0)
+			{
+				emit8(0xc7);			// mov dword [rd],pc+len
+				emit_load(0, d.rd);
+				emit32(pc + d.len);
+			}
+			emit_return_eax();
+			returned = true;
+			break;
+
+		case rv32i::kind_beq:
+		case rv32i::kind_bne:
+		case rv32i::kind_blt:
+		case rv32i::kind_bge:
+		case rv32i::kind_bltu:
+		case rv32i::kind_bgeu:
+			emit8(0x8b); emit_load(0, d.rs1);	// mov eax,[rs1]
+			emit8(0x3b); emit_load(0, d.rs2);	// cmp eax,[rs2]
+			emit8(0xb8); emit32(pc + d.len);		// mov eax,pc+len
+			emit8(0xb9); emit32(pc + d.imm);	// mov ecx,pc+imm
+			switch(d.kind)
+			{
+			default:
+			case rv32i::kind_beq:	cc = 0x4; break;	// e
+			case rv32i::kind_bne:	cc = 0x5; break;	// ne
+			case rv32i::kind_blt:	cc = 0xc; break;	// l
+			case rv32i::kind_bge:	cc = 0xd; break;	// ge
+			case rv32i::kind_bltu:	cc = 0x2; break;	// b
+			case rv32i::kind_bgeu:	cc = 0x3; break;	// ae
+			}
+			emit8(0x0f); emit8(0x40 | cc);		// cmovcc eax,ecx
+			emit8(0xc1);
+			if(cov_map)
+			{
+				// the flags are still those of the cmp
+				emit8(0x70 | (cc ^ 1)); emit8(12);	// jncc over the count
+				emit_count(&cov_map[coverage::edge_index(pc, pc + d.imm)]);	// 12 bytes
+			}
+			emit_return_eax();
+			returned = true;
+			break;
+		}
+		pc += d.len;
+	}
+
+	if(!returned)
+		emit_return(b.end);	// ran into max_block_insns or the end of a page
+
+	if(overflow)
+		return nullptr;
+
+	used = cur;
+	return reinterpret_cast<native_block>(entry);
+}
@@ -0,0 +1,59 @@
+#ifndef jit_H
+#define jit_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+* The documentation of most of the functions is included in the .cpp file.
+*/
+
+template<uint32_t XLEN> class rv_hart;
+template<uint32_t XLEN> struct translated_block;
+
+/**
+* Translates hot basic blocks into native x86-64 code. The code lives
+* in one executable buffer that is reset as a whole when the blocks
+* are flushed or when it is full. On other hosts compile() always
+* fails and the blocks keep being interpreted. Only the blocks of an
+* RV32 hart are compiled.
+***********************************************************************/
+class jit
+{
+public:
+	/**
+	* A translated block. It takes the register array and the hart,
+	* and returns the address of the next instruction to execute.
+	***************************************************************/
+	typedef uint32_t (*native_block)(int32_t *regs, rv_hart<32> *hart);
+
+	jit();
+	~jit();
+
+	bool is_available() const;
+	bool is_full() const;
+	native_block compile(const translated_block<32> &b, uint8_t *cov_map);
+	void reset();
+
+	static constexpr uint32_t hot_threshold = 16;	// runs before compiling
+
+private:
+	void emit8(uint8_t b);
+	void emit32(uint32_t v);
+	void emit64(uint64_t v);
+	void emit_load(uint8_t modrm_reg, uint32_t r);
+	void emit_store_eax(uint32_t r);
+	void emit_call(const void *fn);
+	void emit_count(uint8_t *counter);
+	void emit_return_eax();
+	void emit_return(uint32_t next_pc);
+
+	static constexpr size_t buffer_size = 16 << 20;
+
+	uint8_t *buffer;	// the executable buffer or nullptr
+	size_t used;		// bytes of buffer handed out
+	size_t cur;		// write position of the block being compiled
+	bool overflow;		// the block being compiled did not fit
+};
+
+#endif
@@ -1,4 +1,10 @@
 #include "rv32i.h"
+#include "elf_loader.h"
+#include "fuzzer.h"
+#include "coverage.h"
+#include "async_tracer.h"
+#include "sink.h"
+#include <memory>
 #include <stdlib.h>
 #include <iostream>
 #include <ctype.h>
@@ -9,52 +15,292 @@
  *********************************************************************/
 void usage()
 {
-	std::cerr << "Usage: rv32i [-m hex-mem-size] [-l execution-limit] [-dirz] infile" << std::endl;
-	std::cerr << "     -m specify memory size (default = 0x10000)" << std::endl;
+	std::cerr << "Usage: rv32i [-m hex-mem-size] [-l execution-limit] [-e engine] [-c coverage-file] [-t trace-file] [-f hex-addr:hex-len [-p hex-addr]] [-o stream=file] [-x 32|64] [-CSdirsuz] infile [input...]" << std::endl;
+	std::cerr << "     -m specify memory size (default = 0x1000, 0x100000000 with -s or for an ELF file)" << std::endl;
 	std::cerr << "     -l specify execution limit (default = infinite)" << std::endl;
+	std::cerr << "     -e select the execution engine: switch, cached, threaded, block or jit (default = cached)" << std::endl;
+	std::cerr << "     -c write an AFL-style edge coverage map to the file at exit" << std::endl;
+	std::cerr << "     -t write a binary trace of the run to the file, rv32i-trace renders it like -i" << std::endl;
+	std::cerr << "     -f run the program once per input file, with the input in the given buffer" << std::endl;
+	std::cerr << "     -p with -f, start every run from a snapshot taken at this address (default = entry point)" << std::endl;
+	std::cerr << "     -o send a stream (trace, regs, memory or warnings) to a file, - for stdout, nothing to drop it" << std::endl;
+	std::cerr << "     -x select RV32I or RV64I (default = 32, 64 for an ELF64 file)" << std::endl;
+	std::cerr << "     -C enable the C extension (on by default for an ELF file built for it)" << std::endl;
+	std::cerr << "     -S emulate the newlib/Linux system calls on ecall (on by default for an ELF file)" << std::endl;
 	std::cerr << "     -d show disassembly before program simulation" << std::endl;
 	std::cerr << "     -i show instruction printing during execution" << std::endl;
 	std::cerr << "     -r show a dump of the hart status before each exec" << std::endl;
+	std::cerr << "     -s use a sparse memory, allocated a 4 KiB page at a time" << std::endl;
+	std::cerr << "     -u flush the output after every line (default only when stdout is a terminal)" << std::endl;
 	std::cerr << "     -z show a dump of the hart and memory after simulation" << std::endl;
 	exit(1);
 }
 
 /**
- * Read a file of RV32I instructions and execute them.
- ********************************************************************/
-int main(int argc, char **argv)
-{	
-	uint32_t memory_limit = 0x1000; // default memory size = 64k
+ * The command line, everything simulate() needs to know.
+ *********************************************************************/
+struct options
+{
 	uint32_t exec_limit = 0;
-
 	bool i_is_on = false;		// show instruction printing during execution.
 	bool r_is_on = false;		// show a dump of the hart status before each instruction.
 	bool z_is_on = false;		// show a dump of the hart status and memory after the simulation has halted.
 	bool d_is_on = false;		// show a disassembly before program simulation begins.
+	rv32i::engine_kind engine = rv32i::engine_cached;	// the same values for both widths
+	bool f_is_on = false;		// run once per input file from a snapshot.
+	uint32_t fuzz_buffer = 0;
+	uint32_t fuzz_len = 0;
+	bool p_is_on = false;
+	uint32_t fuzz_mark = 0;
+	const char *coverage_file = nullptr;	// write the edge coverage map here at exit.
+	const char *trace_file = nullptr;	// write a binary trace of the run here.
+	bool C_is_on = false;		// enable the compressed instructions.
+	bool S_is_on = false;		// emulate the system calls.
+	std::ostream *trace_os, *regs_os, *memory_os, *warnings_os;
+	char **inputs;			// the input files of -f
+	int input_count;
+};
+
+/**
+ * Runs the loaded program on a hart of XLEN bits as the options say.
+ *
+ * @param o are the options.
+ * @param mem is the memory, the program already loaded.
+ * @param elf is the ELF file, or a loader that loaded nothing.
+ * @param image_end is the address after the end of the loaded program.
+ *
+ * @return the exit status of the simulator.
+ ********************************************************************/
+template<uint32_t XLEN>
+static int simulate(const options &o, memory &mem, const elf_loader &elf, uint64_t image_end)
+{
+	bool i_is_on = o.i_is_on;
+	bool r_is_on = o.r_is_on;
+
+	rv_hart<XLEN> sim(&mem);
+	sim.set_engine(static_cast<typename rv_hart<XLEN>::engine_kind>(o.engine));
+	sim.set_entry(elf.get_entry());
+	sim.set_compressed(o.C_is_on || elf.uses_compressed());
+	sim.set_output(o.trace_os);
+	sim.set_dump_output(o.regs_os);
+
+	// the break starts after the program
+	std::unique_ptr<syscalls> sys;
+	if (o.S_is_on)
+	{
+		sys.reset(new syscalls(&mem, image_end, XLEN == 64));
+		sim.set_syscalls(sys.get());
+	}
+
+	// a dropped stream is not rendered at all
+	i_is_on = i_is_on && o.trace_os;
+	r_is_on = r_is_on && o.regs_os;
+
+	if(r_is_on)
+	{
+		sim.set_show_registers(true);
+	}
+
+	if(o.d_is_on)
+	{
+		sim.disasm(&elf);
+		sim.reset();
+	}
+
+	if(i_is_on)
+		sim.set_show_instructions(true);
+
+	// Edge coverage goes to the AFL shared memory segment if there is
+	// one, and to the -c file at exit if asked for.
+	coverage cov;
+	const char *shm_id = getenv("__AFL_SHM_ID");
+	bool cov_shared = shm_id && cov.attach(atoi(shm_id));
+
+	if (o.coverage_file || cov_shared)
+		sim.set_coverage(cov.get_map());
+
+	int status = 0;
+
+	if(o.f_is_on)
+	{
+		if ((uint64_t)o.fuzz_buffer + o.fuzz_len > mem.get_size())
+			usage();
+
+		fuzzer<XLEN> fuzz(&sim, &mem, o.fuzz_buffer, o.fuzz_len);
+		if (!fuzz.prepare(o.p_is_on ? o.fuzz_mark : elf.get_entry()))
+			return 1;
+		status = fuzz.run_files(o.inputs, o.input_count, o.exec_limit);
+	}
+	else
+	{
+		trace_writer trace;
+		std::unique_ptr<async_tracer<XLEN>> tracer;
+
+		if (o.trace_file)
+		{
+			if (!trace.open(o.trace_file, mem.get_size(), elf.get_entry(), sim.is_compressed(), XLEN == 64))
+				return 1;
+			sim.set_trace_writer(&trace);
+		}
+		else if (i_is_on || r_is_on)
+		{
+			// The text of -i and -r is rendered on a thread of its
+			// own, which also prints the warnings of the memory.
+			tracer.reset(new async_tracer<XLEN>(mem.get_size(), elf.get_entry(), sim.is_compressed(),
+				i_is_on ? o.trace_os : nullptr, r_is_on ? o.regs_os : nullptr, o.warnings_os));
+			sim.set_tracer(tracer.get());
+			mem.set_warnings(nullptr);
+		}
+
+		if(o.exec_limit != 0)
+			sim.run(o.exec_limit);
+		else
+			sim.run(0);
+
+		if (o.trace_file && !trace.finish(sim.get_insn_counter()))
+			status = 1;
+
+		// a program that calls exit gives the status of the simulator
+		if (status == 0 && sim.has_exited())
+			status = sim.get_exit_status();
+
+		mem.set_warnings(o.warnings_os);
+
+		if(o.z_is_on)
+		{
+			sim.dump();
+			if (o.memory_os)
+				mem.dump(*o.memory_os);
+		}
+	}
+
+	if (o.coverage_file && !cov.save(o.coverage_file))
+		status = 1;
+
+	return status;
+}
+
+/**
+ * Read a file of RV32I (or RV64I) instructions (a flat binary loaded at
+ * address 0 or an ELF executable) and execute them.
+ ********************************************************************/
+int main(int argc, char **argv)
+{	
+	uint64_t memory_limit = 0x1000; // default memory size = 4k
+	bool m_is_on = false;
+	bool s_is_on = false;		// use the sparse memory backend.
+	bool u_is_on = false;		// flush the output after every line.
+	uint32_t xlen = 0;		// 32 or 64, 0 until -x or the ELF file says
+	options o;
+
+	// Where the text goes: -d and -i to trace, -r and the hart of -z
+	// to regs, the memory of -z to memory and the warnings of the
+	// memory to warnings. "-" is stdout and "" drops the stream.
+	std::string trace_dest = "-";
+	std::string regs_dest = "-";
+	std::string memory_dest = "-";
+	std::string warnings_dest = "-";
 
 	int opt;
 
-	while ((opt = getopt(argc, argv, "irzdl:m:")) != -1)
+	while ((opt = getopt(argc, argv, "CSirzdsul:m:e:f:p:c:t:o:x:")) != -1)
 	{
 		switch (opt)
 		{
+		case 'C':
+			o.C_is_on = true;
+			break;
+		case 'S':
+			o.S_is_on = true;
+			break;
 		case 'i':
-			i_is_on = true;
+			o.i_is_on = true;
 			break;
 		case 'r':
-			r_is_on = true;
+			o.r_is_on = true;
 			break;
 		case 'z':
-			z_is_on = true;
+			o.z_is_on = true;
 			break;
 		case 'd':
-			d_is_on = true;
+			o.d_is_on = true;
+			break;
+		case 's':
+			s_is_on = true;
+			break;
+		case 'u':
+			u_is_on = true;
 			break;
 		case 'l':
-			exec_limit = std::stoul(optarg, nullptr, 10);
+			o.exec_limit = std::stoul(optarg, nullptr, 10);
 			break;
 		case 'm':
-			memory_limit = std::stoul(optarg, nullptr, 16);
+			memory_limit = std::stoull(optarg, nullptr, 16);
+			if (memory_limit > 0x100000000)
+				usage();
+			m_is_on = true;
+			break;
+		case 'e':
+			if (std::string(optarg) == "switch")
+				o.engine = rv32i::engine_switch;
+			else if (std::string(optarg) == "cached")
+				o.engine = rv32i::engine_cached;
+			else if (std::string(optarg) == "threaded")
+				o.engine = rv32i::engine_threaded;
+			else if (std::string(optarg) == "block")
+				o.engine = rv32i::engine_block;
+			else if (std::string(optarg) == "jit")
+				o.engine = rv32i::engine_jit;
+			else
+				usage();
+			break;
+		case 'f':
+			{
+				std::string arg(optarg);
+				size_t colon = arg.find(':');
+				if (colon == std::string::npos)
+					usage();
+				o.fuzz_buffer = std::stoul(arg.substr(0, colon), nullptr, 16);
+				o.fuzz_len = std::stoul(arg.substr(colon + 1), nullptr, 16);
+				o.f_is_on = true;
+			}
+			break;
+		case 't':
+			o.trace_file = optarg;
+			break;
+		case 'c':
+			o.coverage_file = optarg;
+			break;
+		case 'p':
+			o.fuzz_mark = std::stoul(optarg, nullptr, 16);
+			o.p_is_on = true;
+			break;
+		case 'o':
+			{
+				std::string arg(optarg);
+				size_t eq = arg.find('=');
+				if (eq == std::string::npos)
+					usage();
+				std::string stream = arg.substr(0, eq);
+				if (stream == "trace")
+					trace_dest = arg.substr(eq + 1);
+				else if (stream == "regs")
+					regs_dest = arg.substr(eq + 1);
+				else if (stream == "memory")
+					memory_dest = arg.substr(eq + 1);
+				else if (stream == "warnings")
+					warnings_dest = arg.substr(eq + 1);
+				else
+					usage();
+			}
+			break;
+		case 'x':
+			if (std::string(optarg) == "32")
+				xlen = 32;
+			else if (std::string(optarg) == "64")
+				xlen = 64;
+			else
+				usage();
 			break;
 		default: /* '?' */
 			usage();
@@ -63,38 +309,49 @@ int main(int argc, char **argv)
 
 	if (optind >= argc)
 		usage();
+	o.inputs = argv + optind + 1;
+	o.input_count = argc - optind - 1;
 
-	memory mem(memory_limit);
+	// An ELF file is linked for addresses of its own (0x10000 and up
+	// by default), so without -m it gets the whole address space.
+	bool is_elf = elf_loader::is_elf(argv[optind]);
+	if (is_elf && !m_is_on)
+		s_is_on = true;
 
-	if (!mem.load_file(argv[optind]))
-		usage();
+	if (s_is_on && !m_is_on)
+		memory_limit = 0x100000000;	// the whole address space
 
-	rv32i sim(&mem);
+	// std::cout goes through the sink of stdout from here on
+	sink_table sinks;
 
-	if(r_is_on)
-	{
-		sim.set_show_registers(true);
-	}
-
-	if(d_is_on)
-	{
-		sim.disasm();
-		sim.reset();
-	}
+	if (!sinks.open(trace_dest, o.trace_os) || !sinks.open(regs_dest, o.regs_os)
+		|| !sinks.open(memory_dest, o.memory_os) || !sinks.open(warnings_dest, o.warnings_os))
+		return 1;
+	if (u_is_on)
+		sinks.set_flush_policy(sink::flush_line);
 
-	if(i_is_on)
-		sim.set_show_instructions(true);
+	memory mem(memory_limit, s_is_on);
+	mem.set_warnings(o.warnings_os);
 
-	if(exec_limit != 0)
-		sim.run(exec_limit);
-	else
-		sim.run(0);
+	elf_loader elf;
+	uint64_t image_end;
 
-	if(z_is_on)
+	if (is_elf)
 	{
-		sim.dump();
-		mem.dump();
+		if (!elf.load(argv[optind], &mem))
+			return 1;
+		image_end = elf.get_image_end();
+		o.S_is_on = true;
+		if (xlen == 0)
+			xlen = elf.is_rv64() ? 64 : 32;
 	}
+	else if (!mem.load_file(argv[optind], image_end))
+		return 1;
+
+	int status = xlen == 64 ? simulate<64>(o, mem, elf, image_end) : simulate<32>(o, mem, elf, image_end);
+
+	if (!sinks.flush())
+		status = 1;
 
-	return 0;
+	return status;
 }
@@ -3,209 +3,853 @@
 #include <sstream>
 #include <cstdint>
 #include <iostream>
-#include <fstream>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /**
  * Checks if the given address is in the simulated memory. If it is not
- * it prints a warning message to stdout.                              
+ * it prints a warning message to stdout (see set_warnings().)         
  * 								      
  * @param i is the given address in which to check.		      
  * 								      
  * @return true or false.					      
  ***********************************************************************/
-bool memory::check_address(uint32_t i) const
+bool memory::check_address(uint64_t i) const
 {
 	bool found = false;
 	if (i < size) found = true;
 
-	if(found == false)
+	if(found == false && warnings)
 	{
-		std::cout << "WARNING: Address out of range: " << hex0x32(i) << std::endl;
+		*warnings << "WARNING: Address out of range: " <<
+			(i >> 32 ? hex0x64(i) : hex0x32(i)) << '\n';
 	}
 
 	return found;		
 }
 
 /**
- * @return the rounded up siz value in uint32_t.
+ * Sends the warnings of check_address() to another stream, or turns
+ * them off.
+ *
+ * @param os is the stream, or nullptr for no warnings.
  ***********************************************************************/
-uint32_t memory::get_size() const
+void memory::set_warnings(std::ostream *os)
+{
+	warnings = os;
+}
+
+/**
+ * Sets the width of the addresses of the hart: when an access that is
+ * not entirely in range is split into bytes, the address of each byte
+ * wraps around at 2^xlen, like the address arithmetic of the hart.
+ *
+ * @param xlen is 32 (the default) or 64.
+ ***********************************************************************/
+void memory::set_xlen(uint32_t xlen)
+{
+	addr_mask = xlen == 32 ? 0xffffffff : ~(uint64_t)0;
+}
+
+/**
+ * @return the rounded up siz value.
+ ***********************************************************************/
+uint64_t memory::get_size() const
 {
 	return size;
 }
 
+uint8_t memory::absent_mark;
+
+/**
+ * Allocates the buffer of the flat backend, with every byte reading as
+ * 0xa5, in one of two ways:
+ *	- a small buffer is given to transparent huge pages when it is
+ *	  at least 2 MiB, so that the run takes one page fault and one
+ *	  TLB entry per 2 MiB instead of per 4 KiB, and then filled with
+ *	  a single memset(), which the C library does with the widest
+ *	  stores the host has.
+ *	- a buffer of lazy_fill_size or more is covered with private
+ *	  mappings of one chunk of 0xa5 bytes (see map_pattern()), so
+ *	  that nothing is filled up front and a page only gets a copy of
+ *	  its own the first time it is written.
+ *
+ * @param len is the size of the buffer.
+ *
+ * @return the buffer.
+ ***********************************************************************/
+uint8_t *memory::alloc_flat(uint64_t len)
+{
+	if(len == 0)
+		return nullptr;
+
+	void *p = mmap(nullptr, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if(p == MAP_FAILED)
+		throw std::bad_alloc();
+
+	if(len >= lazy_fill_size && map_pattern(p, len))
+		return static_cast<uint8_t *>(p);
+
+#ifdef MADV_HUGEPAGE
+	if(len >= huge_page_size)
+		madvise(p, len, MADV_HUGEPAGE);
+#endif
+
+	memset(p, 0xa5, len);
+	return static_cast<uint8_t *>(p);
+}
+
+/**
+ * Fills a memory file of pattern_size bytes with 0xa5 and maps it
+ * privately over every pattern_size bytes of the buffer at p. Reads
+ * of a page that was never written share the page of the file, and
+ * the first write to a page gives it a private copy. When this fails
+ * part way, the pages that were mapped still read as 0xa5, so the
+ * caller can fall back to filling the whole buffer.
+ *
+ * @param p is the buffer.
+ * @param len is the size of the buffer.
+ *
+ * @return true if the whole buffer is mapped.
+ ***********************************************************************/
+bool memory::map_pattern(void *p, uint64_t len)
+{
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+	int fd = memfd_create("rv32i-fill", MFD_CLOEXEC);
+	if(fd < 0)
+		return false;
+
+	bool ok = false;
+	if(ftruncate(fd, pattern_size) == 0)
+	{
+		void *chunk = mmap(nullptr, pattern_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+		if(chunk != MAP_FAILED)
+		{
+			memset(chunk, 0xa5, pattern_size);
+			munmap(chunk, pattern_size);
+			ok = true;
+		}
+	}
+
+	for(uint64_t off = 0; ok && off < len; off += pattern_size)
+	{
+		uint64_t n = len - off < pattern_size ? len - off : pattern_size;
+		ok = mmap(static_cast<uint8_t *>(p) + off, n, PROT_READ|PROT_WRITE,
+			MAP_PRIVATE|MAP_FIXED, fd, 0) != MAP_FAILED;
+	}
+
+	close(fd);
+	return ok;
+#else
+	(void)p;
+	(void)len;
+	return false;
+#endif
+}
+
+/**
+ * Frees a buffer made by alloc_flat().
+ *
+ * @param p is the buffer or nullptr.
+ * @param len is the size of the buffer.
+ ***********************************************************************/
+void memory::free_flat(uint8_t *p, uint64_t len)
+{
+	if(p)
+		munmap(p, len);
+}
+
+/**
+ * Tells if the page holding addr exists. All the pages of the flat
+ * backend exist, the sparse backend only has the pages that have been
+ * written to.
+ *
+ * @param addr is the given address.
+ *
+ * @return true if addr is in range and its page exists.
+ ***********************************************************************/
+bool memory::is_present(uint64_t addr) const
+{
+	if(addr >= size)
+		return false;
+	return mem || find_page(addr);
+}
+
+/**
+ * Finds where the run of pages that do not exist, starting with the
+ * page of addr, ends. The run also ends where the bytes the absent
+ * pages read as change (see absent_fill()), so that it is all fill.
+ *
+ * @param addr is the first address of the run, its page must not exist.
+ * @param fill is set to the value every byte of the run reads as.
+ *
+ * @return the address after the last page of the run.
+ ***********************************************************************/
+uint64_t memory::absent_run(uint64_t addr, uint8_t &fill) const
+{
+	uint64_t end = addr & ~(uint64_t)(page_size - 1);
+	fill = absent_fill(end);
+	while(end < size && !is_present(end) && absent_fill(end) == fill)
+		end += page_size;
+	return end < size ? end : size;
+}
+
+/**
+ * Looks up the page of the sparse backend that holds addr.
+ *
+ * @param addr is the given address.
+ *
+ * @return the page or nullptr if it has not been created yet.
+ ***********************************************************************/
+const uint8_t *memory::find_page(uint32_t addr) const
+{
+	uint8_t * const *table = dir[addr >> 22];
+	return table ? table[(addr >> 12) & (dir_entries-1)] : nullptr;
+}
+
+/**
+ * Tells what the bytes of a page of the sparse backend that does not
+ * exist yet read as: zero inside the ranges given to zero_block(),
+ * 0xa5 everywhere else.
+ *
+ * @param addr is the given address.
+ *
+ * @return the value of the bytes of the page.
+ ***********************************************************************/
+uint8_t memory::absent_fill(uint32_t addr) const
+{
+	for(const auto &r : zero_ranges)
+		if(addr >= r.first && addr < r.second)
+			return 0;
+	return 0xa5;
+}
+
 /**
- * Checks to see if the given addr is in the memory by calling	     
- * the check_address() method. If the address is in the valid range,  
- * return the value of the byte from the simulated memory at that     
- * address. Otherwise, addr is not in the valid range then return     
- * zero to the caller.						     
+ * Returns the page of the sparse backend that holds addr, creating it
+ * and filling it with absent_fill() if it does not exist yet. It is
+ * only called to write to the page, so it also calls note_write().
+ *
+ * @param addr is the given address.
+ *
+ * @return the page.
+ ***********************************************************************/
+uint8_t *memory::touch_page(uint32_t addr)
+{
+	note_write(addr);
+
+	uint8_t **&table = dir[addr >> 22];
+	if(!table)
+	{
+		table = new uint8_t*[dir_entries];
+		for(uint32_t i = 0; i < dir_entries; i++)
+			table[i] = nullptr;
+	}
+
+	uint8_t *&page = table[(addr >> 12) & (dir_entries-1)];
+	if(!page)
+	{
+		uint8_t fill = absent_fill(addr);
+		page = new uint8_t[page_size];
+		memset(page, fill, page_size);
+	}
+	return page;
+}
+
+/**
+ * The byte at a time version of get8(). Checks to see if the given
+ * addr is in the memory by calling the check_address() method. If the
+ * address is in the valid range, return the value of the byte from
+ * the simulated memory at that address. Otherwise, addr is not in the
+ * valid range then return zero to the caller.						     
  *								     
  * @param addr is the given address.				     
  *								     
  * @return value of the byte or 0 if invalid.			     
  **********************************************************************/
-uint8_t memory::get8(uint32_t addr) const
+uint8_t memory::get8_slow(uint64_t addr) const
 {
 	uint8_t value = 0;
 	if(check_address(addr))
 	{
-		value = mem[addr];
+		if(mem)
+			value = mem[addr];
+		else
+		{
+			const uint8_t *page = find_page(addr);
+			value = page ? page[addr & (page_size-1)] : absent_fill(addr);
+		}
 	}
 	
 	return value;
 }
 
 /**
- * Calls the get8() function twice to get two bytes and then combines 
- * them in little-endian order to create a 16-bit return value.       
+ * The byte at a time version of get16(), for accesses that are not
+ * entirely in range. Calls get8_slow() twice to get two bytes and
+ * then combines them in little-endian order to create a 16-bit return
+ * value.
  *								     
  * @param addr is the given address.				     
  * 								     
  * @return the 16 bit value created by combining the bytes.	     
  **********************************************************************/
-uint16_t memory::get16(uint32_t addr) const
+uint16_t memory::get16_slow(uint64_t addr) const
 {
-	uint16_t value = get8(addr) | ((uint16_t) get8(addr+1) << 8);
+	if(!mem && addr < size && size - addr >= 2 && (addr & (page_size-1)) <= page_size-2)
+	{
+		// in range and within one page of the sparse backend
+		const uint8_t *p = find_page(addr);
+		if(!p)
+			return absent_fill(addr) * 0x0101;
+		p += addr & (page_size-1);
+		return p[0] | (p[1] << 8);
+	}
+
+	uint16_t value = get8_slow(addr) | ((uint16_t) get8_slow((addr+1) & addr_mask) << 8);
 	return value;
 }
 
 /**
- * Calls the get16() function twice to get two bytes and then combines
- * them in little-endian order to create a 32-bit return value.       
+ * The byte at a time version of get32(), for accesses that are not
+ * entirely in range. Calls get16_slow() twice and then combines them
+ * in little-endian order to create a 32-bit return value.
  *								     
  * @param addr is the given address.				     
  * 								     
  * @return the 32 bit value created by combining the bytes.	     
  **********************************************************************/
-uint32_t memory::get32(uint32_t addr) const
+uint32_t memory::get32_slow(uint64_t addr) const
 {
-	uint32_t value =  get16(addr) | ((uint32_t) get16(addr+2) << 16);
+	if(!mem && addr < size && size - addr >= 4 && (addr & (page_size-1)) <= page_size-4)
+	{
+		// in range and within one page of the sparse backend
+		const uint8_t *p = find_page(addr);
+		if(!p)
+			return absent_fill(addr) * 0x01010101u;
+		p += addr & (page_size-1);
+		return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	uint32_t value =  get16_slow(addr) | ((uint32_t) get16_slow((addr+2) & addr_mask) << 16);
 	return value;
 }
 
 /**
- * Calls check_address() to verify if the addr argument is valid.     
+ * The byte at a time version of get64(), for accesses that are not
+ * entirely in range. Calls get32_slow() twice and then combines them
+ * in little-endian order to create a 64-bit return value.
+ *
+ * @param addr is the given address.
+ *
+ * @return the 64 bit value created by combining the words.
+ **********************************************************************/
+uint64_t memory::get64_slow(uint64_t addr) const
+{
+	return get32_slow(addr) | (uint64_t)get32_slow((addr+4) & addr_mask) << 32;
+}
+
+/**
+ * The byte at a time version of set8(). Calls check_address() to
+ * verify if the addr argument is valid.
  * If it is, it sets the byte in memory at that address to the given  
  * val. If not, it discards the data and return to the caller.	     
  *								     
  * @param addr is the given address.				     
  * @param val is the given value.				     
  **********************************************************************/
-void memory::set8(uint32_t addr, uint8_t val)
+void memory::set8_slow(uint64_t addr, uint8_t val)
 {
-	if(check_address(addr)) mem[addr] = val;
+	if(check_address(addr))
+	{
+		if(mem)
+		{
+			note_write(addr);
+			mem[addr] = val;
+		}
+		else
+			touch_page(addr)[addr & (page_size-1)] = val;
+	}
 }
 
 /**
- * Calls set8() twice to store the given val in little-endian order   
- * into the simulated memory starting at the address given in the     
+ * The byte at a time version of set16(), for accesses that are not
+ * entirely in range. Calls set8_slow() twice to store the given val
+ * in little-endian order into the simulated memory starting at the address given in the     
  * addr argument.						     
  *						 		     
  * @param addr is the given address.				     
  * @param val is the given value.				     
  **********************************************************************/
-void memory::set16(uint32_t addr, uint16_t val)
+void memory::set16_slow(uint64_t addr, uint16_t val)
 {
+	if(!mem && addr < size && size - addr >= 2 && (addr & (page_size-1)) <= page_size-2)
+	{
+		// in range and within one page of the sparse backend
+		uint8_t *p = touch_page(addr) + (addr & (page_size-1));
+		p[0] = val;
+		p[1] = val >> 8;
+		return;
+	}
+
 	// Set MSB
 	uint8_t msb = static_cast<uint8_t>((val & 0xFF00) >> 8);
-	set8(addr+1, msb);
+	set8_slow((addr+1) & addr_mask, msb);
 
 	// Set LSB
 	uint8_t lsb = static_cast<uint8_t>(val & 0x00FF);
-	set8(addr, lsb);
+	set8_slow(addr, lsb);
 }
 
 /**
- * Calls set16() twice to store the given val in little-endian order  
- * into the simulated memory starting at the address given in the     
+ * The byte at a time version of set32(), for accesses that are not
+ * entirely in range. Calls set16_slow() twice to store the given val
+ * in little-endian order into the simulated memory starting at the address given in the     
  * addr argument.						     
  *						 		     
  * @param addr is the given address.				     
  * @param val is the given value.				     
  *********************************************!*************************/
-void memory::set32(uint32_t addr, uint32_t val)
+void memory::set32_slow(uint64_t addr, uint32_t val)
 {
+	if(!mem && addr < size && size - addr >= 4 && (addr & (page_size-1)) <= page_size-4)
+	{
+		// in range and within one page of the sparse backend
+		uint8_t *p = touch_page(addr) + (addr & (page_size-1));
+		p[0] = val;
+		p[1] = val >> 8;
+		p[2] = val >> 16;
+		p[3] = val >> 24;
+		return;
+	}
+
 	// Set MSB
 	uint16_t msb = static_cast<uint16_t>((val & 0xFFFF0000) >> 16);
-	set16(addr+2, msb);
+	set16_slow((addr+2) & addr_mask, msb);
 
 	// Set LSB
 	uint16_t lsb = static_cast<uint16_t>(val & 0x0000FFFF);
-	set16(addr, lsb);
+	set16_slow(addr, lsb);
+}
+
+/**
+ * The byte at a time version of set64(), for accesses that are not
+ * entirely in range. Calls set32_slow() twice to store the given val
+ * in little-endian order.
+ *
+ * @param addr is the given address.
+ * @param val is the given value.
+ **********************************************************************/
+void memory::set64_slow(uint64_t addr, uint64_t val)
+{
+	set32_slow((addr+4) & addr_mask, val >> 32);
+	set32_slow(addr, val);
 }
 
 /**
  * Dumps the entire contents of the simulated memory in hex with ASCII
- * on the right.
+ * on the right. With the sparse backend a run of pages that were never
+ * written is dumped as a single line with its range and the value its
+ * bytes read as. Each line of 16 bytes is rendered into a text_line and
+ * written in one piece.
+ *
+ * @param os is the stream to dump to.
+ **********************************************************************/
+void memory::dump(std::ostream &os) const
+{
+	for (uint64_t i = 0; i < size; i += 16)
+	{
+		if (i%page_size == 0 && !is_present(i))
+		{
+			uint8_t fill;
+			uint64_t end = absent_run(i, fill);
+			text_line line;
+			line.hex32(i) << '-';
+			line.hex32(end - 1) << ": never written, all ";
+			line.hex8(fill) << '\n';
+			os << line;
+			i = end - 16;
+			continue;
+		}
+
+		char ascii[16];
+		text_line line;
+		line.hex32(i) << ": ";
+
+		for (uint32_t j = 0; j < 16; ++j)
+		{
+			uint8_t ch = get8(i + j);
+			ascii[j] = isprint(ch) ? ch : '.';
+
+			if (j == 8)
+				line << ' ';
+			line.hex8(ch) << " ";
+		}
+
+		line << '*';
+		for (char c : ascii)
+			line << c;
+		line << "*\n";
+		os << line;
+	}
+}
+
+/**
+ * Copies len bytes from src into the simulated memory starting at addr,
+ * with one bulk copy per page (the whole range with the flat backend.)
+ * The range must be inside the memory.
+ *
+ * @param addr is the first address to write.
+ * @param src is the data to copy.
+ * @param len is the number of bytes to copy.
+ **********************************************************************/
+void memory::set_block(uint64_t addr, const uint8_t *src, uint64_t len)
+{
+	if(mem)
+	{
+		note_range(addr, len);
+		memcpy(mem + addr, src, len);
+		return;
+	}
+
+	while(len > 0)
+	{
+		uint64_t n = page_size - (addr & (page_size-1));
+		if(n > len)
+			n = len;
+		memcpy(touch_page(addr) + (addr & (page_size-1)), src, n);
+		addr += n;
+		src += n;
+		len -= n;
+	}
+}
+
+/**
+ * Copies len bytes starting at addr out of the memory, a page at a time
+ * with the sparse backend. The range must be inside the memory.
+ *
+ * @param addr is the first address to copy from.
+ * @param dst is where to copy the bytes to.
+ * @param len is the number of bytes.
+ **********************************************************************/
+void memory::get_block(uint64_t addr, uint8_t *dst, uint64_t len) const
+{
+	if(mem)
+	{
+		memcpy(dst, mem + addr, len);
+		return;
+	}
+
+	while(len > 0)
+	{
+		uint64_t n = page_size - (addr & (page_size-1));
+		if(n > len)
+			n = len;
+		const uint8_t *page = find_page(addr);
+		if(page)
+			memcpy(dst, page + (addr & (page_size-1)), n);
+		else
+			memset(dst, absent_fill(addr), n);
+		addr += n;
+		dst += n;
+		len -= n;
+	}
+}
+
+/**
+ * Gives the host bytes of a range of the flat memory, so that they can
+ * be handed to a host system call in place. The range must be inside
+ * the memory.
+ *
+ * @param addr is the first address of the range.
+ * @param len is the number of bytes.
+ *
+ * @return the bytes, or nullptr with the sparse backend (whose pages
+ * are not contiguous, see get_block().)
+ **********************************************************************/
+const uint8_t *memory::read_span(uint64_t addr, uint64_t len) const
+{
+	(void)len;
+	return mem ? mem + addr : nullptr;
+}
+
+/**
+ * Like read_span(), for bytes that are about to be written in place:
+ * their pages are marked as written, for restore().
+ *
+ * @param addr is the first address of the range.
+ * @param len is the number of bytes.
+ *
+ * @return the bytes, or nullptr with the sparse backend (see
+ * set_block().)
+ **********************************************************************/
+uint8_t *memory::write_span(uint64_t addr, uint64_t len)
+{
+	if(!mem)
+		return nullptr;
+	note_range(addr, len);
+	return mem + addr;
+}
+
+/**
+ * Sets len bytes starting at addr to zero. The flat backend clears
+ * them right away. The sparse backend only clears the pages that exist
+ * and the ends of the range that do not cover a whole page; the other
+ * pages are left out and will read as zero, and be created full of
+ * zeros when first written. After a snapshot() every page is cleared
+ * right away, so that restore() can undo it. The range must be inside
+ * the memory.
+ *
+ * @param addr is the first address to clear.
+ * @param len is the number of bytes to clear.
  **********************************************************************/
-void memory::dump() const
+void memory::zero_block(uint64_t addr, uint64_t len)
+{
+	if(mem)
+	{
+		note_range(addr, len);
+		memset(mem + addr, 0, len);
+		return;
+	}
+
+	uint64_t a = addr;
+	uint64_t end = a + len;
+	uint64_t lazy_begin = end;
+	uint64_t lazy_end = end;
+
+	while(a < end)
+	{
+		uint64_t off = a & (page_size-1);
+		uint64_t n = page_size - off;
+		if(n > end - a)
+			n = end - a;
+
+		if(n < page_size || find_page(a) || snapshot_taken)
+			memset(touch_page(a) + off, 0, n);
+		else
+		{
+			if(lazy_begin == end)
+				lazy_begin = a;
+			lazy_end = a + n;
+		}
+		a += n;
+	}
+
+	if(lazy_begin < lazy_end)
+		zero_ranges.push_back(std::make_pair(lazy_begin, lazy_end));
+}
+
+/**
+ * Adds the page holding addr to the list of pages written since the
+ * last snapshot() or restore(). After a snapshot(), the first time a
+ * page is written its contents are also saved, so that restore() can
+ * put them back. A page of the sparse backend that does not exist yet
+ * is saved as absent_mark.
+ *
+ * @param addr is an address about to be written.
+ ***********************************************************************/
+void memory::mark_dirty(uint32_t addr)
+{
+	uint32_t page = addr >> page_bits;
+	dirty[page] = 1;
+	dirty_pages.push_back(page);
+
+	if(!snapshot_taken || saved[page])
+		return;
+
+	uint64_t base = (uint64_t)page << page_bits;
+	const uint8_t *src = mem ? mem + base : find_page(addr);
+	if(src)
+	{
+		uint64_t len = size - base < page_size ? size - base : page_size;
+		saved[page] = new uint8_t[page_size];
+		memcpy(saved[page], src, len);
+	}
+	else
+		saved[page] = &absent_mark;
+	saved_pages.push_back(page);
+}
+
+/**
+ * Calls note_write() for every page of the len bytes starting at addr.
+ *
+ * @param addr is the first address about to be written.
+ * @param len is the number of bytes about to be written.
+ ***********************************************************************/
+void memory::note_range(uint32_t addr, uint64_t len)
 {
-	char ascii[17];
-	ascii[16] = '\0';
+	if(len == 0)
+		return;
+
+	uint64_t last = ((uint64_t)addr + len - 1) >> page_bits;
+	for(uint64_t page = addr >> page_bits; page <= last; ++page)
+		note_write(page << page_bits);
+}
 
-	for (uint32_t i = 0; i < size; ++i)
+/**
+ * Frees the pages saved since the last snapshot().
+ ***********************************************************************/
+void memory::free_saved()
+{
+	for(uint32_t page : saved_pages)
 	{
-		if (i!=0 && i%16==0)
-			std::cout << '*' << ascii << '*' << std::endl;
+		if(saved[page] != &absent_mark)
+			delete[] saved[page];
+		saved[page] = nullptr;
+	}
+	saved_pages.clear();
+}
 
-		uint8_t ch = get8(i);
-		ascii[i%16] = isprint(ch) ? ch : '.';
+/**
+ * Takes a snapshot of the contents of the memory. Nothing is copied
+ * here: the pages are saved one at a time by mark_dirty() when they
+ * are first written, so the cost of a snapshot is the number of pages
+ * that change after it. A new snapshot replaces the previous one.
+ ***********************************************************************/
+void memory::snapshot()
+{
+	for(uint32_t page : dirty_pages)
+		dirty[page] = 0;
+	dirty_pages.clear();
+	free_saved();
+	snapshot_taken = true;
+}
 
-		if (i%16 == 0)
-			std::cout << hex32(i) << ": ";
-		else if (i%8 == 0)
-			std::cout << ' ';
+/**
+ * Puts back the contents that the memory had at the last snapshot(),
+ * by rewriting only the pages written since then (or since the last
+ * restore().) The saved copies are kept, so that the memory can be
+ * restored again and again to the same snapshot.
+ *
+ * @return false if there is no snapshot.
+ ***********************************************************************/
+bool memory::restore()
+{
+	if(!snapshot_taken)
+		return false;
 
-		std::cout << hex8(ch) << " ";
+	for(uint32_t page : dirty_pages)
+	{
+		uint64_t base = (uint64_t)page << page_bits;
+		const uint8_t *copy = saved[page];
+		dirty[page] = 0;
+
+		if(mem)
+			memcpy(mem + base, copy, size - base < page_size ? size - base : page_size);
+		else
+		{
+			uint8_t *&p = dir[page >> 10][page & (dir_entries-1)];
+			if(copy == &absent_mark)
+			{
+				delete[] p;
+				p = nullptr;
+			}
+			else
+				memcpy(p, copy, page_size);
+		}
 	}
-	if(size > 0)
-		std::cout << '*' << ascii << '*' << std::endl;
+	dirty_pages.clear();
+	return true;
+}
+
+/**
+ * Accessor for the pages written since the last snapshot() or
+ * restore(), in the order they were first written.
+ *
+ * @return the page numbers (address / 4096) of the pages.
+ ***********************************************************************/
+const std::vector<uint32_t> &memory::get_dirty_pages() const
+{
+	return dirty_pages;
 }
 
 /**
- * Opens the file named fname in binary mode and read its contents    
- * into the simulated memory. If the file can not be opened, prints   
- * error message to stderr and return false. 			     
- * If the file loads OK, closes file and returns true.		     
+ * Opens the file named fname and copies its contents into the
+ * simulated memory starting at address zero. A regular file is
+ * mmap()ed and copied with set_block(), and its size is checked against
+ * the memory size once, before anything is copied. Anything else (a
+ * pipe for instance) is read() in large chunks. If the file can not be
+ * opened, prints error message to stderr and return false. If the file
+ * does not fit, prints the same warning as an out of range access at
+ * the first address that does not fit and return false.
+ * If the file loads OK, closes file and returns true.
  *								     
  * @param fname is the name of the file to be opened.		     
+ * @param loaded is set to the number of bytes loaded.
  *								     
  * @return true or false, based on the file.			     
  **********************************************************************/
-bool memory::load_file(const std::string &fname)
+bool memory::load_file(const std::string &fname, uint64_t &loaded)
 {
+	loaded = 0;
+
 	// Open the file
-	std::ifstream infile(fname, std::ios::in|std::ios::binary);
+	int fd = open(fname.c_str(), O_RDONLY);
+	struct stat st;
 
-	if (!infile)
+	if (fd < 0 || fstat(fd, &st) != 0)
 	{
 		std::cerr << "Can\'t open file \'" << fname << "\' for reading.\n";
+		if (fd >= 0)
+			close(fd);
 		return false;
 	}
-	else
+
+	bool ok = true;
+	uint64_t address = 0;
+
+	if (S_ISREG(st.st_mode))
 	{
-		uint8_t value;
-		// Store the first address
-		uint32_t address = 0;
+		uint64_t len = st.st_size;
 
-		// Loop until EOF
-		while(infile.read((char*)&value, 1))
+		if (len > size)
 		{
-			if(check_address(address))
+			check_address(size);
+			std::cerr << "Program too big.\n";
+			ok = false;
+		}
+		else if (len > 0)
+		{
+			void *p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p == MAP_FAILED)
 			{
-				set8(address, value);
-				address++;	// Go to next address
+				std::cerr << "Can\'t open file \'" << fname << "\' for reading.\n";
+				ok = false;
 			}
 			else
 			{
+				set_block(0, static_cast<const uint8_t *>(p), len);
+				munmap(p, len);
+				loaded = len;
+			}
+		}
+	}
+	else
+	{
+		uint8_t buf[65536];
+		ssize_t n;
+
+		while (ok && (n = read(fd, buf, sizeof(buf))) > 0)
+		{
+			if (address + n > size)
+			{
+				check_address(size);
 				std::cerr << "Program too big.\n";
-				infile.close();
-				return false;
+				ok = false;
+			}
+			else
+			{
+				set_block(address, buf, n);
+				address += n;
+				loaded = address;
 			}
 		}
-		// If the file loads, close file
-		infile.close();
-		return true;
 	}
+
+	// If the file loads, close file
+	close(fd);
+	return ok;
 }
@@ -1,5 +1,13 @@
+#ifndef memory_H
+#define memory_H
+
 #include<cstdint>
 #include<string>
+#include<vector>
+#include<utility>
+#include<cstdlib>
+#include<new>
+#include<iostream>
 
 /*
 * The documentation of most of the functions is included in the .cpp file.
@@ -10,53 +18,308 @@ class memory
 public:
 	/**
 	 * This is the constructor of the class. It stores the value of siz in 
-	 * the size member variable. Then, it allocates siz bytes for the mem  
-	 * array and it initializes every byte to 0xa5.		  	      
+	 * the size member variable. Then, for the flat backend, it allocates
+	 * siz bytes for the mem array and it initializes every byte to 0xa5
+	 * (see alloc_flat().)
+	 * The sparse backend allocates nothing up front: its 4 KiB pages
+	 * are created and filled with 0xa5 when they are first written,
+	 * and reading a page that does not exist yet gives 0xa5 bytes.
+	 * Either way, a flag per page for snapshot() is calloc()ed, so
+	 * the host only backs the flags of the pages that get written.
 	 *								      
-	 * @param siz holds the size to initialize size.			      
+	 * @param siz holds the size to initialize size, at most 4 GiB.
+	 *
+	 * @param sparse selects the sparse backend.
 	 *								      
 	 * @note - You may implement the following rounding logic to make the  
 	 * job of formatting and aligning the last line of output in the       
 	 * dump() method easier: siz = (siz+15)&0xfffffff0;                    
 	 ***********************************************************************/
-	memory(uint32_t siz)
+	memory(uint64_t siz, bool sparse = false)
 	{
-		siz = (siz+15)&0xfffffff0;	// round the length up, mod-16
+		siz = (siz+15)&~(uint64_t)15;	// round the length up, mod-16
 		size = siz;
 
-		mem = new uint8_t[size];
+		for(uint32_t i = 0; i < dir_entries; i++)
+			dir[i] = nullptr;
+
+		uint64_t npages = (size + page_size - 1) / page_size;
+		dirty = static_cast<uint8_t *>(calloc(npages ? npages : 1, 1));
+		saved = static_cast<uint8_t **>(calloc(npages ? npages : 1, sizeof(uint8_t *)));
+		if(!dirty || !saved)
+			throw std::bad_alloc();
+		snapshot_taken = false;
+		warnings = &std::cout;
+		addr_mask = 0xffffffff;
 
-		for(uint32_t i = 0; i < size; i++)
+		if(sparse)
 		{
-			mem[i] = 0xa5;
+			mem = nullptr;
+			flat_size = 0;
+		}
+		else
+		{
+			mem = alloc_flat(size);
+			flat_size = size;
 		}
 	}
 
 	/**
 	 * This is the destructor of the class. It frees the memory that was   
-	 * allocated in the constructor to represent the simulated memory.     
+	 * allocated in the constructor (or by the sparse backend) to
+	 * represent the simulated memory.
 	 ***********************************************************************/
 	~memory()
 	{
-		delete[] mem;
+		free_flat(mem, flat_size);
+		free_saved();
+		free(dirty);
+		free(saved);
+
+		for(uint32_t i = 0; i < dir_entries; i++)
+		{
+			if(dir[i])
+			{
+				for(uint32_t j = 0; j < dir_entries; j++)
+					delete[] dir[i][j];
+				delete[] dir[i];
+			}
+		}
 	}
 
-	bool check_address(uint32_t i) const;
+	bool check_address(uint64_t i) const;
+	void set_warnings(std::ostream *os);
+	void set_xlen(uint32_t xlen);
 	
-	uint32_t get_size() const;
+	uint64_t get_size() const;
+	bool is_present(uint64_t addr) const;
+	uint64_t absent_run(uint64_t addr, uint8_t &fill) const;
+
+	/*
+	 * The accessors below are defined here so that they can be inlined
+	 * into the execution engines. Each one does a single range check,
+	 * then a little-endian access of the host buffer (assembled byte
+	 * by byte so that it is safe for any alignment and host; compilers
+	 * turn it into one load or store.) Accesses that are not entirely
+	 * inside the flat memory go to the *_slow() versions, which handle
+	 * the sparse backend, and work a byte at a time when an access is
+	 * not entirely in range, printing a warning for every byte out of
+	 * range. The stores also call note_write() for the first and the
+	 * last byte, which costs a load and a predictable branch unless
+	 * the page is written for the first time since the last
+	 * snapshot() or restore(). The addresses are 64 bits wide for an
+	 * RV64 hart; a 32 bit one passes them zero-extended, which costs
+	 * nothing, as the range check was against a 64 bit size anyway.
+	 ***************************************************************/
+
+	/**
+	 * @param addr is the given address.
+	 *
+	 * @return value of the byte or 0 if addr is out of range.
+	 ***************************************************************/
+	uint8_t get8(uint64_t addr) const
+	{
+		if(addr < flat_size)
+			return mem[addr];
+		return get8_slow(addr);
+	}
+
+	/**
+	 * @param addr is the given address.
+	 *
+	 * @return the 16-bit little-endian value at addr.
+	 ***************************************************************/
+	uint16_t get16(uint64_t addr) const
+	{
+		if(addr < flat_size && flat_size - addr >= 2)
+		{
+			const uint8_t *p = mem + addr;
+			return p[0] | (p[1] << 8);
+		}
+		return get16_slow(addr);
+	}
 
-	uint8_t get8(uint32_t addr) const;
-	uint16_t get16(uint32_t addr) const;
-	uint32_t get32(uint32_t addr) const;
+	/**
+	 * @param addr is the given address.
+	 *
+	 * @return the 32-bit little-endian value at addr.
+	 ***************************************************************/
+	uint32_t get32(uint64_t addr) const
+	{
+		if(addr < flat_size && flat_size - addr >= 4)
+		{
+			const uint8_t *p = mem + addr;
+			return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+		return get32_slow(addr);
+	}
 
-	void set8(uint32_t addr, uint8_t val);
-	void set16(uint32_t addr, uint16_t val);
-	void set32(uint32_t addr, uint32_t val);
+	/**
+	 * @param addr is the given address.
+	 *
+	 * @return the 64-bit little-endian value at addr.
+	 ***************************************************************/
+	uint64_t get64(uint64_t addr) const
+	{
+		if(addr < flat_size && flat_size - addr >= 8)
+		{
+			const uint8_t *p = mem + addr;
+			return (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)) |
+				(uint64_t)(p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24)) << 32;
+		}
+		return get64_slow(addr);
+	}
 
-	void dump() const;
+	/**
+	 * Sets the byte at addr to val, or discards it if addr is out of
+	 * range.
+	 *
+	 * @param addr is the given address.
+	 * @param val is the given value.
+	 ***************************************************************/
+	void set8(uint64_t addr, uint8_t val)
+	{
+		if(addr < flat_size)
+		{
+			note_write(addr);
+			mem[addr] = val;
+		}
+		else
+			set8_slow(addr, val);
+	}
 
-	bool load_file(const std::string &fname);
+	/**
+	 * Stores val in little-endian order at addr.
+	 *
+	 * @param addr is the given address.
+	 * @param val is the given value.
+	 ***************************************************************/
+	void set16(uint64_t addr, uint16_t val)
+	{
+		if(addr < flat_size && flat_size - addr >= 2)
+		{
+			note_write(addr);
+			note_write(addr + 1);
+			uint8_t *p = mem + addr;
+			p[0] = val;
+			p[1] = val >> 8;
+		}
+		else
+			set16_slow(addr, val);
+	}
+
+	/**
+	 * Stores val in little-endian order at addr.
+	 *
+	 * @param addr is the given address.
+	 * @param val is the given value.
+	 ***************************************************************/
+	void set32(uint64_t addr, uint32_t val)
+	{
+		if(addr < flat_size && flat_size - addr >= 4)
+		{
+			note_write(addr);
+			note_write(addr + 3);
+			uint8_t *p = mem + addr;
+			p[0] = val;
+			p[1] = val >> 8;
+			p[2] = val >> 16;
+			p[3] = val >> 24;
+		}
+		else
+			set32_slow(addr, val);
+	}
+
+	/**
+	 * Stores val in little-endian order at addr.
+	 *
+	 * @param addr is the given address.
+	 * @param val is the given value.
+	 ***************************************************************/
+	void set64(uint64_t addr, uint64_t val)
+	{
+		if(addr < flat_size && flat_size - addr >= 8)
+		{
+			note_write(addr);
+			note_write(addr + 7);
+			uint8_t *p = mem + addr;
+			for(uint32_t i = 0; i < 8; ++i)
+				p[i] = val >> 8*i;
+		}
+		else
+			set64_slow(addr, val);
+	}
+
+	void set_block(uint64_t addr, const uint8_t *src, uint64_t len);
+	void get_block(uint64_t addr, uint8_t *dst, uint64_t len) const;
+	void zero_block(uint64_t addr, uint64_t len);
+	const uint8_t *read_span(uint64_t addr, uint64_t len) const;
+	uint8_t *write_span(uint64_t addr, uint64_t len);
+
+	void snapshot();
+	bool restore();
+	const std::vector<uint32_t> &get_dirty_pages() const;
+
+	void dump(std::ostream &os) const;
+
+	bool load_file(const std::string &fname, uint64_t &loaded);
 private:
-	uint8_t *mem;	// The actual memory buffer
-	uint32_t size;
+	/**
+	 * Makes sure that the page holding addr is in the list of pages
+	 * written since the last snapshot() or restore().
+	 *
+	 * @param addr is an address about to be written.
+	 ***************************************************************/
+	void note_write(uint32_t addr)
+	{
+		if(!dirty[addr >> page_bits])
+			mark_dirty(addr);
+	}
+
+	void mark_dirty(uint32_t addr);
+	void note_range(uint32_t addr, uint64_t len);
+	void free_saved();
+
+	static uint8_t *alloc_flat(uint64_t len);
+	static void free_flat(uint8_t *p, uint64_t len);
+	static bool map_pattern(void *p, uint64_t len);
+
+	uint8_t get8_slow(uint64_t addr) const;
+	uint16_t get16_slow(uint64_t addr) const;
+	uint32_t get32_slow(uint64_t addr) const;
+	uint64_t get64_slow(uint64_t addr) const;
+
+	void set8_slow(uint64_t addr, uint8_t val);
+	void set16_slow(uint64_t addr, uint16_t val);
+	void set32_slow(uint64_t addr, uint32_t val);
+	void set64_slow(uint64_t addr, uint64_t val);
+
+	const uint8_t *find_page(uint32_t addr) const;
+	uint8_t *touch_page(uint32_t addr);
+	uint8_t absent_fill(uint32_t addr) const;
+
+	static constexpr uint32_t page_bits = 12;
+	static constexpr uint32_t page_size = 1 << page_bits;
+	static constexpr uint32_t dir_entries = 1024;	// 1024*1024 pages = 4 GiB
+	static constexpr uint64_t huge_page_size = 2 << 20;
+	static constexpr uint64_t lazy_fill_size = 64 << 20;	// see alloc_flat()
+	static constexpr uint64_t pattern_size = 2 << 20;
+
+	uint8_t *mem;		// The flat memory buffer or nullptr
+	uint64_t size;
+	uint64_t flat_size;	// size with the flat backend, else 0
+	uint8_t **dir[dir_entries];	// sparse backend page tables
+	std::vector<std::pair<uint64_t, uint64_t>> zero_ranges;	// [begin, end) of lazily zeroed pages
+
+	uint8_t *dirty;			// per page, set once in dirty_pages
+	std::vector<uint32_t> dirty_pages;	// page numbers written since the last snapshot
+	bool snapshot_taken;
+	uint8_t **saved;		// per page, its contents at the snapshot
+	std::vector<uint32_t> saved_pages;	// page numbers with a saved copy
+	static uint8_t absent_mark;	// saved[] of a sparse page that did not exist
+	std::ostream *warnings;		// where check_address() warns, or nullptr
+	uint64_t addr_mask;		// where the addresses of the slow accesses wrap, see set_xlen()
+
 };
+
+#endif
@@ -6,57 +6,46 @@
 #include <iostream>
 #include <iomanip>
 
-void registerfile::reset()
+template<uint32_t XLEN>
+void registerfile<XLEN>::reset()
 {
 	regs[0] = 0x0;
 
 	for(int32_t i = 1; i < 32; i++)
 	{
-		regs[i] = 0xf0f0f0f0;
+		regs[i] = (value_type)0xf0f0f0f0f0f0f0f0ull;
 	}
 }
 
 /**
-* Assigns register r the given val. If r is zero, it does nothing.
+* Dumps the registers in a readable format, eight to a line (four with
+* 64 bit registers.) Each line is rendered into a text_line and written
+* in one piece.
 *
-* @param r is the register
-* @param val is the value to be passed
+* @param os is the stream to dump them to.
 *******************************************************************************/
-void registerfile::set(uint32_t r, int32_t val)
+template<uint32_t XLEN>
+void registerfile<XLEN>::dump(std::ostream &os) const
 {
-	if(r == 0){}
-	else regs[r] = val;
-}
+	constexpr uint32_t per_line = XLEN == 32 ? 8 : 4;
 
-/**
-* Returns the value of register r. If r is zero, it returns zero.
-*
-* @param r is the register
-*******************************************************************************/
-int32_t registerfile::get(uint32_t r) const
-{
-	if(r == 0) return 0;
-	else return regs[r];
-}
-
-/**
-* Dumps the registers in a readable format.
-*******************************************************************************/
-void registerfile::dump() const
-{
-	for(uint32_t i = 0; i < 32; ++i)
+	for(uint32_t i = 0; i < 32; i += per_line)
 	{
-		if(i!=0 && i%8==0)
-			std::cout << std::endl;		
+		text_line line;
+		line << (i < 10 ? " x" : "x") << i << " ";
 
-		if(i%8 == 0)
+		for(uint32_t j = i; j < i + per_line; ++j)
 		{
-			std::string counter = "x";
-			counter += std::to_string(i);
-			std::cout << std::setw(3) << counter << " ";
+			if(XLEN == 32)
+				line.hex32(regs[j]) << " ";
+			else
+				line.hex64(regs[j]) << " ";
 		}
 
-		std::cout << hex32(regs[i]) << " ";
+		line << '\n';
+		os << line;
 	}
-	std::cout << std::endl;
 }
+
+template class registerfile<32>;
+template class registerfile<64>;
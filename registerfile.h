@@ -1,13 +1,24 @@
+#ifndef registerfile_H
+#define registerfile_H
+
 #include<cstdint>
 #include<string>
+#include<iosfwd>
+#include<type_traits>
 
 /*
 * The documentation of most of the functions is included in the .cpp file.
 */
 
+/**
+* The 32 integer registers of a hart of XLEN bits (32 or 64.)
+***********************************************************************/
+template<uint32_t XLEN>
 class registerfile
 {
 public:
+	typedef typename std::conditional<XLEN == 32, int32_t, int64_t>::type value_type;
+
 	/**
 	* The constructor of the class. It calls the reset() method.
 	************************************************************/
@@ -15,9 +26,47 @@ public:
 	{ reset(); }
 
 	void reset();
-	void set(uint32_t r, int32_t val);
-	int32_t get(uint32_t r) const;
-	void dump() const;
+
+	/**
+	* Assigns register r the given val. If r is zero, it does nothing.
+	*
+	* Defined here so that it can be inlined into the execution loops.
+	*
+	* @param r is the register
+	* @param val is the value to be passed
+	***************************************************************/
+	void set(uint32_t r, value_type val)
+	{
+		if(r != 0)
+			regs[r] = val;
+	}
+
+	/**
+	* Returns the value of register r. If r is zero, it returns zero
+	* (regs[0] is zeroed by reset() and never written by set().)
+	*
+	* @param r is the register
+	***************************************************************/
+	value_type get(uint32_t r) const
+	{
+		return regs[r];
+	}
+
+	/**
+	* Returns the register array itself, for the native code made by
+	* the JIT. Entry 0 must never be written.
+	***************************************************************/
+	value_type *data()
+	{
+		return regs;
+	}
+
+	void dump(std::ostream &os) const;
 private:
-	int32_t regs[32];
+	value_type regs[32];
 };
+
+extern template class registerfile<32>;
+extern template class registerfile<64>;
+
+#endif
@@ -1,201 +1,184 @@
 #include "hex.h"
 #include "rv32i.h"
+#include "async_tracer.h"
+#include "elf_loader.h"
 #include <sstream>
+#include <cstring>
 #include <cstdint>
 #include <iostream>
 #include <fstream>
 #include <cassert>
 #include <iomanip>
+#include <algorithm>
+
+/*
+* The width this translation unit instantiates the hart for. rv64i.cpp
+* includes this file with RV_HART_XLEN set to 64: with both widths in
+* one unit, GCC runs out of its inlining budget for the unit and stops
+* inlining the small accessors (word_table::at(), memory::get16())
+* into the RV32 execution loops.
+*/
+#ifndef RV_HART_XLEN
+#define RV_HART_XLEN 32
+#endif
 
 /**
 * This method is used to disassemble the instructions in the simulated
 * memory. To perform this task, it sets pc to zero, and then, for each
-* 32-bit word in the memory:
-* 	- print the 32-bit hex address in the pc register
-*	- fetch the 32-bit instruction from memory at the address
-*	  in the pc register
-*	- print the instruction as a 32-bit hex value
+* instruction in the memory:
+* 	- render the 32-bit hex address in the pc register
+*	- fetch the instruction from memory at the address in the pc
+*	  register
+*	- render the instruction as a 32-bit hex value (a compressed
+*	  one as the 16-bit value it is in memory)
 *	- pass the fetched instruction to decode() to decode and render
-*	  the instruction into a printable std::string
-*	- print the decoded instruction string returned from decode()
-*	- increment pc by 4				      
+*	  the instruction at the end of the same text_line
+*	- print the line in one write to out
+*	- increment pc by the length of the instruction
+* An address that a symbol of the ELF file names gets a line of its own
+* with the name before its instruction. A run of sparse pages that were
+* never written gets a single line with its range.
+*
+* @param symbols is the loaded ELF file, or nullptr
 ***********************************************************************/
-void rv32i::disasm(void)
+template<uint32_t XLEN>
+void rv_hart<XLEN>::disasm(const elf_loader *symbols)
 {
+	if(!out)
+		return;
+
 	pc = 0;
-	
-	for(uint32_t i = 0; i < mem->get_size(); i = i+4)
+
+	uint64_t i = 0;
+	uint32_t len = 4;	// of the previous instruction
+	while(i < mem->get_size())
 	{
+		if((i & 0xfff) < len && !mem->is_present(i & ~0xfffu))
+		{
+			// sparse pages that were never written, on one line
+			uint8_t fill;
+			uint64_t end = mem->absent_run(i, fill);
+			text_line line;
+			line.hex32(i & ~0xfffu) << '-';
+			line.hex32(end - 1) << ": never written\n";
+			*out << line;
+			i = end;
+			len = 4;
+			continue;
+		}
+
 		pc = i;
 
-		std::cout << hex32(pc) << ": " << hex32(mem->get32(pc)) 
-		<< "  " << decode(mem->get32(pc)) << std::endl;
+		uint32_t insn = fetch(pc);
+		std::string name;
+		uint64_t offset;
+		if(symbols && symbols->find_symbol(pc, name, offset) && offset == 0)
+		{
+			text_line label;
+			label.hex32(pc) << " <" << name << ">:\n";
+			*out << label;
+		}
+
+		text_line line;
+		line.hex32(pc) << ": ";
+		render_parcel(line, insn);
+		render_insn(line, insn);
+		line << '\n';
+		*out << line;
+
+		len = insn_len;
+		i += len;
 	}
 }
 
 /**
-* This method resets the rv32i object and the registerfile.
+* Frees the translated blocks and the JIT.
 ***********************************************************************/
-void rv32i::reset()
+template<uint32_t XLEN>
+rv_hart<XLEN>::~rv_hart()
 {
-	pc = 0;
+	flush_blocks();
+	delete jitter;
+}
+
+/**
+* This method resets the rv32i object and the registerfile. The pc
+* goes back to the entry point.
+***********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::reset()
+{
+	pc = entry;
 	insn_counter = 0;
 	halt = false;
+	halted_by = halt_none;
+	exit_status = 0;
 	regs.reset();
 }
 
 /**
 * The purpose of this function is to return a std::string containing
-* the disassembled in-struction text. It is implemented by using a
-* switch statement. It uses the value of the opcode extracted with
-* get_opcode(insn) as the switch expression.
+* the disassembled in-struction text, as rendered by decode(line, insn).
 *
 * @param insn the instruction to be decoded
 *
 * @return the string formatted instruction
 **********************************************************************/
-std::string rv32i::decode(uint32_t insn) const
+template<uint32_t XLEN>
+std::string rv_hart<XLEN>::decode(uint32_t insn) const
 {
-	uint32_t opcode = get_opcode(insn);
-	uint32_t funct3 = get_funct3(insn);
-	uint32_t funct7 = get_funct7(insn);
-	int32_t imm_i = get_imm_i(insn);
+	text_line line;
+	decode(line, insn);
+	return std::string(line.data(), line.size());
+}
 
-	switch(opcode)
+/**
+* Renders the disassembled instruction text at the end of line. The
+* kind of the instruction is looked up with decode_kind() and its
+* format picks the render_xxx() method, which is given the mnemonic of
+* the kind.
+*
+* @param line is the line to render into
+* @param insn the instruction to be decoded
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::decode(text_line &line, uint32_t insn) const
+{
+	const kind_info &k = kind_infos[decode_kind(insn)];
+
+	switch(k.format)
 	{
-		default:				return render_illegal_insn();
-		case opcode_lui:			return render_lui(insn);
-		case opcode_auipc:			return render_auipc(insn);
-		case opcode_rtype:
-			switch(funct3)
-			{
-			default:			return render_illegal_insn();
-			case funct3_add:	
-			// funct3 = 000
-				switch(funct7)
-				{
-				default:		return render_illegal_insn();
-				case funct7_add:	return render_rtype(insn, "add");
-				case funct7_sub:	return render_rtype(insn, "sub");
-				}
-				assert(0 && "unhandled funct7");
-			// funct3 = 001
-			case funct3_sll:		return render_rtype(insn, "sll");
-			// funct3 = 010
-			case funct3_slt:		return render_rtype(insn, "slt");
-			// funct3 = 011
-			case funct3_sltu:		return render_rtype(insn, "sltu");
-			// funct3 = 100
-			case funct3_xor:		return render_rtype(insn, "xor");
-			// funct3 = 101
-			case funct3_srl:
-				switch(funct7)
-				{
-				default:		return render_illegal_insn();
-				case funct7_add:	return render_rtype(insn, "srl");
-				case funct7_sub:	return render_rtype(insn, "sra");
-				}
-				assert(0 && "unhandled funct7");
-			// funct3 = 110
-			case funct3_or:			return render_rtype(insn, "or");
-			// funct3 = 111
-			case funct3_and:		return render_rtype(insn, "and");
-			}
-			assert(0 && "unhandled funct3");
-		// (I-Type) Load Immediate Instructions
-		case opcode_load_imm:
-			switch(funct3)
-			{
-			default:			return render_illegal_insn();
-			// funct3 = 000
-			case funct3_lb:			return render_itype_load(insn, "lb");
-			// funct3 = 001
-			case funct3_lh:			return render_itype_load(insn, "lh");
-			// funct3 = 010
-			case funct3_lw:			return render_itype_load(insn, "lw");
-			// funct3 = 100
-			case funct3_lbu:		return render_itype_load(insn, "lbu");
-			// funct3 = 101
-			case funct3_lhu:		return render_itype_load(insn, "lhu");
-			}
-			assert(0 && "unhandled funct3");
-		// I-Type Instructions
-		case opcode_itype:
-			switch(funct3)
-			{
-			default:			return render_illegal_insn();
-			// 000
-			case funct3_addi:		return render_itype_alu(insn, "addi", imm_i);
-			// 010
-			case funct3_slti:		return render_itype_alu(insn, "slti", imm_i);
-			// 011
-			case funct3_sltiu:		return render_itype_alu(insn, "sltiu", imm_i);
-			// 100
-			case funct3_xori:		return render_itype_alu(insn, "xori", imm_i);
-			// 110
-			case funct3_ori:		return render_itype_alu(insn, "ori", imm_i);
-			// 111
-			case funct3_andi:		return render_itype_alu(insn, "andi", imm_i);
-			// (I-Type) Shift Instructions
-			// 001
-			case funct3_slli:		return render_itype_shift(insn, "slli");
-			// 101
-			case funct3_srli:
-				switch(funct7)
-				{
-				default:		return render_illegal_insn();
-				case funct7_add:	return render_itype_shift(insn, "srli");
-				case funct7_sub:	return render_itype_shift(insn, "srai");
-				}
-				assert(0 && "unhandled funct7");
-			}
-			assert(0 && "unhandled funct3");
-		case opcode_stype:
-			switch(funct3)
-			{
-			default:			return render_illegal_insn();
-			// 000
-			case funct3_sb:			return render_stype(insn, "sb");		
-			// 001
-			case funct3_sh:			return render_stype(insn, "sh");
-			// 010
-			case funct3_sw:			return render_stype(insn, "sw");
-			}
-			assert(0 && "unhandled funct3");
-		case opcode_btype:
-			switch(funct3)
-			{
-			default:			return render_illegal_insn();
-			// 000
-			case funct3_beq:		return render_btype(insn, "beq");		
-			// 001
-			case funct3_bne:		return render_btype(insn, "bne");
-			// 100
-			case funct3_blt:		return render_btype(insn, "blt");
-			// 101
-			case funct3_bge:		return render_btype(insn, "bge");
-			// 110
-			case funct3_bltu:		return render_btype(insn, "bltu");
-			// 111
-			case funct3_bgeu:		return render_btype(insn, "bgeu");
-			}
-			assert(0 && "unhandled funct3");
-		case opcode_jal:			return render_jal(insn);
-		case opcode_jalr:			return render_itype_load(insn, "jalr");
-		case opcode_fence:			return render_fence(insn);
-		case opcode_ecall_ebreak:		return render_ecall_ebreak(insn);
+		default:				return render_illegal_insn(line);
+		case format_r:				return render_rtype(line, insn, k.mnemonic);
+		case format_i_alu:			return render_itype_alu(line, insn, k.mnemonic, get_imm_i(insn));
+		case format_i_shift:			return render_itype_shift(line, insn, k.mnemonic);
+		case format_unary:			return render_unary(line, insn, k.mnemonic);
+		case format_i_load:			return render_itype_load(line, insn, k.mnemonic);
+		case format_s:				return render_stype(line, insn, k.mnemonic);
+		case format_b:				return render_btype(line, insn, k.mnemonic);
+		case format_u:				return render_utype(line, insn, k.mnemonic);
+		case format_j:				return render_jal(line, insn);
+		case format_fence:			return render_fence(line, insn);
+		case format_system:			return render_ecall_ebreak(line, insn);
 	}
-	assert(0 && "unhandled opcode");
 }
 
 /**
 * Dumps the state of the hart. It dumps the GP-registers and the PC
 * register.
 **********************************************************************/
-void rv32i::dump() const
+template<uint32_t XLEN>
+void rv_hart<XLEN>::dump() const
 {
-	regs.dump();
-	std::cout << " pc " << hex32(pc) << std::endl;
+	if(!dump_out)
+		return;
+
+	regs.dump(*dump_out);
+
+	text_line line;
+	line << " pc ";
+	render_reg(line, pc) << '\n';
+	*dump_out << line;
 }
 
 /**
@@ -203,7 +186,8 @@ void rv32i::dump() const
 *
 * @param b is the value to set up show_instructions
 **********************************************************************/
-void rv32i::set_show_instructions(bool b)
+template<uint32_t XLEN>
+void rv_hart<XLEN>::set_show_instructions(bool b)
 {
 	show_instructions = b;
 }
@@ -213,166 +197,331 @@ void rv32i::set_show_instructions(bool b)
 *
 * @param b is the value to set up show_registers
 **********************************************************************/
-void rv32i::set_show_registers(bool b)
+template<uint32_t XLEN>
+void rv_hart<XLEN>::set_show_registers(bool b)
 {
 	show_registers = b;
 }
 
+/**
+* Enables or disables the C extension. Without it, a word whose two
+* low bits are not 11 is an illegal instruction. Whatever was decoded
+* with the other setting is forgotten.
+*
+* @param b is true to execute compressed instructions
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::set_compressed(bool b)
+{
+	compressed = b;
+	flush_icache();
+}
+
+/**
+* Sets the address execution starts at, now and after reset().
+*
+* @param addr is the entry point of the program
+***********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::set_entry(reg_t addr)
+{
+	entry = addr;
+	pc = addr;
+}
+
+/**
+* Turns on edge coverage, counting every taken branch and jump in map,
+* or turns it off. The translated blocks are flushed, since the native
+* code counts the edges only if it was compiled with a map.
+*
+* @param map is a coverage::map_size byte map, or nullptr
+***********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::set_coverage(uint8_t *map)
+{
+	cov_map = map;
+	flush_blocks();
+}
+
+/**
+* Makes execute() record every instruction into the binary trace w,
+* or stops recording.
+*
+* @param w is the trace or nullptr
+***********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::set_trace_writer(trace_writer *w)
+{
+	trace_out = w;
+}
+
+/**
+* Makes execute() hand the rendering of -i and -r to the thread of t,
+* or render them itself again.
+*
+* @param t is the rendering thread or nullptr
+***********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::set_tracer(async_tracer<XLEN> *t)
+{
+	tracer = t;
+}
+
+/**
+* Makes ecall run the system calls of s, or halt like ebreak.
+*
+* @param s is the system call emulation or nullptr
+***********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::set_syscalls(syscalls *s)
+{
+	sys = s;
+}
+
+/**
+* Mutator for out, the stream that the disassembly and the instructions
+* go to (std::cout by default.)
+*
+* @param os is the stream, or nullptr to drop them
+***********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::set_output(std::ostream *os)
+{
+	out = os;
+}
+
+/**
+* Mutator for dump_out, the stream that the dumps of the hart go to
+* (std::cout by default.)
+*
+* @param os is the stream, or nullptr to drop them
+***********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::set_dump_output(std::ostream *os)
+{
+	dump_out = os;
+}
+
+/**
+* Accessor for pc
+*
+* @return the address of the next instruction
+***********************************************************************/
+template<uint32_t XLEN>
+typename rv_hart<XLEN>::reg_t rv_hart<XLEN>::get_pc() const
+{
+	return pc;
+}
+
+/**
+* Accessor for insn_counter
+*
+* @return the number of instructions executed
+***********************************************************************/
+template<uint32_t XLEN>
+uint64_t rv_hart<XLEN>::get_insn_counter() const
+{
+	return insn_counter;
+}
+
+/**
+* Mutator for engine
+*
+* @param e is the execution engine to use for untraced execution
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::set_engine(engine_kind e)
+{
+	engine = e;
+}
+
 /**
 * Accessor for show_registers
 *
 * @return the boolean value of halt
 **********************************************************************/
-bool rv32i::is_halted() const
+template<uint32_t XLEN>
+bool rv_hart<XLEN>::is_halted() const
 {
 	return halt;
 }
 
 /**
-* Executes the given instruction by making use of the get_xxx()
-* methods to extract the needed instruction fields to decode the
-* instruction and invoke the associated exec_xxx() helper function
-* using a switch statement.
+* Accessor for compressed
+*
+* @return true if the C extension is enabled
+***********************************************************************/
+template<uint32_t XLEN>
+bool rv_hart<XLEN>::is_compressed() const
+{
+	return compressed;
+}
+
+/**
+* @return true if the program halted by calling exit
+***********************************************************************/
+template<uint32_t XLEN>
+bool rv_hart<XLEN>::has_exited() const
+{
+	return halted_by == halt_exit;
+}
+
+/**
+* @return why the program halted, halt_none if it did not
+***********************************************************************/
+template<uint32_t XLEN>
+typename rv_hart<XLEN>::halt_reason rv_hart<XLEN>::get_halt_reason() const
+{
+	return halted_by;
+}
+
+/**
+* @return the status the program gave to exit, 0 if it did not
+***********************************************************************/
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::get_exit_status() const
+{
+	return exit_status;
+}
+
+/**
+* Executes the given instruction by looking up its kind with
+* decode_kind() and invoking the associated exec_xxx() helper function
+* using a switch statement on the kind.
 *
-* @param insn is the instruction coming in
-* @param ostream is the ostream object
+* @param insn is the instruction coming in, as returned by fetch(). It
+* is insn_len bytes long in memory.
+* @param trace is the tracing policy, text_trace renders the
+* instruction to trace.pos and no_trace compiles the rendering out
 *
 * @note this function must be capable of handling any 32-bit value.
 *********************************************************************/
-void rv32i::dcex(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::dcex(uint32_t insn, const T &trace)
 {
-	uint32_t opcode = get_opcode(insn);
-	uint32_t funct3 = get_funct3(insn);
-	uint32_t funct7 = get_funct7(insn);
-
-	switch(opcode)
+	switch(decode_kind(insn))
 	{
-		default:				exec_illegal_insn(insn, pos); return;
-		case opcode_lui:			exec_lui(insn, pos); return;
-		case opcode_auipc:			exec_auipc(insn, pos); return;
-		case opcode_jal:			exec_jal(insn, pos); return;
-		case opcode_jalr:			exec_jalr(insn, pos); return;
-		case opcode_ecall_ebreak:		exec_ebreak(insn, pos); return;
-		case opcode_btype:
-			switch(funct3)
-			{
-			default:			exec_illegal_insn(insn, pos); return;
-			// 000
-			case funct3_beq:		exec_beq(insn, pos); return;		
-			// 001
-			case funct3_bne:		exec_bne(insn, pos); return;
-			// 100
-			case funct3_blt:		exec_blt(insn, pos); return;
-			// 101
-			case funct3_bge:		exec_bge(insn, pos); return;
-			// 110
-			case funct3_bltu:		exec_bltu(insn, pos); return;
-			// 111
-			case funct3_bgeu:		exec_bgeu(insn, pos); return;
-			}
-			assert(0 && "unhandled funct3");	
-		// I-Type Instructions
-		case opcode_itype:
-			switch(funct3)
-			{
-			default:			exec_illegal_insn(insn, pos); return;
-			// 000
-			case funct3_addi:		exec_addi(insn, pos); return;
-			// 010
-			case funct3_slti:		exec_slti(insn, pos); return;
-			// 011
-			case funct3_sltiu:		exec_sltiu(insn, pos); return;
-			// 100
-			case funct3_xori:		exec_xori(insn, pos); return;
-			// 110 
-			case funct3_ori:		exec_ori(insn, pos); return;
-			// 111
-			case funct3_andi:		exec_andi(insn, pos); return;
-			// (I-Type) Shift Instructions
-			// 001 
-			case funct3_slli:		exec_slli(insn, pos); return;
-			// 101
-			case funct3_srli:
-				switch(funct7)
-				{
-				default:		exec_illegal_insn(insn, pos); return;
-				case funct7_add:	exec_srli(insn, pos); return;
-				case funct7_sub:	exec_srai(insn, pos); return;
-				}
-				assert(0 && "unhandled funct7");
-			}
-			assert(0 && "unhandled funct3");
-		case opcode_load_imm:
-			switch(funct3)
-			{
-			default:			exec_illegal_insn(insn, pos); return;
-			// funct3 = 000 
-			case funct3_lb:			exec_lb(insn, pos); return;
-			// funct3 = 001
-			case funct3_lh:			exec_lh(insn, pos); return;
-			// funct3 = 010 
-			case funct3_lw:			exec_lw(insn, pos); return;
-			// funct3 = 100
-			case funct3_lbu:		exec_lbu(insn, pos); return;
-			// funct3 = 101
-			case funct3_lhu:		exec_lhu(insn, pos); return;
-			}
-			assert(0 && "unhandled funct3");
-		case opcode_stype:
-			switch(funct3)
-			{
-			default:			exec_illegal_insn(insn, pos); return;
-			// 000
-			case funct3_sb:			exec_sb(insn, pos); return;	
-			// 001
-			case funct3_sh:			exec_sh(insn, pos); return;
-			// 010
-			case funct3_sw:			exec_sw(insn, pos); return;
-			}
-			assert(0 && "unhandled funct3");
-		case opcode_rtype:
-			switch(funct3)
-			{
-			default:			exec_illegal_insn(insn, pos); return;
-			case funct3_add:	
-			// funct3 = 000
-				switch(funct7)
-				{
-				default:		exec_illegal_insn(insn, pos); return;
-				case funct7_add:	exec_add(insn, pos); return;
-				case funct7_sub:	exec_sub(insn, pos); return;
-				}
-				assert(0 && "unhandled funct7");
-			case funct3_sll:		exec_sll(insn, pos); return;
-			// funct3 = 010 
-			case funct3_slt:		exec_slt(insn, pos); return;
-			// funct3 = 011 
-			case funct3_sltu:		exec_sltu(insn, pos); return;
-			// funct3 = 100
-			case funct3_xor:		exec_xor(insn, pos); return;
-			// funct3 = 101 
-			case funct3_srl:
-				switch(funct7)
-				{
-				default:		exec_illegal_insn(insn, pos); return;
-				case funct7_add:	exec_srl(insn, pos); return;
-				case funct7_sub:	exec_sra(insn, pos); return;
-				}
-				assert(0 && "unhandled funct7");
-			// funct3 = 110
-			case funct3_or:			exec_or(insn, pos); return;
-			// funct3 = 111
-			case funct3_and:		exec_and(insn, pos); return;
-			}
-		case opcode_fence:			exec_fence(insn, pos); return;
+		default:			exec_illegal_insn(insn, trace); return;
+		case kind_ebreak:		exec_ebreak(insn, trace); return;
+		case kind_ecall:		exec_ecall(insn, trace); return;
+		case kind_fence:		exec_fence(insn, trace); return;
+		case kind_lui:			exec_lui(insn, trace); return;
+		case kind_auipc:		exec_auipc(insn, trace); return;
+		case kind_jal:			exec_jal(insn, trace); return;
+		case kind_jalr:			exec_jalr(insn, trace); return;
+		case kind_beq:			exec_beq(insn, trace); return;
+		case kind_bne:			exec_bne(insn, trace); return;
+		case kind_blt:			exec_blt(insn, trace); return;
+		case kind_bge:			exec_bge(insn, trace); return;
+		case kind_bltu:			exec_bltu(insn, trace); return;
+		case kind_bgeu:			exec_bgeu(insn, trace); return;
+		case kind_lb:			exec_lb(insn, trace); return;
+		case kind_lh:			exec_lh(insn, trace); return;
+		case kind_lw:			exec_lw(insn, trace); return;
+		case kind_lbu:			exec_lbu(insn, trace); return;
+		case kind_lhu:			exec_lhu(insn, trace); return;
+		case kind_sb:			exec_sb(insn, trace); return;
+		case kind_sh:			exec_sh(insn, trace); return;
+		case kind_sw:			exec_sw(insn, trace); return;
+		case kind_addi:			exec_addi(insn, trace); return;
+		case kind_slti:			exec_slti(insn, trace); return;
+		case kind_sltiu:		exec_sltiu(insn, trace); return;
+		case kind_xori:			exec_xori(insn, trace); return;
+		case kind_ori:			exec_ori(insn, trace); return;
+		case kind_andi:			exec_andi(insn, trace); return;
+		case kind_slli:			exec_slli(insn, trace); return;
+		case kind_srli:			exec_srli(insn, trace); return;
+		case kind_srai:			exec_srai(insn, trace); return;
+		case kind_add:			exec_add(insn, trace); return;
+		case kind_sub:			exec_sub(insn, trace); return;
+		case kind_sll:			exec_sll(insn, trace); return;
+		case kind_slt:			exec_slt(insn, trace); return;
+		case kind_sltu:			exec_sltu(insn, trace); return;
+		case kind_xor:			exec_xor(insn, trace); return;
+		case kind_srl:			exec_srl(insn, trace); return;
+		case kind_sra:			exec_sra(insn, trace); return;
+		case kind_or:			exec_or(insn, trace); return;
+		case kind_and:			exec_and(insn, trace); return;
+		case kind_mul:			exec_mul(insn, trace); return;
+		case kind_mulh:			exec_mulh(insn, trace); return;
+		case kind_mulhsu:		exec_mulhsu(insn, trace); return;
+		case kind_mulhu:		exec_mulhu(insn, trace); return;
+		case kind_div:			exec_div(insn, trace); return;
+		case kind_divu:			exec_divu(insn, trace); return;
+		case kind_rem:			exec_rem(insn, trace); return;
+		case kind_remu:			exec_remu(insn, trace); return;
+		case kind_sh1add:		exec_sh1add(insn, trace); return;
+		case kind_sh2add:		exec_sh2add(insn, trace); return;
+		case kind_sh3add:		exec_sh3add(insn, trace); return;
+		case kind_andn:			exec_andn(insn, trace); return;
+		case kind_orn:			exec_orn(insn, trace); return;
+		case kind_xnor:			exec_xnor(insn, trace); return;
+		case kind_min:			exec_min(insn, trace); return;
+		case kind_minu:			exec_minu(insn, trace); return;
+		case kind_max:			exec_max(insn, trace); return;
+		case kind_maxu:			exec_maxu(insn, trace); return;
+		case kind_rol:			exec_rol(insn, trace); return;
+		case kind_ror:			exec_ror(insn, trace); return;
+		case kind_rori:			exec_rori(insn, trace); return;
+		case kind_clz:			exec_clz(insn, trace); return;
+		case kind_ctz:			exec_ctz(insn, trace); return;
+		case kind_cpop:			exec_cpop(insn, trace); return;
+		case kind_sext_b:		exec_sext_b(insn, trace); return;
+		case kind_sext_h:		exec_sext_h(insn, trace); return;
+		case kind_zext_h:		exec_zext_h(insn, trace); return;
+		case kind_orc_b:		exec_orc_b(insn, trace); return;
+		case kind_rev8:			exec_rev8(insn, trace); return;
+		case kind_lwu:			exec_lwu(insn, trace); return;
+		case kind_ld:			exec_ld(insn, trace); return;
+		case kind_sd:			exec_sd(insn, trace); return;
+		case kind_addiw:		exec_addiw(insn, trace); return;
+		case kind_slliw:		exec_slliw(insn, trace); return;
+		case kind_srliw:		exec_srliw(insn, trace); return;
+		case kind_sraiw:		exec_sraiw(insn, trace); return;
+		case kind_addw:			exec_addw(insn, trace); return;
+		case kind_subw:			exec_subw(insn, trace); return;
+		case kind_sllw:			exec_sllw(insn, trace); return;
+		case kind_srlw:			exec_srlw(insn, trace); return;
+		case kind_sraw:			exec_sraw(insn, trace); return;
+		case kind_mulw:			exec_mulw(insn, trace); return;
+		case kind_divw:			exec_divw(insn, trace); return;
+		case kind_divuw:		exec_divuw(insn, trace); return;
+		case kind_remw:			exec_remw(insn, trace); return;
+		case kind_remuw:		exec_remuw(insn, trace); return;
 	}
-	assert(0 && "unhandled opcode");
 }
 
 /**
 * Simulates the execution of one single instruction.
 **********************************************************************/
-void rv32i::tick()
+template<uint32_t XLEN>
+void rv_hart<XLEN>::tick()
+{
+	if(show_instructions || show_registers)
+	{
+		text_trace t;
+		t.pos = show_instructions ? out : nullptr;
+		tick(t);
+	}
+	else
+	{
+		tick(no_trace());
+	}
+}
+
+/**
+* Simulates the execution of one single instruction with the given
+* tracing policy. With text_trace the registers are dumped first if
+* show_registers is set, and the instruction is executed by dcex() and
+* rendered if trace.pos is set. With no_trace the instruction is
+* executed by the selected engine without any output.
+*
+* @param trace is the tracing policy
+**********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::tick(const T &trace)
 {
 	if(is_halted())
 	{
@@ -382,1485 +531,6039 @@ void rv32i::tick()
 	{
 		insn_counter++;
 
-		if(show_registers)
+		if(T::enabled)
+		{
+			if(show_registers)
 				dump();
 
-		if(show_instructions)
+			if(trace.pos)
+			{
+				// the address goes out before the fetch can warn
+				text_line addr;
+				addr.hex32(pc) << ": ";
+				*trace.pos << addr;
+
+				uint32_t insn = fetch(pc);
+				text_line word;
+				render_parcel(word, insn);
+				*trace.pos << word;
+
+				dcex(insn, trace);
+			}
+			else
+			{
+				dcex(fetch(pc), no_trace());
+			}
+		}
+		else if(engine == engine_switch)
 		{
-			std::cout << hex32(pc) << ": " << hex32(mem->get32(pc)) << "  ";
-			dcex(mem->get32(pc), &std::cout);
+			dcex(fetch(pc), trace);
 		}
 		else
 		{
-			dcex(mem->get32(pc),nullptr);
+			exec_cached();
 		}
 	}
 }
 
 /**
-* Simulates the running of a program by an RV32I machine.
-*
-* @param limit is the max amount of instructions to execute
-********************************************************************/
-void rv32i::run(uint64_t limit)
+* Executes the instruction at pc out of the pre-decoded instruction
+* cache. A pc that is odd or not inside the memory has no slot, so it
+* is handed to dcex() to get the same warnings and behavior as an
+* uncached fetch.
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::exec_cached()
 {
-	regs.set(2,mem->get_size());
-
-	while(!halt)
+	if((pc & 1) == 0 && pc < mem->get_size())
 	{
-		// If limit is set
-		if (limit != 0)
-		{
-			// When the count is limit, stop execution
-			if(insn_counter == limit)
-				halt = true;
-		}
-
-		tick();
+		const decoded_insn &d = icache.at(pc);
+		d.exec(this, d);
+	}
+	else
+	{
+		dcex(fetch(pc), no_trace());
 	}
-	std::cout << "Execution terminated by EBREAK instruction" << std::endl;
-	std::cout << insn_counter << " instructions executed" << std::endl;
 }
 
 /**
-* Simulates the execution of the fence instruction.
-*
-* @param insn is the instruction to be executed
-*
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_fence(uint32_t insn, std::ostream* pos)
+* Marks every slot of the pre-decoded instruction cache as not yet
+* decoded. It has to be called whenever the memory is modified by
+* anything other than the store instructions (for example after
+* loading a new program.)
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::flush_icache()
 {
-	if (pos)
-	{
-		std::string s = render_fence(insn);
-		s.resize(instruction_width, ' ');
-
-		*pos << s << "// fence" << std::endl;
-	}
-	
-	pc += 4;
+	decoded_insn empty = { fast_decode, 0, 0, 0, 0, kind_decode, 4 };
+	icache.reset(mem->get_size(), empty);
+	flush_blocks();
 }
 
 /**
-* Simulates the execution of the and instruction.
-*
-* @param insn is the instruction to be executed
+* Copies len bytes of input into the memory at addr, forgetting any
+* decoded instructions there, and passes the buffer to the program in
+* a0 (the address) and a1 (the length.)
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_and(uint32_t insn, std::ostream* pos)
+* @param addr is the address of the buffer
+* @param data is the input
+* @param len is the length of the input
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::inject(reg_t addr, const uint8_t *data, uint32_t len)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	int32_t val = regs.get(rs1) & regs.get(rs2);
-
-	if (pos)
-	{
-		std::string s = render_rtype(insn, "and");
-		s.resize(instruction_width, ' ');
+	mem->set_block(addr, data, len);
 
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(regs.get(rs1)) << " & " <<
-		hex0x32(regs.get(rs2)) << " = " << hex0x32(val) << std::endl;
-	}
+	for(uint64_t a = addr & ~(reg_t)0xfff; a < (uint64_t)addr + len; a += 0x1000)
+		invalidate_page(a);
+	if(blocks_stale)
+		flush_blocks();
 
-	regs.set(rd, val);
-	pc += 4;
+	regs.set(10, addr);
+	regs.set(11, len);
 }
 
 /**
-* Simulates the execution of the or instruction.
-*
-* @param insn is the instruction to be executed
+* Forgets the decoded form of every slot of the 4 KiB page holding addr.
+* Pages that were never executed are skipped without looking at their
+* slots.
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_or(uint32_t insn, std::ostream* pos)
+* @param addr is an address in the page
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::invalidate_page(reg_t addr)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	int32_t val = regs.get(rs1) | regs.get(rs2);
+	addr &= ~(reg_t)0xfff;
 
-	if (pos)
+	decoded_insn *d = icache.find(addr);
+	if(d)
 	{
-		std::string s = render_rtype(insn, "or");
-		s.resize(instruction_width, ' ');
-
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(regs.get(rs1)) << " | " <<
-		hex0x32(regs.get(rs2)) << " = " << hex0x32(val) << std::endl;
+		for(uint32_t i = 0; i < icache.entries_per_page; ++i)
+		{
+			d[i].exec = fast_decode;
+			d[i].kind = kind_decode;
+		}
 	}
 
-	regs.set(rd, val);
-	pc += 4;
+	// the instructions of the page before that run into this one
+	invalidate_icache(addr, 1);
+
+	const uint8_t *code = block_code.find(addr);
+	if(code)
+	{
+		for(uint32_t i = 0; i < block_code.entries_per_page; ++i)
+			if(code[i])
+				blocks_stale = true;
+	}
 }
 
 /**
-* Simulates the execution of the sra instruction.
-*
-* @param insn is the instruction to be executed
+* Takes a snapshot of the hart: the registers, pc, insn_counter,
+* (through memory::snapshot()) the memory and the break of the system
+* calls. Nothing is copied up front for the memory, its pages are
+* saved when they are first written.
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::snapshot()
+{
+	snap_regs = regs;
+	snap_pc = pc;
+	snap_insn_counter = insn_counter;
+	mem->snapshot();
+	if(sys)
+		sys->snapshot();
+}
+
+/**
+* Puts the hart back in the state it had at the last snapshot(). Only
+* the pages of memory written since then are rewritten, and only their
+* decoded instructions and translated blocks are forgotten.
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_sra(uint32_t insn, std::ostream* pos)
+* @return false if there is no snapshot.
+**********************************************************************/
+template<uint32_t XLEN>
+bool rv_hart<XLEN>::restore()
 {
-	uint32_t rd = get_rd(insn);
-	int32_t rs1 = regs.get(get_rs1(insn));
-	int32_t rs2 = regs.get(get_rs2(insn)) & 0x0000001f;
-	int32_t val = rs1 >> regs.get(get_rs2(insn));
+	for(uint32_t page : mem->get_dirty_pages())
+		invalidate_page(page << 12);
 
-	if (pos)
-	{
-		std::string s = render_rtype(insn, "sra");
-		s.resize(instruction_width, ' ');
+	if(!mem->restore())
+		return false;
 
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(rs1) << " >> " <<
-		rs2 << " = " << hex0x32(val) << std::endl;
-	}
+	if(blocks_stale)
+		flush_blocks();
 
-	regs.set(rd, val);
-	pc += 4;
+	if(sys)
+		sys->restore();
+
+	regs = snap_regs;
+	pc = snap_pc;
+	insn_counter = snap_insn_counter;
+	halt = false;
+	halted_by = halt_none;
+	exit_status = 0;
+	return true;
 }
 
 /**
-* Simulates the execution of the srl instruction.
-*
-* @param insn is the instruction to be executed
-*
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_srl(uint32_t insn, std::ostream* pos)
+* Forgets the decoded form of the slots overlapping the len bytes
+* starting at addr. Called by the store instructions so that code
+* that is written at runtime is decoded again before it is executed.
+* The slots of the halfwords written are forgotten, and the one
+* before them, which may hold a 32-bit instruction ending in them. A
+* pair fused into a slot up to 6 bytes before ends in them too.
+*
+* @param addr is the first byte that was written
+* @param len is the number of bytes that were written
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::invalidate_icache(reg_t addr, uint64_t len)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = regs.get(get_rs1(insn));
-	int32_t rs2 = regs.get(get_rs2(insn)) & 0x0000001f;
-	int32_t val = rs1 >> regs.get(get_rs2(insn));
+	const uint64_t end = std::min((uint64_t)addr + len, mem->get_size());
+	const uint64_t first = addr & ~(reg_t)1;
+	const uint64_t from = first >= 6 ? first - 6 : 0;
 
-	if (pos)
+	for(uint64_t a = from; a < end; a += 2)
 	{
-		std::string s = render_rtype(insn, "srl");
-		s.resize(instruction_width, ' ');
-
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(rs1) << " >> " <<
-		rs2 << " = " << hex0x32(val) << std::endl;
+		decoded_insn *d = icache.find(a);
+		if(d && (a + 2 >= first || d->kind >= kind_count))
+		{
+			d->exec = fast_decode;
+			d->kind = kind_decode;
+		}
 	}
 
-	regs.set(rd, val);
-	pc += 4;
+	for(uint64_t a = first; a < end; a += 2)
+	{
+		const uint8_t *code = block_code.find(a);
+		if(code && *code)
+			blocks_stale = true;
+	}
 }
 
-/*
-* Simulates the execution of the xor instruction.
-*
-* @param insn is the instruction to be executed
+/**
+* Simulates the running of a program by an RV32I or RV64I machine.
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_xor(uint32_t insn, std::ostream* pos)
+* @param limit is the max amount of instructions to execute
+********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::run(uint64_t limit)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	int32_t val = regs.get(rs1) ^ regs.get(rs2);
-
-	if (pos)
-	{
-		std::string s = render_rtype(insn, "xor");
-		s.resize(instruction_width, ' ');
+	regs.set(2,mem->get_size());
 
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(regs.get(rs1)) << " ^ " <<
-		hex0x32(regs.get(rs2)) << " = " << hex0x32(val) << std::endl;
-	}
+	execute(limit);
 
-	regs.set(rd, val);
-	pc += 4;
+	if(halted_by == halt_exit)
+		std::cout << "Execution terminated by exit(" << exit_status << ")\n";
+	else
+		std::cout << "Execution terminated by EBREAK instruction\n";
+	std::cout << insn_counter << " instructions executed\n";
 }
 
-/*
-* Simulates the execution of the sltu instruction.
-*
-* @param insn is the instruction to be executed
+/**
+* Runs the program with the selected engine (or recorded into the
+* binary trace, or into the ring of the thread that renders -i and -r,
+* or traced right here when -i or -r asked for it without one) until
+* it halts, without printing anything else.
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_sltu(uint32_t insn, std::ostream* pos)
+* @param limit is the value of insn_counter to stop at, or 0 for none
+********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::execute(uint64_t limit)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = regs.get(get_rs1(insn));
-	uint32_t rs2 = regs.get(get_rs2(insn));
-	int32_t val = (rs1 < rs2) ? 1 : 0;
-
-	if (pos)
+	if(trace_out)
 	{
-		std::string s = render_rtype(insn, "sltu");
-		s.resize(instruction_width, ' ');
-
-		*pos << s << "// " << "x" << rd << " = (" << hex0x32(rs1) << " <U " <<
-		hex0x32(rs2) << ") ? 1 : 0 = " << hex0x32(val) << std::endl;
+		run_recorded(limit, *trace_out);
+	}
+	else if(tracer)
+	{
+		run_recorded(limit, tracer->get_ring());
+		tracer->sync(insn_counter);
+	}
+	else if(show_instructions || show_registers)
+	{
+		text_trace t;
+		t.pos = show_instructions ? out : nullptr;
+		run_ticks(limit, t);
+	}
+	else if(engine == engine_threaded)
+	{
+		if(compressed)
+			run_threaded<true>(limit);
+		else
+			run_threaded<false>(limit);
+	}
+	else if(engine == engine_block || engine == engine_jit)
+	{
+		run_blocks(limit);
+	}
+	else
+	{
+		run_ticks(limit, no_trace());
 	}
-
-	regs.set(rd, val);
-	pc += 4;
 }
 
-/*
-* Simulates the execution of the slt instruction.
+/**
+* Sets up the stack pointer like run() and then runs the program one
+* tick() at a time until pc is addr.
 *
-* @param insn is the instruction to be executed
+* @param addr is the address to stop at
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_slt(uint32_t insn, std::ostream* pos)
+* @return false if the program halted before getting to addr.
+********************************************************************/
+template<uint32_t XLEN>
+bool rv_hart<XLEN>::run_to(reg_t addr)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	int32_t val = (regs.get(rs1) < regs.get(rs2)) ? 1 : 0;
-
-	if (pos)
-	{
-		std::string s = render_rtype(insn, "slt");
-		s.resize(instruction_width, ' ');
+	regs.set(2,mem->get_size());
 
-		*pos << s << "// " << "x" << rd << " = (" << hex0x32(regs.get(rs1)) << " < " <<
-		hex0x32(regs.get(rs2)) << ") ? 1 : 0 = " << hex0x32(val) << std::endl;
-	}
+	while(!halt && pc != addr)
+		tick();
 
-	regs.set(rd, val);
-	pc += 4;
+	return !halt;
 }
 
-/*
-* Simulates the execution of the sll instruction.
-*
-* @param insn is the instruction to be executed
+/**
+* Runs the program out of the pre-decoded instruction cache like the
+* cached engine, handing the record of every instruction to w first:
+* the instruction word (when it can be fetched, the 32 bits at pc even
+* for a compressed instruction) and, for loads, the bytes read that
+* are inside the memory. An emulated ecall is recorded after it ran,
+* with its result.
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_sll(uint32_t insn, std::ostream* pos)
+* @param limit is the max amount of instructions to execute
+* @param w is the binary trace or the ring of an async_tracer
+********************************************************************/
+template<uint32_t XLEN>
+template<typename W>
+void rv_hart<XLEN>::run_recorded(uint64_t limit, W &w)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	uint32_t shift = (regs.get(rs2) & 0x0000001f);
-	int32_t val = regs.get(rs1) << shift;
+	const uint64_t size = mem->get_size();
 
-	if (pos)
+	while(!halt)
 	{
-		std::string s = render_rtype(insn, "sll");
-		s.resize(instruction_width, ' ');
+		if(limit != 0 && insn_counter == limit)
+		{
+			stop(halt_limit);
+			break;
+		}
+
+		bool fetched = pc < size && size - pc >= 4;
+		uint32_t insn = fetched ? mem->get32(pc) : 0;
+		uint32_t op = insn;
+		reg_t addr = 0;
+		uint32_t width = 0;
+		uint8_t load[8];
+
+		if(compressed && (insn & 3) != 3)
+			op = expand_compressed(insn & 0xffff);
+
+		switch(decode_kind(op))
+		{
+		default:		break;
+		case kind_ecall:
+			if(sys && fetched)
+			{
+				reg_t at = pc;
+				insn_counter++;
+				exec_cached();
+				w.record(at, insn, fetched, 0, 0, load, true, regs.get(10));
+				continue;
+			}
+			break;
+		case kind_lb:
+		case kind_lbu:		width = 1; break;
+		case kind_lh:
+		case kind_lhu:		width = 2; break;
+		case kind_lw:
+		case kind_lwu:		width = 4; break;
+		case kind_ld:		width = 8; break;
+		}
+
+		if(fetched && width)
+		{
+			addr = regs.get(get_rs1(op)) + get_imm_i(op);
+			for(uint32_t i = 0; i < width; ++i)
+				load[i] = (addr + i < size) ? mem->get8(addr + i) : 0;
+		}
+
+		w.record(pc, insn, fetched, addr, width, load, false, 0);
 
-		*pos << s << "// x" << rd << " = " << hex0x32(regs.get(rs1)) << " << " << shift <<
-		" = " << hex0x32(val) << std::endl;
+		insn_counter++;
+		exec_cached();
 	}
+}
 
-	regs.set(rd, val);
-	pc += 4;
+/**
+* Sets up the stack pointer like run() before the first replay().
+********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::start_replay()
+{
+	regs.set(2,mem->get_size());
 }
 
 /**
-* Simulates the execution of the sub instruction.
-*
-* @param insn is the instruction to be executed
+* Executes the instruction of one record of run_recorded() again,
+* after writing the instruction word (if it differs from the one in
+* the memory) and the loaded bytes into the memory, so that it is
+* rendered exactly as it was in the recorded run.
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_sub(uint32_t insn, std::ostream* pos)
+* @param r is the record, not a trace_end one.
+********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::replay(const trace_record &r)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-
-	int32_t val = regs.get(rs1) - regs.get(rs2);
+	const uint64_t size = mem->get_size();
 
-	if (pos)
-	{
-		std::string s = render_rtype(insn, "sub");
-		s.resize(instruction_width, ' ');
+	if((r.flags & trace_record::has_insn) && mem->get32(pc) != r.insn)
+		mem->set32(pc, r.insn);
 
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(regs.get(rs1)) << " - " <<
-		hex0x32(regs.get(rs2)) << " = " << hex0x32(val) << std::endl;
-	}
+	for(uint32_t i = 0; i < r.load_width; ++i)
+		if(r.load_addr + i < size)
+			mem->set8(r.load_addr + i, r.load[i]);
 
-	regs.set(rd, val);
-	pc += 4;
+	replay_syscall = r.flags & trace_record::has_syscall;
+	replay_result = r.sys_ret;
+	tick();
+	replay_syscall = false;
 }
+
 /**
-* Simulates the execution of the add instruction.
+* Renders a binary trace written by run_recorded() into the text of
+* -i (and -r, if set) by replaying every record. Prints the summary of
+* run() at the end.
 *
-* @param insn is the instruction to be executed
+* @param in is the trace, its header already read.
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_add(uint32_t insn, std::ostream* pos)
+* @return false if the trace is cut short.
+********************************************************************/
+template<uint32_t XLEN>
+bool rv_hart<XLEN>::replay(trace_reader &in)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
+	trace_record r;
 
-	int32_t val = regs.get(rs1) + regs.get(rs2);
+	start_replay();
 
-	if (pos)
+	while(in.next(r))
 	{
-		std::string s = render_rtype(insn, "add");
-		s.resize(instruction_width, ' ');
-
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(regs.get(rs1)) << " + " <<
-		hex0x32(regs.get(rs2)) << " = " << hex0x32(val) << std::endl;
+		if(r.flags & trace_record::trace_end)
+		{
+			if(halted_by == halt_exit)
+				std::cout << "Execution terminated by exit(" << exit_status << ")\n";
+			else
+				std::cout << "Execution terminated by EBREAK instruction\n";
+			std::cout << r.insn_count << " instructions executed\n";
+			return true;
+		}
+		replay(r);
 	}
 
-	regs.set(rd, val);
-	pc += 4;
+	std::cerr << "The trace is cut short." << std::endl;
+	return false;
 }
 
 /**
-* Simulates the execution of the srai instruction.
+* Runs the program one tick() at a time with the given tracing policy,
+* which run() picks once so that the loop is instantiated without any
+* trace checks when there is nothing to trace.
 *
-* @param insn is the instruction to be executed
+* @param limit is the max amount of instructions to execute
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_srai(uint32_t insn, std::ostream* pos)
+* @param trace is the tracing policy
+********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::run_ticks(uint64_t limit, const T &trace)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	int32_t shamt = (insn & 0x01f00000) >> 20;
-	int32_t val = regs.get(rs1) >> shamt;
-
-	if (pos)
+	while(!halt)
 	{
-		std::string s = render_itype_shift(insn, "srai");
-		s.resize(instruction_width, ' ');
+		// If limit is set
+		if (limit != 0)
+		{
+			// When the count is limit, stop execution
+			if(insn_counter == limit)
+				stop(halt_limit);
+		}
 
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(regs.get(rs1)) << " >> " <<
-		shamt << " = " << hex0x32(val) << std::endl;
+		tick(trace);
 	}
-
-	regs.set(rd, val);
-	pc += 4;
 }
 
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
 /**
-* Simulates the execution of the srli instruction.
+* Runs the program out of the pre-decoded instruction cache using
+* direct-threaded dispatch: every handler ends with its own copy of
+* the fetch and an indirect jump to the label of the next handler,
+* instead of returning to a central loop. That gives the branch
+* predictor one indirect branch per handler to learn from and saves
+* the calls of the cached engine. Common pairs of instructions are
+* fused into one handler when they are decoded (see fuse_pair().)
+* Returns with halt set, either by an ebreak/illegal instruction, an
+* ecall that exits (or is not emulated) or because the limit was
+* reached.
+*
+* @tparam C tells that the C extension is enabled
 *
-* @param insn is the instruction to be executed
+* @param limit is the max amount of instructions to execute
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_srli(uint32_t insn, std::ostream* pos)
+* @note labels-as-values is a GNU extension, other compilers fall
+* back to the cached engine.
+**********************************************************************/
+template<uint32_t XLEN>
+template<bool C>
+void rv_hart<XLEN>::run_threaded(uint64_t limit)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = regs.get(get_rs1(insn));
-	int32_t shamt = (insn & 0x01f00000) >> 20;
-	int32_t val = rs1 >> shamt;
-
-	if (pos)
+	static void * const labels[kind_fused_end] =
 	{
-		std::string s = render_itype_shift(insn, "srli");
-		s.resize(instruction_width, ' ');
-
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(rs1) << " >> " <<
-		shamt << " = " << hex0x32(val) << std::endl;
-	}
-
-	regs.set(rd, val);
-	pc += 4;
+		&&do_decode, &&do_illegal, &&do_ebreak, &&do_ecall, &&do_fence,
+		&&do_lui, &&do_auipc, &&do_jal, &&do_jalr,
+		&&do_beq, &&do_bne, &&do_blt, &&do_bge, &&do_bltu, &&do_bgeu,
+		&&do_lb, &&do_lh, &&do_lw, &&do_lbu, &&do_lhu,
+		&&do_sb, &&do_sh, &&do_sw,
+		&&do_addi, &&do_slti, &&do_sltiu, &&do_xori, &&do_ori, &&do_andi,
+		&&do_slli, &&do_srli, &&do_srai,
+		&&do_add, &&do_sub, &&do_sll, &&do_slt, &&do_sltu,
+		&&do_xor, &&do_srl, &&do_sra, &&do_or, &&do_and,
+		&&do_mul, &&do_mulh, &&do_mulhsu, &&do_mulhu,
+		&&do_div, &&do_divu, &&do_rem, &&do_remu,
+		&&do_sh1add, &&do_sh2add, &&do_sh3add,
+		&&do_andn, &&do_orn, &&do_xnor,
+		&&do_min, &&do_minu, &&do_max, &&do_maxu,
+		&&do_rol, &&do_ror, &&do_rori,
+		&&do_clz, &&do_ctz, &&do_cpop, &&do_sext_b, &&do_sext_h, &&do_zext_h,
+		&&do_orc_b, &&do_rev8,
+		&&do_lwu, &&do_ld, &&do_sd,
+		&&do_addiw, &&do_slliw, &&do_srliw, &&do_sraiw,
+		&&do_addw, &&do_subw, &&do_sllw, &&do_srlw, &&do_sraw,
+		&&do_mulw, &&do_divw, &&do_divuw, &&do_remw, &&do_remuw,
+		&&do_lui_addi, &&do_auipc_jalr,
+		&&do_slt_branch, &&do_sltu_branch, &&do_slti_branch, &&do_sltiu_branch,
+		&&do_addi_branch,
+	};
+
+	const uint64_t size = mem->get_size();
+	uint64_t budget = UINT64_MAX;
+	decoded_insn *d;
+	const decoded_insn *s;
+	reg_t address;
+	uint32_t cond;
+
+	if(limit != 0)
+		budget = (insn_counter < limit) ? limit - insn_counter : 0;
+
+	// the length of the instruction of a slot, always 4 without the C
+	// extension so that pc does not wait for the slot to be loaded
+#define LEN(slot) (C ? (slot)->len : 4)
+
+	// count the instruction, then jump to the handler of the slot at pc
+#define DISPATCH()						\
+	do {							\
+		if(budget == 0)					\
+			goto done;				\
+		--budget;					\
+		++insn_counter;					\
+		if((pc & 1) != 0 || pc >= size)			\
+			goto uncached;				\
+		d = &icache.at(pc);				\
+		goto *labels[d->kind];				\
+	} while(0)
+
+	DISPATCH();
+
+uncached:
+	dcex(fetch(pc), no_trace());
+	if(halt)
+		return;
+	DISPATCH();
+
+do_decode:
+	*d = fetch_decoded(pc);
+	fuse_pair(d);
+	goto *labels[d->kind];
+
+do_illegal:
+	stop(halt_illegal);
+	return;
+
+do_ebreak:
+	stop(halt_ebreak);
+	return;
+
+do_ecall:
+	if(!system_call())
+		return;
+	pc += LEN(d);
+	DISPATCH();
+
+do_fence:
+	pc += LEN(d);
+	DISPATCH();
+
+do_lui:
+	regs.set(d->rd, d->imm);
+	pc += LEN(d);
+	DISPATCH();
+
+do_auipc:
+	regs.set(d->rd, d->imm + pc);
+	pc += LEN(d);
+	DISPATCH();
+
+do_jal:
+	regs.set(d->rd, pc + LEN(d));
+	note_edge(pc, pc + d->imm);
+	pc += d->imm;
+	DISPATCH();
+
+do_jalr:
+	address = ((reg_t)regs.get(d->rs1) + d->imm) & ~(reg_t)1;
+	regs.set(d->rd, pc + LEN(d));
+	note_edge(pc, address);
+	pc = address;
+	DISPATCH();
+
+do_beq:
+	branch(regs.get(d->rs1) == regs.get(d->rs2), d->imm, LEN(d));
+	DISPATCH();
+
+do_bne:
+	branch(regs.get(d->rs1) != regs.get(d->rs2), d->imm, LEN(d));
+	DISPATCH();
+
+do_blt:
+	branch(regs.get(d->rs1) < regs.get(d->rs2), d->imm, LEN(d));
+	DISPATCH();
+
+do_bge:
+	branch(regs.get(d->rs1) >= regs.get(d->rs2), d->imm, LEN(d));
+	DISPATCH();
+
+do_bltu:
+	branch((reg_t)regs.get(d->rs1) < (reg_t)regs.get(d->rs2), d->imm, LEN(d));
+	DISPATCH();
+
+do_bgeu:
+	branch((reg_t)regs.get(d->rs1) >= (reg_t)regs.get(d->rs2), d->imm, LEN(d));
+	DISPATCH();
+
+do_lb:
+	regs.set(d->rd, (int8_t)mem->get8((reg_t)regs.get(d->rs1) + d->imm));
+	pc += LEN(d);
+	DISPATCH();
+
+do_lh:
+	regs.set(d->rd, (int16_t)mem->get16((reg_t)regs.get(d->rs1) + d->imm));
+	pc += LEN(d);
+	DISPATCH();
+
+do_lw:
+	regs.set(d->rd, (int32_t)mem->get32((reg_t)regs.get(d->rs1) + d->imm));
+	pc += LEN(d);
+	DISPATCH();
+
+do_lbu:
+	regs.set(d->rd, mem->get8((reg_t)regs.get(d->rs1) + d->imm));
+	pc += LEN(d);
+	DISPATCH();
+
+do_lhu:
+	regs.set(d->rd, mem->get16((reg_t)regs.get(d->rs1) + d->imm));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sb:
+	address = (reg_t)regs.get(d->rs1) + d->imm;
+	mem->set8(address, regs.get(d->rs2));
+	invalidate_icache(address, 1);
+	pc += LEN(d);
+	DISPATCH();
+
+do_sh:
+	address = (reg_t)regs.get(d->rs1) + d->imm;
+	mem->set16(address, regs.get(d->rs2));
+	invalidate_icache(address, 2);
+	pc += LEN(d);
+	DISPATCH();
+
+do_sw:
+	address = (reg_t)regs.get(d->rs1) + d->imm;
+	mem->set32(address, regs.get(d->rs2));
+	invalidate_icache(address, 4);
+	pc += LEN(d);
+	DISPATCH();
+
+do_addi:
+	regs.set(d->rd, (reg_t)regs.get(d->rs1) + d->imm);
+	pc += LEN(d);
+	DISPATCH();
+
+do_slti:
+	regs.set(d->rd, (regs.get(d->rs1) < d->imm) ? 1 : 0);
+	pc += LEN(d);
+	DISPATCH();
+
+do_sltiu:
+	regs.set(d->rd, ((reg_t)regs.get(d->rs1) < (reg_t)d->imm) ? 1 : 0);
+	pc += LEN(d);
+	DISPATCH();
+
+do_xori:
+	regs.set(d->rd, regs.get(d->rs1) ^ d->imm);
+	pc += LEN(d);
+	DISPATCH();
+
+do_ori:
+	regs.set(d->rd, regs.get(d->rs1) | d->imm);
+	pc += LEN(d);
+	DISPATCH();
+
+do_andi:
+	regs.set(d->rd, regs.get(d->rs1) & d->imm);
+	pc += LEN(d);
+	DISPATCH();
+
+do_slli:
+	regs.set(d->rd, (reg_t)regs.get(d->rs1) << d->imm);
+	pc += LEN(d);
+	DISPATCH();
+
+do_srli:
+	regs.set(d->rd, (reg_t)regs.get(d->rs1) >> d->imm);
+	pc += LEN(d);
+	DISPATCH();
+
+do_srai:
+	regs.set(d->rd, regs.get(d->rs1) >> d->imm);
+	pc += LEN(d);
+	DISPATCH();
+
+do_add:
+	regs.set(d->rd, (reg_t)regs.get(d->rs1) + regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sub:
+	regs.set(d->rd, (reg_t)regs.get(d->rs1) - regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sll:
+	regs.set(d->rd, (reg_t)regs.get(d->rs1) << (regs.get(d->rs2) & (XLEN - 1)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_slt:
+	regs.set(d->rd, (regs.get(d->rs1) < regs.get(d->rs2)) ? 1 : 0);
+	pc += LEN(d);
+	DISPATCH();
+
+do_sltu:
+	regs.set(d->rd, ((reg_t)regs.get(d->rs1) < (reg_t)regs.get(d->rs2)) ? 1 : 0);
+	pc += LEN(d);
+	DISPATCH();
+
+do_xor:
+	regs.set(d->rd, regs.get(d->rs1) ^ regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_srl:
+	regs.set(d->rd, (reg_t)regs.get(d->rs1) >> (regs.get(d->rs2) & (XLEN - 1)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sra:
+	regs.set(d->rd, regs.get(d->rs1) >> (regs.get(d->rs2) & (XLEN - 1)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_or:
+	regs.set(d->rd, regs.get(d->rs1) | regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_and:
+	regs.set(d->rd, regs.get(d->rs1) & regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_mul:
+	regs.set(d->rd, (reg_t)regs.get(d->rs1) * (reg_t)regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_mulh:
+	regs.set(d->rd, calc_mulh(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_mulhsu:
+	regs.set(d->rd, calc_mulhsu(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_mulhu:
+	regs.set(d->rd, calc_mulhu(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_div:
+	regs.set(d->rd, calc_div(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_divu:
+	regs.set(d->rd, calc_divu(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_rem:
+	regs.set(d->rd, calc_rem(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_remu:
+	regs.set(d->rd, calc_remu(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sh1add:
+	regs.set(d->rd, ((reg_t)regs.get(d->rs1) << 1) + (reg_t)regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sh2add:
+	regs.set(d->rd, ((reg_t)regs.get(d->rs1) << 2) + (reg_t)regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sh3add:
+	regs.set(d->rd, ((reg_t)regs.get(d->rs1) << 3) + (reg_t)regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_andn:
+	regs.set(d->rd, regs.get(d->rs1) & ~regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_orn:
+	regs.set(d->rd, regs.get(d->rs1) | ~regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_xnor:
+	regs.set(d->rd, ~(regs.get(d->rs1) ^ regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_min:
+	regs.set(d->rd, regs.get(d->rs1) < regs.get(d->rs2) ? regs.get(d->rs1) : regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_minu:
+	regs.set(d->rd, (reg_t)regs.get(d->rs1) < (reg_t)regs.get(d->rs2) ? regs.get(d->rs1) : regs.get(d->rs2));
+	pc += LEN(d);
+	DISPATCH();
+
+do_max:
+	regs.set(d->rd, regs.get(d->rs1) < regs.get(d->rs2) ? regs.get(d->rs2) : regs.get(d->rs1));
+	pc += LEN(d);
+	DISPATCH();
+
+do_maxu:
+	regs.set(d->rd, (reg_t)regs.get(d->rs1) < (reg_t)regs.get(d->rs2) ? regs.get(d->rs2) : regs.get(d->rs1));
+	pc += LEN(d);
+	DISPATCH();
+
+do_rol:
+	regs.set(d->rd, calc_rol(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_ror:
+	regs.set(d->rd, calc_ror(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_rori:
+	regs.set(d->rd, calc_ror(regs.get(d->rs1), d->imm));
+	pc += LEN(d);
+	DISPATCH();
+
+do_clz:
+	regs.set(d->rd, calc_clz(regs.get(d->rs1)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_ctz:
+	regs.set(d->rd, calc_ctz(regs.get(d->rs1)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_cpop:
+	regs.set(d->rd, calc_cpop(regs.get(d->rs1)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sext_b:
+	regs.set(d->rd, (int8_t)regs.get(d->rs1));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sext_h:
+	regs.set(d->rd, (int16_t)regs.get(d->rs1));
+	pc += LEN(d);
+	DISPATCH();
+
+do_zext_h:
+	regs.set(d->rd, regs.get(d->rs1) & 0xffff);
+	pc += LEN(d);
+	DISPATCH();
+
+do_orc_b:
+	regs.set(d->rd, calc_orc_b(regs.get(d->rs1)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_rev8:
+	regs.set(d->rd, calc_rev8(regs.get(d->rs1)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_lwu:
+	regs.set(d->rd, mem->get32((reg_t)regs.get(d->rs1) + d->imm));
+	pc += LEN(d);
+	DISPATCH();
+
+do_ld:
+	regs.set(d->rd, mem->get64((reg_t)regs.get(d->rs1) + d->imm));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sd:
+	address = (reg_t)regs.get(d->rs1) + d->imm;
+	mem->set64(address, regs.get(d->rs2));
+	invalidate_icache(address, 8);
+	pc += LEN(d);
+	DISPATCH();
+
+do_addiw:
+	regs.set(d->rd, (int32_t)((reg_t)regs.get(d->rs1) + d->imm));
+	pc += LEN(d);
+	DISPATCH();
+
+do_slliw:
+	regs.set(d->rd, (int32_t)((uint32_t)regs.get(d->rs1) << d->imm));
+	pc += LEN(d);
+	DISPATCH();
+
+do_srliw:
+	regs.set(d->rd, (int32_t)((uint32_t)regs.get(d->rs1) >> d->imm));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sraiw:
+	regs.set(d->rd, (int32_t)regs.get(d->rs1) >> d->imm);
+	pc += LEN(d);
+	DISPATCH();
+
+do_addw:
+	regs.set(d->rd, (int32_t)((uint32_t)regs.get(d->rs1) + (uint32_t)regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_subw:
+	regs.set(d->rd, (int32_t)((uint32_t)regs.get(d->rs1) - (uint32_t)regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sllw:
+	regs.set(d->rd, (int32_t)((uint32_t)regs.get(d->rs1) << (regs.get(d->rs2) & 0x1f)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_srlw:
+	regs.set(d->rd, (int32_t)((uint32_t)regs.get(d->rs1) >> (regs.get(d->rs2) & 0x1f)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_sraw:
+	regs.set(d->rd, (int32_t)regs.get(d->rs1) >> (regs.get(d->rs2) & 0x1f));
+	pc += LEN(d);
+	DISPATCH();
+
+do_mulw:
+	regs.set(d->rd, (int32_t)((uint32_t)regs.get(d->rs1) * (uint32_t)regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_divw:
+	regs.set(d->rd, calc_divw(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_divuw:
+	regs.set(d->rd, calc_divuw(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_remw:
+	regs.set(d->rd, calc_remw(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+do_remuw:
+	regs.set(d->rd, calc_remuw(regs.get(d->rs1), regs.get(d->rs2)));
+	pc += LEN(d);
+	DISPATCH();
+
+	// The fused pairs: d is the first instruction, s the second (in
+	// the slot right after the first one.) The second one is counted
+	// here, or left for the next dispatch (which stops) when the
+	// budget only covers the first one.
+#define COUNT_SECOND(first)					\
+	do {							\
+		if(budget == 0)					\
+			goto first;				\
+		--budget;					\
+		++insn_counter;					\
+		s = d + (LEN(d) >> 1);				\
+	} while(0)
+
+do_lui_addi:
+	COUNT_SECOND(do_lui);
+	regs.set(d->rd, (reg_t)d->imm + s->imm);
+	pc += LEN(d) + LEN(s);
+	DISPATCH();
+
+do_auipc_jalr:
+	COUNT_SECOND(do_auipc);
+	regs.set(d->rd, d->imm + pc);
+	address = (d->imm + pc + s->imm) & ~(reg_t)1;
+	regs.set(s->rd, pc + LEN(d) + LEN(s));
+	note_edge(pc + LEN(d), address);
+	pc = address;
+	DISPATCH();
+
+do_slt_branch:
+	COUNT_SECOND(do_slt);
+	cond = regs.get(d->rs1) < regs.get(d->rs2);
+	goto set_and_branch;
+
+do_sltu_branch:
+	COUNT_SECOND(do_sltu);
+	cond = (reg_t)regs.get(d->rs1) < (reg_t)regs.get(d->rs2);
+	goto set_and_branch;
+
+do_slti_branch:
+	COUNT_SECOND(do_slti);
+	cond = regs.get(d->rs1) < d->imm;
+	goto set_and_branch;
+
+do_sltiu_branch:
+	COUNT_SECOND(do_sltiu);
+	cond = (reg_t)regs.get(d->rs1) < (reg_t)d->imm;
+
+set_and_branch:
+	// the branch is a beq or bne of rd against x0
+	regs.set(d->rd, cond);
+	pc += LEN(d);
+	branch((cond != 0) == (s->kind == kind_bne), s->imm, LEN(s));
+	DISPATCH();
+
+do_addi_branch:
+	COUNT_SECOND(do_addi);
+	regs.set(d->rd, (reg_t)regs.get(d->rs1) + d->imm);
+	pc += LEN(d);
+	branch(branch_taken(*s), s->imm, LEN(s));
+	DISPATCH();
+
+done:
+	stop(halt_limit);
+#undef COUNT_SECOND
+#undef DISPATCH
+#undef LEN
 }
 
+#pragma GCC diagnostic pop
+#else
 /**
-* Simulates the execution of the slli instruction.
+* Without labels-as-values the threaded engine is the cached engine.
 *
-* @param insn is the instruction to be executed
+* @tparam C tells that the C extension is enabled
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_slli(uint32_t insn, std::ostream* pos)
+* @param limit is the max amount of instructions to execute
+**********************************************************************/
+template<uint32_t XLEN>
+template<bool C>
+void rv_hart<XLEN>::run_threaded(uint64_t limit)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	int32_t shamt = (insn & 0x01f00000) >> 20;
-	int32_t val = regs.get(rs1) << shamt;
-
-	if (pos)
+	while(!halt)
 	{
-		std::string s = render_itype_shift(insn, "slli");
-		s.resize(instruction_width, ' ');
-
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(regs.get(rs1)) << " << " <<
-		shamt << " = " << hex0x32(val) << std::endl;
+		if(limit != 0 && insn_counter == limit)
+			stop(halt_limit);
+		else
+		{
+			insn_counter++;
+			exec_cached();
+		}
 	}
-
-	regs.set(rd, val);
-	pc += 4;
 }
+#endif
 
 /**
-* Simulates the execution of the andi instruction.
-*
-* @param insn is the instruction to be executed
-*
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_andi(uint32_t insn, std::ostream* pos)
+* Discards every translated block.
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::flush_blocks()
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	int32_t imm_i = get_imm_i(insn);
-	int32_t val = regs.get(rs1) & imm_i;
-
-	if (pos)
-	{
-		std::string s = render_itype_alu(insn, "andi", imm_i);
-		s.resize(instruction_width, ' ');
+	for(translated_block *b : block_list)
+		delete b;
+	block_list.clear();
 
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(regs.get(rs1)) << " & " <<
-		hex0x32(imm_i) << " = " << hex0x32(val) << std::endl;
-	}
+	block_map.reset(mem->get_size(), nullptr);
+	block_code.reset(mem->get_size(), 0);
+	blocks_stale = false;
 
-	regs.set(rd, val);
-	pc += 4;
+	if(jitter)
+		jitter->reset();
 }
 
 /**
-* Simulates the execution of the ori instruction.
+* Decodes the basic block starting at addr into a new translated_block.
+* The block ends after the first jal, jalr, branch, ecall, ebreak or illegal
+* instruction, at the end of a 4 KiB page or after max_block_insns.
 *
-* @param insn is the instruction to be executed
+* @param addr is the even, in range address of the block
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_ori(uint32_t insn, std::ostream* pos)
+* @return the new block
+**********************************************************************/
+template<uint32_t XLEN>
+typename rv_hart<XLEN>::translated_block *rv_hart<XLEN>::translate_block(reg_t addr)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	int32_t imm_i = get_imm_i(insn);
-	int32_t val = regs.get(rs1) | imm_i;
-
-	if (pos)
+	translated_block *b = new translated_block;
+	b->start = addr;
+	b->chain[0] = nullptr;
+	b->chain[1] = nullptr;
+	b->heat = 0;
+	b->native = nullptr;
+
+	uint32_t a = addr;
+	while(a < mem->get_size() && b->ops.size() < max_block_insns)
 	{
-		std::string s = render_itype_alu(insn, "ori", imm_i);
-		s.resize(instruction_width, ' ');
-
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(regs.get(rs1)) << " | " <<
-		hex0x32(imm_i) << " = " << hex0x32(val) << std::endl;
+		decoded_insn d = fetch_decoded(a);
+		b->ops.push_back(d);
+		block_code.at(a) = 1;
+		if(d.len == 4 && a + 2 < mem->get_size())
+			block_code.at(a + 2) = 1;
+		a += d.len;
+
+		if(d.kind == kind_jal || d.kind == kind_jalr || d.kind == kind_ebreak ||
+		   d.kind == kind_ecall || d.kind == kind_illegal ||
+		   (d.kind >= kind_beq && d.kind <= kind_bgeu))
+			break;
+		if((a & 0xfff) < d.len)
+			break;		// do not run into the next page
 	}
-
-	regs.set(rd, val);
-	pc += 4;
+	b->end = a;
+	b->ops.shrink_to_fit();
+	block_list.push_back(b);
+	return b;
 }
 
 /**
-* Simulates the execution of the xori instruction.
+* Returns the translated block starting at addr, translating it first
+* if needed.
 *
-* @param insn is the instruction to be executed
+* @param addr is the address of the block
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_xori(uint32_t insn, std::ostream* pos)
+* @return the block, or nullptr if addr can not hold a block (it is
+* odd or not in the memory.)
+**********************************************************************/
+template<uint32_t XLEN>
+typename rv_hart<XLEN>::translated_block *rv_hart<XLEN>::lookup_block(reg_t addr)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	int32_t imm_i = get_imm_i(insn);
-	int32_t val = regs.get(rs1) ^ imm_i;
+	if((addr & 1) != 0 || addr >= mem->get_size())
+		return nullptr;
 
-	if (pos)
-	{
-		std::string s = render_itype_alu(insn, "xori", imm_i);
-		s.resize(instruction_width, ' ');
+	translated_block *&b = block_map.at(addr);
+	if(!b)
+		b = translate_block(addr);
+	return b;
+}
 
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(regs.get(rs1)) << " ^ " <<
-		hex0x32(imm_i) << " = " << hex0x32(val) << std::endl;
-	}
+#if RV_HART_XLEN == 32
 
-	regs.set(rd, val);
-	pc += 4;
+/**
+* Runs the native code of a block compiled by the JIT.
+*
+* @param b is the block, with native code
+*
+* @return the pc the code left the block at
+**********************************************************************/
+template<>
+uint32_t rv32i::run_native(const translated_block *b)
+{
+	return b->native(regs.data(), this);
 }
 
 /**
-* Simulates the execution of the sltiu instruction.
+* Compiles a hot block with the JIT.
 *
-* @param insn is the instruction to be executed
+* @param b is the block
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_sltiu(uint32_t insn, std::ostream* pos)
+* @return its native code, or nullptr if it could not be compiled
+**********************************************************************/
+template<>
+jit::native_block rv32i::compile_native(const translated_block *b)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = regs.get(get_rs1(insn));
-	uint32_t imm_i = get_imm_i(insn);
-	int32_t val = (rs1 < imm_i) ? 1 : 0;
+	return jitter->compile(*b, cov_map);
+}
 
-	if (pos)
-	{
-		std::string s = render_itype_alu(insn, "sltiu", imm_i);
-		s.resize(instruction_width, ' ');
+#else
 
-		*pos << s << "// " << "x" << rd << " = (" << hex0x32(rs1) << " <U " <<
-		imm_i << ") ? 1 : 0 = " << hex0x32(val) << std::endl;
-	}
+/**
+* The JIT only makes x86-64 code for RV32, an rv64i hart never creates
+* one (see run_blocks()) and its blocks never have native code.
+**********************************************************************/
+template<>
+uint64_t rv64i::run_native(const translated_block *b)
+{
+	(void)b;
+	return pc;
+}
 
-	regs.set(rd, val);
-	pc += 4;
+/**
+* See run_native(), there is no native code for RV64.
+**********************************************************************/
+template<>
+jit::native_block rv64i::compile_native(const translated_block *b)
+{
+	(void)b;
+	return nullptr;
 }
 
+#endif
+
 /**
-* Simulates the execution of the slti instruction.
-*
-* @param insn is the instruction to be executed
+* Runs the program one basic block at a time. insn_counter and the
+* limit are updated once per block. With engine_jit, a block is
+* compiled to native code after running jit::hot_threshold times in
+* the interpreter (if there is no JIT for the host it just stays
+* interpreted, and so it does with XLEN 64.) After a block, execution goes
+* straight to the successor remembered in its chain[] when the pc
+* matches, so a hot loop does not go through lookup_block() at all.
+* When a store writes to a word that belongs to a translated block,
+* the block being executed is left after the store and the blocks are
+* translated again. Returns with halt set.
 *
-* @param pos is the ostream object
-*********************************************************************/
-void rv32i::exec_slti(uint32_t insn, std::ostream* pos)
+* @param limit is the max amount of instructions to execute
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::run_blocks(uint64_t limit)
 {
-	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = get_rs1(insn);
-	int32_t imm_i = get_imm_i(insn);
-	int32_t val = (regs.get(rs1) < imm_i) ? 1 : 0;
+	uint64_t budget = UINT64_MAX;
 
-	if (pos)
+	if(XLEN == 32 && engine == engine_jit && !jitter)
 	{
-		std::string s = render_itype_alu(insn, "slti", imm_i);
-		s.resize(instruction_width, ' ');
-
-		*pos << s << "// " << "x" << rd << " = (" << hex0x32(regs.get(rs1)) << " < " <<
-		imm_i << ") ? 1 : 0 = " << hex0x32(val) << std::endl;
+		jitter = new jit;
+		if(!jitter->is_available())
+		{
+			delete jitter;
+			jitter = nullptr;
+		}
 	}
 
-	regs.set(rd, val);
-	pc += 4;
-}
+	if(limit != 0)
+		budget = (insn_counter < limit) ? limit - insn_counter : 0;
+
+	translated_block *b = lookup_block(pc);
+
+	while(!halt)
+	{
+		if(!b || b->ops.size() > budget)
+		{
+			// no block here or not enough budget left for the
+			// whole block: single step the slow way
+			if(budget == 0)
+			{
+				stop(halt_limit);
+				break;
+			}
+			--budget;
+			++insn_counter;
+			exec_cached();
+			if(blocks_stale)
+				flush_blocks();
+			b = lookup_block(pc);
+			continue;
+		}
+
+		const uint32_t n = b->ops.size();
+		budget -= n;
+		insn_counter += n;
+
+		if(b->native)
+		{
+			pc = run_native(b);
+			if(blocks_stale)
+			{
+				// the native code returned right after the store
+				uint32_t done = 0;
+				for(uint32_t a = b->start; a != pc; a += b->ops[done++].len)
+					;
+				budget += n - done;
+				insn_counter -= n - done;
+			}
+		}
+		else
+		{
+			const decoded_insn *op = b->ops.data();
+			for(uint32_t i = 0; i < n; ++i)
+			{
+				op[i].exec(this, op[i]);
+				if(blocks_stale)
+				{
+					// leave the block right after the store
+					budget += n - i - 1;
+					insn_counter -= n - i - 1;
+					break;
+				}
+			}
+
+			if(jitter && ++b->heat == jit::hot_threshold)
+			{
+				b->native = compile_native(b);
+				if(jitter->is_full())
+					blocks_stale = true;	// start over with an empty buffer
+			}
+		}
+
+		if(blocks_stale)
+		{
+			flush_blocks();
+			b = lookup_block(pc);
+			continue;
+		}
+
+		translated_block *next;
+		if(b->chain[0] && b->chain[0]->start == pc)
+			next = b->chain[0];
+		else if(b->chain[1] && b->chain[1]->start == pc)
+			next = b->chain[1];
+		else
+		{
+			next = lookup_block(pc);
+			b->chain[b->chain[0] ? 1 : 0] = next;
+		}
+		b = next;
+	}
+}
 
 /**
-* Simulates the execution of the sw instruction.
+* Simulates the execution of the fence instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_sw(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_fence(uint32_t insn, const T &trace)
 {
-	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	int32_t imm_s = get_imm_s(insn);
-	int32_t address = regs.get(rs1) + imm_s;
-	int32_t value = regs.get(rs2);
-
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_stype(insn, "sw");
-		s.resize(instruction_width, ' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// m32(" << hex0x32(regs.get(rs1)) << " + " <<
-		hex0x32(imm_s) << ") = " << hex0x32(value) << std::endl;
+		line << "// fence" << '\n';
+		*trace.pos << line;
 	}
-
-	mem->set32(address, value);
-	pc += 4;
+	
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the sh instruction.
+* Simulates the execution of the mul instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_sh(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_mul(uint32_t insn, const T &trace)
 {
+	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
 	uint32_t rs2 = get_rs2(insn);
-	int32_t imm_s = get_imm_s(insn);
-	int32_t address = regs.get(rs1) + imm_s;
-	int32_t value = regs.get(rs2) & 0x0000ffff;
+	sreg_t val = (reg_t)regs.get(rs1) * (reg_t)regs.get(rs2);
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_stype(insn, "sh");
-		s.resize(instruction_width, ' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// m16(" << hex0x32(regs.get(rs1)) << " + " <<
-		hex0x32(imm_s) << ") = " << hex0x32(value) << std::endl;
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " * " <<
+		hex0x(regs.get(rs2)) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	mem->set16(address, value);
-	pc += 4;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the sb instruction.
+* Simulates the execution of the mulh instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_sb(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_mulh(uint32_t insn, const T &trace)
 {
+	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
 	uint32_t rs2 = get_rs2(insn);
-	int32_t imm_s = get_imm_s(insn);
-	int32_t address = regs.get(rs1) + imm_s;
-	int32_t value = regs.get(rs2) & 0x000000ff;
+	sreg_t val = calc_mulh(regs.get(rs1), regs.get(rs2));
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_stype(insn, "sb");
-		s.resize(instruction_width, ' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// m8(" << hex0x32(regs.get(rs1)) << " + " <<
-		hex0x32(imm_s) << ") = " << hex0x32(value) << std::endl;
+		line << "// " << "x" << rd << " = (" << hex0x(regs.get(rs1)) << " * " <<
+		hex0x(regs.get(rs2)) << ") >> " << XLEN << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	mem->set8(address, value);
-	pc += 4;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the lw instruction.
+* Simulates the execution of the mulhsu instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_lw(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_mulhsu(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = regs.get(get_rs1(insn));
-	int32_t imm_i = get_imm_i(insn);
-	int32_t val = rs1 + imm_i;
-	int32_t from_address = mem->get32(val);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = calc_mulhsu(regs.get(rs1), regs.get(rs2));
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_itype_load(insn, "lw");
-		s.resize(instruction_width, ' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// x" << rd << " = sx(m32(" << hex0x32(rs1) << " + " <<
-		hex0x32(imm_i) << ")) = " << hex0x32(from_address) << std::endl;
+		line << "// " << "x" << rd << " = (" << hex0x(regs.get(rs1)) << " * " <<
+		hex0x(regs.get(rs2)) << ") >> " << XLEN << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	regs.set(rd, from_address);
-	pc += 4;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the lh instruction.
+* Simulates the execution of the mulhu instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_lh(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_mulhu(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = regs.get(get_rs1(insn));
-	int32_t imm_i = get_imm_i(insn);
-	int32_t val = rs1 + imm_i;
-	int32_t from_address = mem->get16(val);
-
-	if (from_address & 0x00008000)      // sign extend
-		from_address |= 0xffff0000;
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = calc_mulhu(regs.get(rs1), regs.get(rs2));
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_itype_load(insn, "lh");
-		s.resize(instruction_width, ' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// x" << rd << " = sx(m16(" << hex0x32(rs1) << " + " <<
-		hex0x32(imm_i) << ")) = " << hex0x32(from_address) << std::endl;
+		line << "// " << "x" << rd << " = (" << hex0x(regs.get(rs1)) << " * " <<
+		hex0x(regs.get(rs2)) << ") >> " << XLEN << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	regs.set(rd, from_address);
-	pc += 4;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the lb instruction.
+* Simulates the execution of the div instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_lb(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_div(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = regs.get(get_rs1(insn));
-	int32_t imm_i = get_imm_i(insn);
-	int32_t val = rs1 + imm_i;
-	int32_t from_address = mem->get8(val);
-
-	if (from_address & 0x00000080)      // sign extend
-		from_address |= 0xffffff00;
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = calc_div(regs.get(rs1), regs.get(rs2));
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_itype_load(insn, "lb");
-		s.resize(instruction_width, ' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// x" << rd << " = sx(m8(" << hex0x32(rs1) << " + " <<
-		hex0x32(imm_i) << ")) = " << hex0x32(from_address) << std::endl;
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " / " <<
+		hex0x(regs.get(rs2)) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	regs.set(rd, from_address);
-	pc += 4;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the lhu instruction.
+* Simulates the execution of the divu instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_lhu(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_divu(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = regs.get(get_rs1(insn));
-	int32_t imm_i = get_imm_i(insn);
-	int32_t val = rs1 + imm_i;
-	int32_t from_address = mem->get16(val);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = calc_divu(regs.get(rs1), regs.get(rs2));
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_itype_load(insn, "lhu");
-		s.resize(instruction_width, ' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// x" << rd << " = zx(m16(" << hex0x32(rs1) << " + " <<
-		hex0x32(imm_i) << ")) = " << hex0x32(from_address) << std::endl;
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " / " <<
+		hex0x(regs.get(rs2)) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	regs.set(rd, from_address);
-	pc += 4;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the lbu instruction.
+* Simulates the execution of the rem instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_lbu(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_rem(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
-	uint32_t rs1 = regs.get(get_rs1(insn));
-	int32_t imm_i = get_imm_i(insn);
-	int32_t val = rs1 + imm_i;
-	int32_t from_address = mem->get8(val);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = calc_rem(regs.get(rs1), regs.get(rs2));
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_itype_load(insn, "lbu");
-		s.resize(instruction_width, ' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// x" << rd << " = zx(m8(" << hex0x32(rs1) << " + " <<
-		hex0x32(imm_i) << ")) = " << hex0x32(from_address) << std::endl;
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " % " <<
+		hex0x(regs.get(rs2)) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	regs.set(rd, from_address);
-	pc += 4;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the addi instruction.
+* Simulates the execution of the remu instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_addi(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_remu(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
-	int32_t imm_i = get_imm_i(insn);
-	int32_t val = regs.get(rs1) + imm_i;
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = calc_remu(regs.get(rs1), regs.get(rs2));
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_itype_alu(insn, "addi", imm_i);
-		s.resize(instruction_width, ' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(regs.get(rs1)) << " + " <<
-		hex0x32(imm_i) << " = " << hex0x32(val) << std::endl;
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " % " <<
+		hex0x(regs.get(rs2)) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
 	regs.set(rd, val);
-	pc += 4;
+	pc += insn_len;
 }
 
 /**
-* Sets the halt flag to terminate the loop, and if the ostream* param
-* is not nullptr, it calls render_illegal_insn() to render the proper
-* error message.
+* Simulates the execution of the sh1add instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
-**********************************************************************/
-void rv32i::exec_illegal_insn(uint32_t insn, std::ostream* pos)
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sh1add(uint32_t insn, const T &trace)
 {
-	(void)insn;
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = ((reg_t)regs.get(rs1) << 1) + (reg_t)regs.get(rs2);
 
-	if(pos)
+	if (T::enabled)
 	{
-		std::string s = render_illegal_insn();
-		s.resize(instruction_width, ' ');
-		*pos << s << std::endl;
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = (" << hex0x(regs.get(rs1)) << " << 1) + " << hex0x(regs.get(rs2)) << " = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
 	}
-	halt = true;
+
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the ebreak instruction.
+* Simulates the execution of the sh2add instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_ebreak(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sh2add(uint32_t insn, const T &trace)
 {
-	if(pos)
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = ((reg_t)regs.get(rs1) << 2) + (reg_t)regs.get(rs2);
+
+	if (T::enabled)
 	{
-		std::string s = render_ecall_ebreak(insn);
-		s.resize(instruction_width, ' ');
-		*pos << s << "// HALT" << std::endl;
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = (" << hex0x(regs.get(rs1)) << " << 2) + " << hex0x(regs.get(rs2)) << " = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
 	}
-	halt = true;
+
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the lui instruction.
+* Simulates the execution of the sh3add instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_lui(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sh3add(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
-	int32_t imm_u = get_imm_u(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = ((reg_t)regs.get(rs1) << 3) + (reg_t)regs.get(rs2);
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_lui(insn);
-		s.resize(instruction_width,' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(imm_u) << std::endl;
+		line << "// " << "x" << rd << " = (" << hex0x(regs.get(rs1)) << " << 3) + " << hex0x(regs.get(rs2)) << " = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
 	}
-	
-	regs.set(rd, imm_u);
-	pc += 4;
+
+	regs.set(rd, val);
+	pc += insn_len;
 }
-	
+
 /**
-* Simulates the execution of the auipc instruction.
+* Simulates the execution of the andn instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_auipc(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_andn(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
-	int32_t imm_u = get_imm_u(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = regs.get(rs1) & ~regs.get(rs2);
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_auipc(insn);
-		s.resize(instruction_width,' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(pc) << " + "
-		<< hex0x32(imm_u) << " = " << hex0x32(imm_u+pc) << std::endl;
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " & ~" << hex0x(regs.get(rs2)) << " = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	regs.set(rd, imm_u+pc);
-	pc += 4;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the jal instruction.
+* Simulates the execution of the orn instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_jal(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_orn(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
-	int32_t imm_j = get_imm_j(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = regs.get(rs1) | ~regs.get(rs2);
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_jal(insn);
-		s.resize(instruction_width,' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(pc+4) << ", "
-		<< " pc = " << hex0x32(pc) << " + " << hex0x32(imm_j) << " = " << hex0x32(pc+imm_j) << std::endl;
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " | ~" << hex0x(regs.get(rs2)) << " = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	regs.set(rd, pc+4);
-	pc = pc + imm_j;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the jalr instruction.
+* Simulates the execution of the xnor instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
+* @param trace is the tracing policy
 *********************************************************************/
-void rv32i::exec_jalr(uint32_t insn, std::ostream* pos)
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_xnor(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
-	int32_t imm_i = get_imm_i(insn);
 	uint32_t rs1 = get_rs1(insn);
-	int32_t val = (regs.get(rs1) + imm_i) & 0xfffffffe;
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = ~(regs.get(rs1) ^ regs.get(rs2));
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_itype_load(insn, "jalr");
-		s.resize(instruction_width,' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// " << "x" << rd << " = " << hex0x32(pc+4) << ", "
-		<< " pc = (" << hex0x32(imm_i) << " + " << hex0x32(regs.get(rs1)) << ") & " << hex0x32(0xfffffffe) 
-		<< " = " << hex0x32(val)<< std::endl;
+		line << "// " << "x" << rd << " = ~(" << hex0x(regs.get(rs1)) << " ^ " << hex0x(regs.get(rs2)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	regs.set(rd, pc+4);
-	pc = val;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the bne instruction.
+* Simulates the execution of the min instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
-**********************************************************************/
-void rv32i::exec_bne(uint32_t insn, std::ostream* pos)
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_min(uint32_t insn, const T &trace)
 {
+	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
 	uint32_t rs2 = get_rs2(insn);
-	int32_t imm_b = get_imm_b(insn);
-	int32_t val = ((regs.get(rs1) != regs.get(rs2)) ? imm_b : 4);
+	sreg_t val = regs.get(rs1) < regs.get(rs2) ? regs.get(rs1) : regs.get(rs2);
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_btype(insn, "bne");
-		s.resize(instruction_width,' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// " << "pc += (" << hex0x32(regs.get(rs1)) << " != " << hex0x32(regs.get(rs2)) << " ? " <<
-		hex0x32(imm_b) << " : 4) = " << hex0x32(pc+val) << std::endl; 
+		line << "// " << "x" << rd << " = min(" << hex0x(regs.get(rs1)) << ", " << hex0x(regs.get(rs2)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	pc = pc + val;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the blt instruction.
+* Simulates the execution of the minu instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
-**********************************************************************/
-void rv32i::exec_blt(uint32_t insn, std::ostream* pos)
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_minu(uint32_t insn, const T &trace)
 {
+	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
 	uint32_t rs2 = get_rs2(insn);
-	int32_t imm_b = get_imm_b(insn);
-	int32_t val = ((regs.get(rs1) < regs.get(rs2)) ? imm_b : 4);
+	sreg_t val = (reg_t)regs.get(rs1) < (reg_t)regs.get(rs2) ? regs.get(rs1) : regs.get(rs2);
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_btype(insn, "blt");
-		s.resize(instruction_width,' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// " << "pc += (" << hex0x32(regs.get(rs1)) << " < " << hex0x32(regs.get(rs2)) << " ? " <<
-		hex0x32(imm_b) << " : 4) = " << hex0x32(pc+val) << std::endl; 
+		line << "// " << "x" << rd << " = minu(" << hex0x(regs.get(rs1)) << ", " << hex0x(regs.get(rs2)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	pc = pc + val;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the bge instruction.
+* Simulates the execution of the max instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
-**********************************************************************/
-void rv32i::exec_bge(uint32_t insn, std::ostream* pos)
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_max(uint32_t insn, const T &trace)
 {
+	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
 	uint32_t rs2 = get_rs2(insn);
-	int32_t imm_b = get_imm_b(insn);
-	int32_t val = ((regs.get(rs1) >= regs.get(rs2)) ? imm_b : 4);
+	sreg_t val = regs.get(rs1) < regs.get(rs2) ? regs.get(rs2) : regs.get(rs1);
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_btype(insn, "bge");
-		s.resize(instruction_width,' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// " << "pc += (" << hex0x32(regs.get(rs1)) << " >= " << hex0x32(regs.get(rs2)) << " ? " <<
-		hex0x32(imm_b) << " : 4) = " << hex0x32(pc+val) << std::endl; 
+		line << "// " << "x" << rd << " = max(" << hex0x(regs.get(rs1)) << ", " << hex0x(regs.get(rs2)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	pc = pc + val;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the bltu instruction.
+* Simulates the execution of the maxu instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
-**********************************************************************/
-void rv32i::exec_bltu(uint32_t insn, std::ostream* pos)
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_maxu(uint32_t insn, const T &trace)
 {
-	uint32_t rs1 = regs.get(get_rs1(insn));
-	uint32_t rs2 = regs.get(get_rs2(insn));
-	int32_t imm_b = get_imm_b(insn);
-	int32_t val = ((rs1 < rs2) ? imm_b : 4);
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = (reg_t)regs.get(rs1) < (reg_t)regs.get(rs2) ? regs.get(rs2) : regs.get(rs1);
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_btype(insn, "bltu");
-		s.resize(instruction_width,' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// " << "pc += (" << hex0x32(rs1) << " <U " << hex0x32(rs2) << " ? " <<
-		hex0x32(imm_b) << " : 4) = " << hex0x32(pc+val) << std::endl; 
+		line << "// " << "x" << rd << " = maxu(" << hex0x(regs.get(rs1)) << ", " << hex0x(regs.get(rs2)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	pc = pc + val;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the bgeu instruction.
+* Simulates the execution of the rol instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
-**********************************************************************/
-void rv32i::exec_bgeu(uint32_t insn, std::ostream* pos)
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_rol(uint32_t insn, const T &trace)
 {
-	uint32_t rs1 = regs.get(get_rs1(insn));
-	uint32_t rs2 = regs.get(get_rs2(insn));
-	int32_t imm_b = get_imm_b(insn);
-	int32_t val = ((rs1 >= rs2) ? imm_b : 4);
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = calc_rol(regs.get(rs1), regs.get(rs2));
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_btype(insn, "bgeu");
-		s.resize(instruction_width,' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// " << "pc += (" << hex0x32(rs1) << " >=U " << std::dec << hex0x32(rs2) << " ? " <<
-		hex0x32(imm_b) << " : 4) = " << hex0x32(val+pc) << std::endl; 
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " rol " << (regs.get(rs2) & (XLEN - 1)) << " = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	pc = pc + val;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Simulates the execution of the beq instruction.
+* Simulates the execution of the ror instruction.
 *
 * @param insn is the instruction to be executed
 *
-* @param pos is the ostream object
-**********************************************************************/
-void rv32i::exec_beq(uint32_t insn, std::ostream* pos)
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_ror(uint32_t insn, const T &trace)
 {
+	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
 	uint32_t rs2 = get_rs2(insn);
-	int32_t imm_b = get_imm_b(insn);
-	int32_t val = ((regs.get(rs1) == regs.get(rs2)) ? imm_b : 4);
+	sreg_t val = calc_ror(regs.get(rs1), regs.get(rs2));
 
-	if (pos)
+	if (T::enabled)
 	{
-		std::string s = render_btype(insn, "beq");
-		s.resize(instruction_width,' ');
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-		*pos << s << "// " << "pc += (" << hex0x32(regs.get(rs1)) << " == " << hex0x32(regs.get(rs2)) << " ? " <<
-		hex0x32(imm_b) << " : 4) = " << hex0x32(pc+val) << std::endl; 
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " ror " << (regs.get(rs2) & (XLEN - 1)) << " = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
 	}
 
-	pc = pc + val;
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Extracts and returns the opcode from the given instruction.
+* Simulates the execution of the rori instruction.
 *
-* @param insn is the instruction.
+* @param insn is the instruction to be executed
 *
-* @return the opcode field of the instruction.
-**********************************************************************/
-uint32_t rv32i::get_opcode(uint32_t insn) {return (insn & 0x0000007f);}
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_rori(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	int32_t shamt = (insn >> 20) & (XLEN - 1);
+	sreg_t val = calc_ror(regs.get(rs1), shamt);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " ror " << shamt << " = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
 
 /**
-* Extracts and returns the rd field from the given instruction.
+* Simulates the execution of the clz instruction.
 *
-* @param insn is the instruction.
+* @param insn is the instruction to be executed
 *
-* @return the rd field of the instruction.
-**********************************************************************/
-uint32_t rv32i::get_rd(uint32_t insn) {return ((insn & 0x00000f80) >> 7);}
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_clz(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	sreg_t val = calc_clz(regs.get(rs1));
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = clz(" << hex0x(regs.get(rs1)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
 
 /**
-* Extracts and returns the funct3 field from the given instruction.
+* Simulates the execution of the ctz instruction.
 *
-* @param insn is the instruction.
+* @param insn is the instruction to be executed
 *
-* @return the funct3 field of the instruction.
-**********************************************************************/
-uint32_t rv32i::get_funct3(uint32_t insn) {return ((insn & 0x00007000) >> 12);}
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_ctz(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	sreg_t val = calc_ctz(regs.get(rs1));
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = ctz(" << hex0x(regs.get(rs1)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
 
 /**
-* Extracts and returns the rs1 field from the given instruction.
+* Simulates the execution of the cpop instruction.
 *
-* @param insn is the instruction.
+* @param insn is the instruction to be executed
 *
-* @return the rs1 field of the instruction.
-**********************************************************************/
-uint32_t rv32i::get_rs1(uint32_t insn) {return  ((insn & 0x000f8000) >> 15);}
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_cpop(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	sreg_t val = calc_cpop(regs.get(rs1));
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = cpop(" << hex0x(regs.get(rs1)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
 
 /**
-* Extracts and returns the rs2 field from the given instruction.
+* Simulates the execution of the sext.b instruction.
 *
-* @param insn is the instruction.
+* @param insn is the instruction to be executed
 *
-* @return the rs2 field of the instruction.
-**********************************************************************/
-uint32_t rv32i::get_rs2(uint32_t insn) {return ((insn & 0x01f00000) >> 20);}
-
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sext_b(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	sreg_t val = (int8_t)regs.get(rs1);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = sext.b(" << hex0x(regs.get(rs1)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
 /**
-* Extracts and returns the funct7 field from the given instruction.
+* Simulates the execution of the sext.h instruction.
 *
-* @param insn is the instruction.
+* @param insn is the instruction to be executed
 *
-* @return the funct7 field of the instruction.
-**********************************************************************/
-uint32_t rv32i::get_funct7(uint32_t insn) {return ((insn & 0xfe000000) >> 25);}
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sext_h(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	sreg_t val = (int16_t)regs.get(rs1);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = sext.h(" << hex0x(regs.get(rs1)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
 
 /**
-* Extracts and returns the imm_i field from the given instruction.
+* Simulates the execution of the zext.h instruction.
 *
-* @param insn is the instruction.
+* @param insn is the instruction to be executed
 *
-* @return the imm_i field of the instruction.
-**********************************************************************/
-int32_t  rv32i::get_imm_i(uint32_t insn) 
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_zext_h(uint32_t insn, const T &trace)
 {
-	int32_t imm_i = (insn & 0xfff00000) >> 20; // extract & shift bits
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	sreg_t val = regs.get(rs1) & 0xffff;
 
-	if (insn & 0x80000000)			   // sign-extend
-		imm_i |= 0xfffff000;
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-	return imm_i;
+		line << "// " << "x" << rd << " = zext.h(" << hex0x(regs.get(rs1)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Extracts and returns the imm_u field from the given instruction.
+* Simulates the execution of the orc.b instruction.
 *
-* @param insn is the instruction.
+* @param insn is the instruction to be executed
 *
-* @return the imm_u field of the instruction.
-**********************************************************************/
-int32_t  rv32i::get_imm_u(uint32_t insn) {return (insn & 0xfffff000);}
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_orc_b(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	sreg_t val = calc_orc_b(regs.get(rs1));
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = orc.b(" << hex0x(regs.get(rs1)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
 
 /**
-* Extracts and returns the imm_b field from the given instruction.
+* Simulates the execution of the rev8 instruction.
 *
-* @param insn is the instruction.
+* @param insn is the instruction to be executed
 *
-* @return the imm_b field of the instruction.
-**********************************************************************/
-int32_t  rv32i::get_imm_b(uint32_t insn) 
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_rev8(uint32_t insn, const T &trace)
 {
-	int32_t imm_b = (insn & 0x00000f00) >> (8-1); // extract & shift bits 8-11
-	imm_b |= (insn & 0x00000080) << (11 - 7);     // extract & shift bit 7
-	imm_b |= (insn & 0x7e000000) >> (25-5);	      // extract & shift bits 25-30
-	
-	if(insn & 0x80000000)
-		imm_b |= 0xfffff000;		      // sign-extend	
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	sreg_t val = calc_rev8(regs.get(rs1));
 
-	return imm_b;
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = rev8(" << hex0x(regs.get(rs1)) << ") = " <<
+		hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Extracts and returns the imm_s field from the given instruction.
+* Simulates the execution of the lwu instruction. RV64 only.
 *
-* @param insn is the instruction.
+* @param insn is the instruction to be executed
 *
-* @return the imm_s field of the instruction.
-**********************************************************************/
-int32_t rv32i::get_imm_s(uint32_t insn)
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_lwu(uint32_t insn, const T &trace)
 {
-	int32_t imm_s = (insn & 0xfe000000) >> (25-5); // extract & shift bits 5-11
-	imm_s |= (insn & 0x00000f80) >> (7-0);	       // extract & shift bits 0-4
+	uint32_t rd = get_rd(insn);
+	reg_t rs1 = regs.get(get_rs1(insn));
+	int32_t imm_i = get_imm_i(insn);
+	reg_t val = rs1 + imm_i;
+	reg_t from_address = mem->get32(val);
 
-	if (insn & 0x80000000)			       // sign-extend
-		imm_s |= 0xfffff000;
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-	return imm_s;
+		line << "// x" << rd << " = zx(m32(" << hex0x(rs1) << " + " <<
+		hex0x(imm_i) << ")) = " << hex0x(from_address) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, from_address);
+	pc += insn_len;
 }
 
 /**
-* Extracts and returns the imm_j field from the given instruction.
+* Simulates the execution of the ld instruction. RV64 only.
 *
-* @param insn is the instruction.
+* @param insn is the instruction to be executed
 *
-* @return the imm_j field of the instruction.
-**********************************************************************/
-int32_t  rv32i::get_imm_j(uint32_t insn)
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_ld(uint32_t insn, const T &trace)
 {
-	int32_t imm_j = (insn & 0x000ff000);	  // extract bits 12-19
-	imm_j |= (insn & 0x7fe00000) >> (21 - 1); // extract & shift bits 21-31
-	imm_j |= (insn & 0x00100000) >> (20 - 11);// extract & shift bit 20
+	uint32_t rd = get_rd(insn);
+	reg_t rs1 = regs.get(get_rs1(insn));
+	int32_t imm_i = get_imm_i(insn);
+	reg_t val = rs1 + imm_i;
+	reg_t from_address = mem->get64(val);
 
-	if (insn & 0x80000000)			  // sign-extend
-		imm_j |= 0xfff00000;
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-	return imm_j;
+		line << "// x" << rd << " = m64(" << hex0x(rs1) << " + " <<
+		hex0x(imm_i) << ") = " << hex0x(from_address) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, from_address);
+	pc += insn_len;
 }
 
 /**
-* Returns the error code of an unimplemented instruction.
+* Simulates the execution of the sd instruction. RV64 only.
 *
-* @return Error message.
-**********************************************************************/
-std::string rv32i::render_illegal_insn() const
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sd(uint32_t insn, const T &trace)
 {
-	return "ERROR: UNIMPLEMENTED INSTRUCTION";
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	int32_t imm_s = get_imm_s(insn);
+	reg_t address = regs.get(rs1) + imm_s;
+	reg_t value = regs.get(rs2);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// m64(" << hex0x(regs.get(rs1)) << " + " <<
+		hex0x(imm_s) << ") = " << hex0x(value) << '\n';
+		*trace.pos << line;
+	}
+
+	mem->set64(address, value);
+	invalidate_icache(address, 8);
+	pc += insn_len;
 }
 
 /**
-* Renders the lui instruction for output.
+* Simulates the execution of the addiw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
 *
-* @param insn is the instruction
+* @param insn is the instruction to be executed
 *
-* @return the rendered lui instruction as a string
+* @param trace is the tracing policy
 *********************************************************************/
-std::string rv32i::render_lui(uint32_t insn) const
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_addiw(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
-	int32_t imm_u = get_imm_u(insn);
+	uint32_t rs1 = get_rs1(insn);
+	int32_t imm_i = get_imm_i(insn);
+	sreg_t val = (int32_t)((reg_t)regs.get(rs1) + imm_i);
 
-	std::ostringstream os;
-	os << std::setw(mnemonic_width) << std::setfill(' ') << std::left 
-	<< "lui" << "x" << std::dec << rd << ",0x" << std::hex 
-	<< ((imm_u >> 12)&0x0fffff);
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " + " <<
+		hex0x(imm_i) << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
 
-	return os.str();
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Renders the auipc instruction for output.
+* Simulates the execution of the slliw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
 *
-* @param insn is the instruction
+* @param insn is the instruction to be executed
 *
-* @return the rendered auipc instruction as a string
+* @param trace is the tracing policy
 *********************************************************************/
-std::string rv32i::render_auipc(uint32_t insn) const
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_slliw(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
-	int32_t imm_u = get_imm_u(insn);
+	uint32_t rs1 = get_rs1(insn);
+	int32_t shamt = (insn >> 20) & 0x1f;
+	sreg_t val = (int32_t)((uint32_t)regs.get(rs1) << shamt);
 
-	std::ostringstream os;
-	os << std::setw(mnemonic_width) << std::setfill(' ') << std::left 
-	<< "auipc" << "x" << std::dec << rd << ",0x" << std::hex 
-	<< ((imm_u >> 12)&0x0fffff);
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " << " <<
+		shamt << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
 
-	return os.str();
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Renders the jal instruction for output.
+* Simulates the execution of the srliw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
 *
-* @param insn is the instruction
+* @param insn is the instruction to be executed
 *
-* @return the rendered jal instruction as a string
+* @param trace is the tracing policy
 *********************************************************************/
-std::string rv32i::render_jal(uint32_t insn) const
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_srliw(uint32_t insn, const T &trace)
 {
 	uint32_t rd = get_rd(insn);
-	int32_t imm_j = get_imm_j(insn);
-	uint32_t pcrel_21 = imm_j + pc;
+	uint32_t rs1 = get_rs1(insn);
+	int32_t shamt = (insn >> 20) & 0x1f;
+	sreg_t val = (int32_t)((uint32_t)regs.get(rs1) >> shamt);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-	std::ostringstream os;
-	os << std::setw(mnemonic_width) << std::setfill(' ') << std::left 
-	<< "jal" << "x" << std::dec << rd << ",0x" << std::hex 
-	<< pcrel_21;
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " >> " <<
+		shamt << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
 
-	return os.str();
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Renders the btype instructions for output.
+* Simulates the execution of the sraiw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
 *
-* @param insn is the instruction
+* @param insn is the instruction to be executed
 *
-* @return the rendered btype instruction as a string
+* @param trace is the tracing policy
 *********************************************************************/
-std::string rv32i::render_btype(uint32_t insn, const char *mnemonic) const
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sraiw(uint32_t insn, const T &trace)
 {
+	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
-	uint32_t rs2 = get_rs2(insn);
-	int32_t imm_b = get_imm_b(insn);
-	uint32_t pcrel_13 = imm_b + pc;
+	int32_t shamt = (insn >> 20) & 0x1f;
+	sreg_t val = (int32_t)regs.get(rs1) >> shamt;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-	std::ostringstream os;
-	os << std::setw(mnemonic_width) << std::setfill(' ') << std::left 
-	<< mnemonic << std::dec << "x" << rs1 << ",x" 
-	<< rs2 << ",0x" << std::hex << pcrel_13;	
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " >> " <<
+		shamt << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
 
-	return os.str();
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Renders the itype_load instructions for output.
+* Simulates the execution of the addw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
 *
-* @param insn is the instruction
+* @param insn is the instruction to be executed
 *
-* @return the rendered itype_load instruction as a string
+* @param trace is the tracing policy
 *********************************************************************/
-std::string rv32i::render_itype_load(uint32_t insn, const char *mnemonic) const
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_addw(uint32_t insn, const T &trace)
 {
-	uint32_t rd  = get_rd(insn);
+	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
-	int32_t imm_i = get_imm_i(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = (int32_t)((uint32_t)regs.get(rs1) + (uint32_t)regs.get(rs2));
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-	std::ostringstream os;
-	os << std::setw(mnemonic_width) << std::setfill(' ') << std::left 
-	<< mnemonic << "x" << std::dec << rd << "," << imm_i 
-	<< "(x" << rs1 << ")" ;
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " + " <<
+		hex0x(regs.get(rs2)) << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
 
-	return os.str();
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Renders the stype instructions for output.
+* Simulates the execution of the subw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
 *
-* @param insn is the instruction
+* @param insn is the instruction to be executed
 *
-* @return the rendered stype instruction as a string
+* @param trace is the tracing policy
 *********************************************************************/
-std::string rv32i::render_stype(uint32_t insn, const char *mnemonic) const
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_subw(uint32_t insn, const T &trace)
 {
+	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
 	uint32_t rs2 = get_rs2(insn);
-	int32_t imm_s = get_imm_s(insn);
-		
-	std::ostringstream os;
-	os << std::setw(mnemonic_width) << std::setfill(' ') << std::left 
-	<< mnemonic << "x" << std::dec << rs2 << "," << imm_s 
-	<< "(x" << rs1 << ")" ;
+	sreg_t val = (int32_t)((uint32_t)regs.get(rs1) - (uint32_t)regs.get(rs2));
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " - " <<
+		hex0x(regs.get(rs2)) << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
 
-	return os.str();
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Renders the itype_alu instructions for output.
+* Simulates the execution of the sllw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
 *
-* @param insn is the instruction
+* @param insn is the instruction to be executed
 *
-* @return the rendered itype_alu instruction as a string
+* @param trace is the tracing policy
 *********************************************************************/
-std::string rv32i::render_itype_alu(uint32_t insn, const char *mnemonic, int32_t imm_i) const
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sllw(uint32_t insn, const T &trace)
 {
-	uint32_t rd  = get_rd(insn);
+	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = (int32_t)((uint32_t)regs.get(rs1) << (regs.get(rs2) & 0x1f));
 
-	std::ostringstream os;
-	os << std::setw(mnemonic_width) << std::setfill(' ') << std::left 
-	<< mnemonic << "x" << std::dec << rd << ",x" << rs1 << "," << imm_i;
-	
-	return os.str();	
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " << " <<
+		(regs.get(rs2) & 0x1f) << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Renders the itype_shift instructions for output.
+* Simulates the execution of the srlw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
 *
-* @param insn is the instruction
+* @param insn is the instruction to be executed
 *
-* @return the rendered itype_shift instruction as a string
+* @param trace is the tracing policy
 *********************************************************************/
-std::string rv32i::render_itype_shift(uint32_t insn, const char *mnemonic) const
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_srlw(uint32_t insn, const T &trace)
 {
-	uint32_t rd  = get_rd(insn);
+	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = (int32_t)((uint32_t)regs.get(rs1) >> (regs.get(rs2) & 0x1f));
 
-	int32_t shamt = (insn & 0x01f00000) >> 20; // extract & shift bits
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-	std::ostringstream os;
-	os << std::setw(mnemonic_width) << std::setfill(' ') << std::left 
-	<< mnemonic << "x" << std::dec << rd << ",x" << rs1 << "," << shamt;
-	
-	return os.str();	
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " >> " <<
+		(regs.get(rs2) & 0x1f) << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Renders the rtype instructions for output.
+* Simulates the execution of the sraw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
 *
-* @param insn is the instruction
+* @param insn is the instruction to be executed
 *
-* @return the rendered rtype instruction as a string
+* @param trace is the tracing policy
 *********************************************************************/
-std::string rv32i::render_rtype(uint32_t insn, const char *mnemonic) const
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sraw(uint32_t insn, const T &trace)
 {
-	uint32_t rd  = get_rd(insn);
+	uint32_t rd = get_rd(insn);
 	uint32_t rs1 = get_rs1(insn);
 	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = (int32_t)regs.get(rs1) >> (regs.get(rs2) & 0x1f);
 
-	std::ostringstream os;
-	os << std::setw(mnemonic_width) << std::setfill(' ') << std::left 
-	<< mnemonic << "x" << std::dec << rd << ",x" << rs1 << ",x" << rs2;
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " >> " <<
+		(regs.get(rs2) & 0x1f) << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
 
-	return os.str();
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Renders the fence instruction for output.
+* Simulates the execution of the mulw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
 *
-* @param insn is the instruction
+* @param insn is the instruction to be executed
 *
-* @return the rendered fence instruction as a string
+* @param trace is the tracing policy
 *********************************************************************/
-std::string rv32i::render_fence(uint32_t insn) const
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_mulw(uint32_t insn, const T &trace)
 {
-	uint32_t pred  = (insn & 0x0f000000);
-	uint32_t succ = (insn & 0x00f00000);
-
-	std::string p;
-	std::string s;
-
-	if(pred == 0x8000000) p = "i";
-	else if(pred == 0x4000000) p = "o";
-	else if(pred == 0x3000000) p = "rw";
-	else if(pred == 0x2000000) p = "r";
-	else if(pred == 0x1000000) p = "w";
-	else if(pred == 0xf000000) p = "iorw";
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = (int32_t)((uint32_t)regs.get(rs1) * (uint32_t)regs.get(rs2));
 
-	if(succ == 0x800000) s = "i";
-	else if(succ == 0x400000) s = "o";
-	else if(succ == 0x300000) s = "rw";
-	else if(succ == 0x200000) s = "r";
-	else if(succ == 0x100000) s = "w";
-	else if(succ == 0xf00000) s = "iorw";
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
 
-	std::ostringstream os;
-	os << std::setw(mnemonic_width) << std::setfill(' ') << std::left 
-	<< "fence" << p << "," << s;
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " * " <<
+		hex0x(regs.get(rs2)) << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
 
-	return os.str();
+	regs.set(rd, val);
+	pc += insn_len;
 }
 
 /**
-* Renders the ecall instruction for output.
+* Simulates the execution of the divw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
 *
-* @param insn is the instruction
+* @param insn is the instruction to be executed
 *
-* @return the rendered ecall instruction as a string
+* @param trace is the tracing policy
 *********************************************************************/
-std::string rv32i::render_ecall_ebreak(uint32_t insn) const
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_divw(uint32_t insn, const T &trace)
 {
-	if((insn & 0x00100000) == 0x00100000) return "ebreak";
-		else return "ecall";
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = calc_divw(regs.get(rs1), regs.get(rs2));
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " / " <<
+		hex0x(regs.get(rs2)) << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
 }
+
+/**
+* Simulates the execution of the divuw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_divuw(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = calc_divuw(regs.get(rs1), regs.get(rs2));
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " / " <<
+		hex0x(regs.get(rs2)) << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the remw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_remw(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = calc_remw(regs.get(rs1), regs.get(rs2));
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " % " <<
+		hex0x(regs.get(rs2)) << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the remuw instruction. RV64 only, the result is
+* the low 32 bits, sign-extended.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_remuw(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = calc_remuw(regs.get(rs1), regs.get(rs2));
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = sx(" << hex0x(regs.get(rs1)) << " % " <<
+		hex0x(regs.get(rs2)) << ") = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the and instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_and(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = regs.get(rs1) & regs.get(rs2);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " & " <<
+		hex0x(regs.get(rs2)) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the or instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_or(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = regs.get(rs1) | regs.get(rs2);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " | " <<
+		hex0x(regs.get(rs2)) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the sra instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sra(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	sreg_t rs1 = regs.get(get_rs1(insn));
+	sreg_t rs2 = regs.get(get_rs2(insn)) & (XLEN - 1);
+	sreg_t val = rs1 >> rs2;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(rs1) << " >> " <<
+		rs2 << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the srl instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_srl(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	reg_t rs1 = regs.get(get_rs1(insn));
+	sreg_t rs2 = regs.get(get_rs2(insn)) & (XLEN - 1);
+	sreg_t val = rs1 >> rs2;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(rs1) << " >> " <<
+		rs2 << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/*
+* Simulates the execution of the xor instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_xor(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = regs.get(rs1) ^ regs.get(rs2);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " ^ " <<
+		hex0x(regs.get(rs2)) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/*
+* Simulates the execution of the sltu instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sltu(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	reg_t rs1 = regs.get(get_rs1(insn));
+	reg_t rs2 = regs.get(get_rs2(insn));
+	sreg_t val = (rs1 < rs2) ? 1 : 0;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = (" << hex0x(rs1) << " <U " <<
+		hex0x(rs2) << ") ? 1 : 0 = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/*
+* Simulates the execution of the slt instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_slt(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	sreg_t val = (regs.get(rs1) < regs.get(rs2)) ? 1 : 0;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = (" << hex0x(regs.get(rs1)) << " < " <<
+		hex0x(regs.get(rs2)) << ") ? 1 : 0 = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/*
+* Simulates the execution of the sll instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sll(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	uint32_t shift = (regs.get(rs2) & (XLEN - 1));
+	sreg_t val = regs.get(rs1) << shift;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// x" << rd << " = " << hex0x(regs.get(rs1)) << " << " << shift <<
+		" = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the sub instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sub(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+
+	sreg_t val = regs.get(rs1) - regs.get(rs2);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " - " <<
+		hex0x(regs.get(rs2)) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+/**
+* Simulates the execution of the add instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_add(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+
+	sreg_t val = regs.get(rs1) + regs.get(rs2);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " + " <<
+		hex0x(regs.get(rs2)) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the srai instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_srai(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	int32_t shamt = (insn >> 20) & (XLEN - 1);
+	sreg_t val = regs.get(rs1) >> shamt;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " >> " <<
+		shamt << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the srli instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_srli(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	reg_t rs1 = regs.get(get_rs1(insn));
+	int32_t shamt = (insn >> 20) & (XLEN - 1);
+	sreg_t val = rs1 >> shamt;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(rs1) << " >> " <<
+		shamt << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the slli instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_slli(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	int32_t shamt = (insn >> 20) & (XLEN - 1);
+	sreg_t val = regs.get(rs1) << shamt;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " << " <<
+		shamt << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the andi instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_andi(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	int32_t imm_i = get_imm_i(insn);
+	sreg_t val = regs.get(rs1) & imm_i;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " & " <<
+		hex0x(imm_i) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the ori instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_ori(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	int32_t imm_i = get_imm_i(insn);
+	sreg_t val = regs.get(rs1) | imm_i;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " | " <<
+		hex0x(imm_i) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the xori instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_xori(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	int32_t imm_i = get_imm_i(insn);
+	sreg_t val = regs.get(rs1) ^ imm_i;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " ^ " <<
+		hex0x(imm_i) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the sltiu instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sltiu(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	reg_t rs1 = regs.get(get_rs1(insn));
+	reg_t imm_i = (sreg_t)(int32_t)get_imm_i(insn);	// sign-extended, then compared unsigned
+	sreg_t val = (rs1 < imm_i) ? 1 : 0;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		// RV32 keeps the decimal immediate of the golden outputs
+		line << "// " << "x" << rd << " = (" << hex0x(rs1) << " <U ";
+		if (XLEN == 32)
+			line << (uint32_t)imm_i;
+		else
+			line << hex0x(imm_i);
+		line << ") ? 1 : 0 = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the slti instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_slti(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	int32_t imm_i = get_imm_i(insn);
+	sreg_t val = (regs.get(rs1) < imm_i) ? 1 : 0;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = (" << hex0x(regs.get(rs1)) << " < " <<
+		imm_i << ") ? 1 : 0 = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the sw instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sw(uint32_t insn, const T &trace)
+{
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	int32_t imm_s = get_imm_s(insn);
+	reg_t address = regs.get(rs1) + imm_s;
+	int32_t value = regs.get(rs2);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// m32(" << hex0x(regs.get(rs1)) << " + " <<
+		hex0x(imm_s) << ") = " << hex0x(value) << '\n';
+		*trace.pos << line;
+	}
+
+	mem->set32(address, value);
+	invalidate_icache(address, 4);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the sh instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sh(uint32_t insn, const T &trace)
+{
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	int32_t imm_s = get_imm_s(insn);
+	reg_t address = regs.get(rs1) + imm_s;
+	int32_t value = regs.get(rs2) & 0x0000ffff;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// m16(" << hex0x(regs.get(rs1)) << " + " <<
+		hex0x(imm_s) << ") = " << hex0x(value) << '\n';
+		*trace.pos << line;
+	}
+
+	mem->set16(address, value);
+	invalidate_icache(address, 2);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the sb instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_sb(uint32_t insn, const T &trace)
+{
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	int32_t imm_s = get_imm_s(insn);
+	reg_t address = regs.get(rs1) + imm_s;
+	int32_t value = regs.get(rs2) & 0x000000ff;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// m8(" << hex0x(regs.get(rs1)) << " + " <<
+		hex0x(imm_s) << ") = " << hex0x(value) << '\n';
+		*trace.pos << line;
+	}
+
+	mem->set8(address, value);
+	invalidate_icache(address, 1);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the lw instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_lw(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	reg_t rs1 = regs.get(get_rs1(insn));
+	int32_t imm_i = get_imm_i(insn);
+	reg_t val = rs1 + imm_i;
+	int32_t from_address = mem->get32(val);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// x" << rd << " = sx(m32(" << hex0x(rs1) << " + " <<
+		hex0x(imm_i) << ")) = " << hex0x(from_address) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, from_address);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the lh instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_lh(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	reg_t rs1 = regs.get(get_rs1(insn));
+	int32_t imm_i = get_imm_i(insn);
+	reg_t val = rs1 + imm_i;
+	int32_t from_address = mem->get16(val);
+
+	if (from_address & 0x00008000)      // sign extend
+		from_address |= 0xffff0000;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// x" << rd << " = sx(m16(" << hex0x(rs1) << " + " <<
+		hex0x(imm_i) << ")) = " << hex0x(from_address) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, from_address);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the lb instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_lb(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	reg_t rs1 = regs.get(get_rs1(insn));
+	int32_t imm_i = get_imm_i(insn);
+	reg_t val = rs1 + imm_i;
+	int32_t from_address = mem->get8(val);
+
+	if (from_address & 0x00000080)      // sign extend
+		from_address |= 0xffffff00;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// x" << rd << " = sx(m8(" << hex0x(rs1) << " + " <<
+		hex0x(imm_i) << ")) = " << hex0x(from_address) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, from_address);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the lhu instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_lhu(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	reg_t rs1 = regs.get(get_rs1(insn));
+	int32_t imm_i = get_imm_i(insn);
+	reg_t val = rs1 + imm_i;
+	int32_t from_address = mem->get16(val);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// x" << rd << " = zx(m16(" << hex0x(rs1) << " + " <<
+		hex0x(imm_i) << ")) = " << hex0x(from_address) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, from_address);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the lbu instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_lbu(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	reg_t rs1 = regs.get(get_rs1(insn));
+	int32_t imm_i = get_imm_i(insn);
+	reg_t val = rs1 + imm_i;
+	int32_t from_address = mem->get8(val);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// x" << rd << " = zx(m8(" << hex0x(rs1) << " + " <<
+		hex0x(imm_i) << ")) = " << hex0x(from_address) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, from_address);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the addi instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_addi(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	int32_t imm_i = get_imm_i(insn);
+	sreg_t val = regs.get(rs1) + imm_i;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(regs.get(rs1)) << " + " <<
+		hex0x(imm_i) << " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, val);
+	pc += insn_len;
+}
+
+/**
+* Sets the halt flag to terminate the loop, and if the ostream* param
+* is not nullptr, it calls render_illegal_insn() to render the proper
+* error message.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+**********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_illegal_insn(uint32_t insn, const T &trace)
+{
+	(void)insn;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_illegal_insn(line);
+		line.resize(instruction_width, ' ');
+		line << '\n';
+		*trace.pos << line;
+	}
+	stop(halt_illegal);
+}
+
+/**
+* Simulates the execution of the ebreak instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_ebreak(uint32_t insn, const T &trace)
+{
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+		line << "// HALT" << '\n';
+		*trace.pos << line;
+	}
+	stop(halt_ebreak);
+}
+
+/**
+* Simulates the execution of the ecall instruction: runs the system
+* call in a7 (see system_call()), or halts like ebreak when there is no
+* emulation. The line is rendered after the call, once its result is
+* known, so it follows whatever the call printed.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_ecall(uint32_t insn, const T &trace)
+{
+	uint32_t number = regs.get(17);
+	reg_t a0 = regs.get(10);
+	bool emulated = sys || replay_syscall;
+	bool more = system_call();
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		if(!emulated)
+			line << "// HALT" << '\n';
+		else if(!more)
+			line << "// " << syscalls::name(number) << "(" << hex0x(a0) << ") HALT" << '\n';
+		else
+			line << "// x10 = " << syscalls::name(number) << "() = " << hex0x(regs.get(10)) << '\n';
+		*trace.pos << line;
+	}
+
+	if(more)
+		pc += insn_len;
+}
+
+/**
+* Runs the system call of an ecall: the number in a7 and the arguments
+* in a0-a5, the result into a0. Every engine goes through here. Before
+* the call, whatever was traced or printed so far is written out, so
+* that the output of the program comes in order with it. Code that the
+* call overwrote is forgotten. In replay() the result comes from the
+* trace instead.
+*
+* @return false if the hart halted: the call was exit, or ecall is not
+* emulated.
+*********************************************************************/
+template<uint32_t XLEN>
+bool rv_hart<XLEN>::system_call()
+{
+	uint32_t number = regs.get(17);
+	uint64_t args[6];
+	for(uint32_t i = 0; i < 6; ++i)
+		args[i] = (reg_t)regs.get(10 + i);
+
+	int64_t ret;
+	if(replay_syscall)
+	{
+		ret = replay_result;
+	}
+	else if(sys)
+	{
+		if(tracer)
+			tracer->sync(insn_counter);
+		std::cout.flush();
+
+		uint64_t written_addr, written_len;
+		ret = sys->call(number, args, written_addr, written_len);
+		if(written_len)
+			invalidate_icache(written_addr, written_len);
+	}
+	else
+	{
+		stop(halt_ebreak);
+		return false;
+	}
+
+	if(syscalls::is_exit(number))
+	{
+		exit_status = args[0] & 0xff;
+		stop(halt_exit);
+		return false;
+	}
+
+	regs.set(10, ret);
+	return true;
+}
+
+/**
+* Simulates the execution of the lui instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_lui(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	int32_t imm_u = get_imm_u(insn);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(imm_u) << '\n';
+		*trace.pos << line;
+	}
+	
+	regs.set(rd, imm_u);
+	pc += insn_len;
+}
+	
+/**
+* Simulates the execution of the auipc instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_auipc(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	int32_t imm_u = get_imm_u(insn);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(pc) << " + "
+		<< hex0x(imm_u) << " = " << hex0x(imm_u+pc) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, imm_u+pc);
+	pc += insn_len;
+}
+
+/**
+* Simulates the execution of the jal instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_jal(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	int32_t imm_j = get_imm_j(insn);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(pc+insn_len) << ", "
+		<< " pc = " << hex0x(pc) << " + " << hex0x(imm_j) << " = " << hex0x(pc+imm_j) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, pc+insn_len);
+	note_edge(pc, pc + imm_j);
+	pc = pc + imm_j;
+}
+
+/**
+* Simulates the execution of the jalr instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+*********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_jalr(uint32_t insn, const T &trace)
+{
+	uint32_t rd = get_rd(insn);
+	int32_t imm_i = get_imm_i(insn);
+	uint32_t rs1 = get_rs1(insn);
+	reg_t val = (regs.get(rs1) + imm_i) & ~(reg_t)1;
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "x" << rd << " = " << hex0x(pc+insn_len) << ", "
+		<< " pc = (" << hex0x(imm_i) << " + " << hex0x(regs.get(rs1)) << ") & " << hex0x(~(reg_t)1) 
+		<< " = " << hex0x(val) << '\n';
+		*trace.pos << line;
+	}
+
+	regs.set(rd, pc+insn_len);
+	note_edge(pc, val);
+	pc = val;
+}
+
+/**
+* Simulates the execution of the bne instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+**********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_bne(uint32_t insn, const T &trace)
+{
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	int32_t imm_b = get_imm_b(insn);
+	bool taken = (regs.get(rs1) != regs.get(rs2));
+	int32_t val = (taken ? imm_b : insn_len);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "pc += (" << hex0x(regs.get(rs1)) << " != " << hex0x(regs.get(rs2)) << " ? " <<
+		hex0x(imm_b) << " : " << insn_len << ") = " << hex0x(pc+val) << '\n';
+		*trace.pos << line; 
+	}
+
+	branch(taken, imm_b, insn_len);
+}
+
+/**
+* Simulates the execution of the blt instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+**********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_blt(uint32_t insn, const T &trace)
+{
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	int32_t imm_b = get_imm_b(insn);
+	bool taken = (regs.get(rs1) < regs.get(rs2));
+	int32_t val = (taken ? imm_b : insn_len);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "pc += (" << hex0x(regs.get(rs1)) << " < " << hex0x(regs.get(rs2)) << " ? " <<
+		hex0x(imm_b) << " : " << insn_len << ") = " << hex0x(pc+val) << '\n';
+		*trace.pos << line; 
+	}
+
+	branch(taken, imm_b, insn_len);
+}
+
+/**
+* Simulates the execution of the bge instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+**********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_bge(uint32_t insn, const T &trace)
+{
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	int32_t imm_b = get_imm_b(insn);
+	bool taken = (regs.get(rs1) >= regs.get(rs2));
+	int32_t val = (taken ? imm_b : insn_len);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "pc += (" << hex0x(regs.get(rs1)) << " >= " << hex0x(regs.get(rs2)) << " ? " <<
+		hex0x(imm_b) << " : " << insn_len << ") = " << hex0x(pc+val) << '\n';
+		*trace.pos << line; 
+	}
+
+	branch(taken, imm_b, insn_len);
+}
+
+/**
+* Simulates the execution of the bltu instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+**********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_bltu(uint32_t insn, const T &trace)
+{
+	reg_t rs1 = regs.get(get_rs1(insn));
+	reg_t rs2 = regs.get(get_rs2(insn));
+	int32_t imm_b = get_imm_b(insn);
+	bool taken = (rs1 < rs2);
+	int32_t val = (taken ? imm_b : insn_len);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "pc += (" << hex0x(rs1) << " <U " << hex0x(rs2) << " ? " <<
+		hex0x(imm_b) << " : " << insn_len << ") = " << hex0x(pc+val) << '\n';
+		*trace.pos << line; 
+	}
+
+	branch(taken, imm_b, insn_len);
+}
+
+/**
+* Simulates the execution of the bgeu instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+**********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_bgeu(uint32_t insn, const T &trace)
+{
+	reg_t rs1 = regs.get(get_rs1(insn));
+	reg_t rs2 = regs.get(get_rs2(insn));
+	int32_t imm_b = get_imm_b(insn);
+	bool taken = (rs1 >= rs2);
+	int32_t val = (taken ? imm_b : insn_len);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "pc += (" << hex0x(rs1) << " >=U " << hex0x(rs2) << " ? " <<
+		hex0x(imm_b) << " : " << insn_len << ") = " << hex0x(val+pc) << '\n';
+		*trace.pos << line; 
+	}
+
+	branch(taken, imm_b, insn_len);
+}
+
+/**
+* Simulates the execution of the beq instruction.
+*
+* @param insn is the instruction to be executed
+*
+* @param trace is the tracing policy
+**********************************************************************/
+template<uint32_t XLEN>
+template<typename T>
+void rv_hart<XLEN>::exec_beq(uint32_t insn, const T &trace)
+{
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	int32_t imm_b = get_imm_b(insn);
+	bool taken = (regs.get(rs1) == regs.get(rs2));
+	int32_t val = (taken ? imm_b : insn_len);
+
+	if (T::enabled)
+	{
+		text_line line;
+		render_insn(line, insn);
+		line.resize(instruction_width, ' ');
+
+		line << "// " << "pc += (" << hex0x(regs.get(rs1)) << " == " << hex0x(regs.get(rs2)) << " ? " <<
+		hex0x(imm_b) << " : " << insn_len << ") = " << hex0x(pc+val) << '\n';
+		*trace.pos << line; 
+	}
+
+	branch(taken, imm_b, insn_len);
+}
+
+/**
+* Extracts and returns the opcode from the given instruction.
+*
+* @param insn is the instruction.
+*
+* @return the opcode field of the instruction.
+**********************************************************************/
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::get_opcode(uint32_t insn) {return (insn & 0x0000007f);}
+
+/**
+* Extracts and returns the rd field from the given instruction.
+*
+* @param insn is the instruction.
+*
+* @return the rd field of the instruction.
+**********************************************************************/
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::get_rd(uint32_t insn) {return ((insn & 0x00000f80) >> 7);}
+
+/**
+* Extracts and returns the funct3 field from the given instruction.
+*
+* @param insn is the instruction.
+*
+* @return the funct3 field of the instruction.
+**********************************************************************/
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::get_funct3(uint32_t insn) {return ((insn & 0x00007000) >> 12);}
+
+/**
+* Extracts and returns the rs1 field from the given instruction.
+*
+* @param insn is the instruction.
+*
+* @return the rs1 field of the instruction.
+**********************************************************************/
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::get_rs1(uint32_t insn) {return  ((insn & 0x000f8000) >> 15);}
+
+/**
+* Extracts and returns the rs2 field from the given instruction.
+*
+* @param insn is the instruction.
+*
+* @return the rs2 field of the instruction.
+**********************************************************************/
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::get_rs2(uint32_t insn) {return ((insn & 0x01f00000) >> 20);}
+
+/**
+* Extracts and returns the funct7 field from the given instruction.
+*
+* @param insn is the instruction.
+*
+* @return the funct7 field of the instruction.
+**********************************************************************/
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::get_funct7(uint32_t insn) {return ((insn & 0xfe000000) >> 25);}
+
+/**
+* Extracts and returns the imm_i field from the given instruction.
+*
+* @param insn is the instruction.
+*
+* @return the imm_i field of the instruction.
+**********************************************************************/
+template<uint32_t XLEN>
+int32_t  rv_hart<XLEN>::get_imm_i(uint32_t insn) 
+{
+	int32_t imm_i = (insn & 0xfff00000) >> 20; // extract & shift bits
+
+	if (insn & 0x80000000)			   // sign-extend
+		imm_i |= 0xfffff000;
+
+	return imm_i;
+}
+
+/**
+* Extracts and returns the imm_u field from the given instruction.
+*
+* @param insn is the instruction.
+*
+* @return the imm_u field of the instruction.
+**********************************************************************/
+template<uint32_t XLEN>
+int32_t  rv_hart<XLEN>::get_imm_u(uint32_t insn) {return (insn & 0xfffff000);}
+
+/**
+* Extracts and returns the imm_b field from the given instruction.
+*
+* @param insn is the instruction.
+*
+* @return the imm_b field of the instruction.
+**********************************************************************/
+template<uint32_t XLEN>
+int32_t  rv_hart<XLEN>::get_imm_b(uint32_t insn) 
+{
+	int32_t imm_b = (insn & 0x00000f00) >> (8-1); // extract & shift bits 8-11
+	imm_b |= (insn & 0x00000080) << (11 - 7);     // extract & shift bit 7
+	imm_b |= (insn & 0x7e000000) >> (25-5);	      // extract & shift bits 25-30
+	
+	if(insn & 0x80000000)
+		imm_b |= 0xfffff000;		      // sign-extend	
+
+	return imm_b;
+}
+
+/**
+* Extracts and returns the imm_s field from the given instruction.
+*
+* @param insn is the instruction.
+*
+* @return the imm_s field of the instruction.
+**********************************************************************/
+template<uint32_t XLEN>
+int32_t rv_hart<XLEN>::get_imm_s(uint32_t insn)
+{
+	int32_t imm_s = (insn & 0xfe000000) >> (25-5); // extract & shift bits 5-11
+	imm_s |= (insn & 0x00000f80) >> (7-0);	       // extract & shift bits 0-4
+
+	if (insn & 0x80000000)			       // sign-extend
+		imm_s |= 0xfffff000;
+
+	return imm_s;
+}
+
+/**
+* Extracts and returns the imm_j field from the given instruction.
+*
+* @param insn is the instruction.
+*
+* @return the imm_j field of the instruction.
+**********************************************************************/
+template<uint32_t XLEN>
+int32_t  rv_hart<XLEN>::get_imm_j(uint32_t insn)
+{
+	int32_t imm_j = (insn & 0x000ff000);	  // extract bits 12-19
+	imm_j |= (insn & 0x7fe00000) >> (21 - 1); // extract & shift bits 21-31
+	imm_j |= (insn & 0x00100000) >> (20 - 11);// extract & shift bit 20
+
+	if (insn & 0x80000000)			  // sign-extend
+		imm_j |= 0xfff00000;
+
+	return imm_j;
+}
+
+/**
+* Renders the instruction at pc the way it is in memory, followed by
+* two spaces: the 32-bit word or, for a compressed instruction (after
+* fetch() set insn_len to 2), the halfword right-aligned under it.
+*
+* @param line is the line to render into
+* @param insn is the instruction as returned by fetch()
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_parcel(text_line &line, uint32_t insn) const
+{
+	if(insn_len == 2)
+	{
+		uint32_t half = mem->get16(pc);
+		line << "    ";
+		line.hex8(half >> 8).hex8(half);
+	}
+	else
+	{
+		line.hex32(insn);
+	}
+	line << "  ";
+}
+
+/**
+* Renders insn (at pc) like decode(line, insn) does, out of the render
+* cache. The traced runs and the disassembly render the same few words
+* over and over, so decode() only runs the first time a word is seen,
+* or for jal and the branches, whose text holds the target address,
+* the first time it is seen at a pc.
+*
+* @param line is the line to render into
+* @param insn is the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_insn(text_line &line, uint32_t insn) const
+{
+	uint32_t opcode = get_opcode(insn);
+	bool pcrel = opcode == opcode_jal || opcode == opcode_btype;
+	uint32_t key = pcrel ? insn ^ (pc * 0x9e3779b1u) : insn;
+	rendered_insn &r = render_cache[(key * 2654435761u) >> (32 - render_cache_bits)];
+
+	if(r.len == 0 || r.insn != insn || (pcrel && r.pc != pc))
+	{
+		text_line text;
+		decode(text, insn);
+		if(text.size() > sizeof(r.text))
+		{
+			line.append(text.data(), text.size());
+			return;
+		}
+		r.insn = insn;
+		r.pc = pc;
+		r.len = text.size();
+		memcpy(r.text, text.data(), text.size());
+	}
+	line.append_prefix(r.text, r.len);
+}
+
+/**
+* Appends the mnemonic, padded with spaces to mnemonic_width.
+*
+* @param line is the line to render into
+* @param mnemonic is the name of the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_mnemonic(text_line &line, const char *mnemonic)
+{
+	size_t start = line.size();
+	line << mnemonic;
+	line.pad(start + mnemonic_width);
+}
+
+/**
+* Renders the error code of an unimplemented instruction.
+*
+* @param line is the line to render into
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_illegal_insn(text_line &line) const
+{
+	line << "ERROR: UNIMPLEMENTED INSTRUCTION";
+}
+
+/**
+* Renders the lui and auipc instructions for output.
+*
+* @param line is the line to render into
+* @param insn is the instruction
+* @param mnemonic is the name of the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_utype(text_line &line, uint32_t insn, const char *mnemonic) const
+{
+	uint32_t rd = get_rd(insn);
+	int32_t imm_u = get_imm_u(insn);
+
+	render_mnemonic(line, mnemonic);
+	line << "x" << rd << ",0x";
+	line.hex((imm_u >> 12)&0x0fffff);
+}
+
+/**
+* Renders the jal instruction for output.
+*
+* @param line is the line to render into
+* @param insn is the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_jal(text_line &line, uint32_t insn) const
+{
+	uint32_t rd = get_rd(insn);
+	int32_t imm_j = get_imm_j(insn);
+	reg_t pcrel_21 = imm_j + pc;
+
+	render_mnemonic(line, "jal");
+	line << "x" << rd << ",0x";
+	line.hex(pcrel_21);
+}
+
+/**
+* Renders the btype instructions for output.
+*
+* @param line is the line to render into
+* @param insn is the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_btype(text_line &line, uint32_t insn, const char *mnemonic) const
+{
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	int32_t imm_b = get_imm_b(insn);
+	reg_t pcrel_13 = imm_b + pc;
+
+	render_mnemonic(line, mnemonic);
+	line << "x" << rs1 << ",x" << rs2 << ",0x";
+	line.hex(pcrel_13);
+}
+
+/**
+* Renders the itype_load instructions for output.
+*
+* @param line is the line to render into
+* @param insn is the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_itype_load(text_line &line, uint32_t insn, const char *mnemonic) const
+{
+	uint32_t rd  = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	int32_t imm_i = get_imm_i(insn);
+
+	render_mnemonic(line, mnemonic);
+	line << "x" << rd << "," << imm_i << "(x" << rs1 << ")";
+}
+
+/**
+* Renders the stype instructions for output.
+*
+* @param line is the line to render into
+* @param insn is the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_stype(text_line &line, uint32_t insn, const char *mnemonic) const
+{
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+	int32_t imm_s = get_imm_s(insn);
+
+	render_mnemonic(line, mnemonic);
+	line << "x" << rs2 << "," << imm_s << "(x" << rs1 << ")";
+}
+
+/**
+* Renders the itype_alu instructions for output.
+*
+* @param line is the line to render into
+* @param insn is the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_itype_alu(text_line &line, uint32_t insn, const char *mnemonic, int32_t imm_i) const
+{
+	uint32_t rd  = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+
+	render_mnemonic(line, mnemonic);
+	line << "x" << rd << ",x" << rs1 << "," << imm_i;
+}
+
+/**
+* Renders the itype_shift instructions for output.
+*
+* @param line is the line to render into
+* @param insn is the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_itype_shift(text_line &line, uint32_t insn, const char *mnemonic) const
+{
+	uint32_t rd  = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+
+	int32_t shamt = (insn >> 20) & (XLEN - 1); // extract & shift bits
+
+	render_mnemonic(line, mnemonic);
+	line << "x" << rd << ",x" << rs1 << "," << shamt;
+}
+
+/**
+* Renders the rtype instructions for output.
+*
+* @param line is the line to render into
+* @param insn is the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_rtype(text_line &line, uint32_t insn, const char *mnemonic) const
+{
+	uint32_t rd  = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+	uint32_t rs2 = get_rs2(insn);
+
+	render_mnemonic(line, mnemonic);
+	line << "x" << rd << ",x" << rs1 << ",x" << rs2;
+}
+
+/**
+* Renders the unary instructions (rd, rs1) for output.
+*
+* @param line is the line to render into
+* @param insn is the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_unary(text_line &line, uint32_t insn, const char *mnemonic) const
+{
+	uint32_t rd  = get_rd(insn);
+	uint32_t rs1 = get_rs1(insn);
+
+	render_mnemonic(line, mnemonic);
+	line << "x" << rd << ",x" << rs1;
+}
+
+/**
+* Renders the fence instruction for output.
+*
+* @param line is the line to render into
+* @param insn is the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_fence(text_line &line, uint32_t insn) const
+{
+	uint32_t pred  = (insn & 0x0f000000);
+	uint32_t succ = (insn & 0x00f00000);
+
+	const char *p = "";
+	const char *s = "";
+
+	if(pred == 0x8000000) p = "i";
+	else if(pred == 0x4000000) p = "o";
+	else if(pred == 0x3000000) p = "rw";
+	else if(pred == 0x2000000) p = "r";
+	else if(pred == 0x1000000) p = "w";
+	else if(pred == 0xf000000) p = "iorw";
+
+	if(succ == 0x800000) s = "i";
+	else if(succ == 0x400000) s = "o";
+	else if(succ == 0x300000) s = "rw";
+	else if(succ == 0x200000) s = "r";
+	else if(succ == 0x100000) s = "w";
+	else if(succ == 0xf00000) s = "iorw";
+
+	render_mnemonic(line, "fence");
+	line << p << "," << s;
+}
+
+/**
+* Renders the ecall instruction for output.
+*
+* @param line is the line to render into
+* @param insn is the instruction
+*********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::render_ecall_ebreak(text_line &line, uint32_t insn) const
+{
+	if((insn & 0x00100000) == 0x00100000) line << "ebreak";
+		else line << "ecall";
+}
+
+/*
+* Encoders of the 32-bit formats, for expand_compressed(). The
+* immediates are scattered into the fields the get_imm_x() methods
+* gather them from.
+*/
+static uint32_t encode_r(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3,
+	uint32_t rd, uint32_t opcode)
+{
+	return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+static uint32_t encode_i(int32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode)
+{
+	return ((uint32_t)imm << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+static uint32_t encode_s(int32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode)
+{
+	return (((uint32_t)imm >> 5) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12)
+		| ((imm & 0x1f) << 7) | opcode;
+}
+
+static uint32_t encode_b(int32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode)
+{
+	uint32_t u = imm;
+	return ((u >> 12 & 1) << 31) | ((u >> 5 & 0x3f) << 25) | (rs2 << 20) | (rs1 << 15)
+		| (funct3 << 12) | ((u >> 1 & 0xf) << 8) | ((u >> 11 & 1) << 7) | opcode;
+}
+
+static uint32_t encode_j(int32_t imm, uint32_t rd, uint32_t opcode)
+{
+	uint32_t u = imm;
+	return ((u >> 20 & 1) << 31) | ((u >> 1 & 0x3ff) << 21) | ((u >> 11 & 1) << 20)
+		| ((u >> 12 & 0xff) << 12) | (rd << 7) | opcode;
+}
+
+/**
+* Expands a compressed instruction of the C extension into the 32-bit
+* instruction it stands for, so that it is decoded, executed and
+* rendered like that one (only its length differs.) The encodings of
+* the F and D extensions and the reserved ones are illegal. With XLEN
+* 64 the RV64C forms take the place of c.jal (c.addiw) and of c.flw,
+* c.fsw, c.flwsp and c.fswsp (c.ld, c.sd, c.ldsp and c.sdsp), and the
+* shifts take shamt[5].
+*
+* @param insn is the 16-bit instruction, its two low bits not 11
+*
+* @return the 32-bit instruction, or 0 (an illegal instruction)
+**********************************************************************/
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::expand_compressed(uint32_t insn)
+{
+	uint32_t funct3 = (insn >> 13) & 7;
+	uint32_t rd = (insn >> 7) & 0x1f;		// also rs1
+	uint32_t rs2 = (insn >> 2) & 0x1f;
+	uint32_t rd_p = ((insn >> 2) & 7) + 8;		// rd' and rs2'
+	uint32_t rs1_p = ((insn >> 7) & 7) + 8;		// rs1' and rd'
+
+	// the 6-bit immediate of c.addi, c.li, c.andi and the shifts
+	int32_t imm6 = ((insn >> 2) & 0x1f) | ((insn >> 12 & 1) ? ~0x1f : 0);
+	// the offset of c.lw and c.sw, and of c.ld and c.sd
+	int32_t lw_off = ((insn >> 7) & 0x38) | ((insn >> 4) & 4) | ((insn << 1) & 0x40);
+	int32_t ld_off = ((insn >> 7) & 0x38) | ((insn << 1) & 0xc0);
+	// shamt[5] of the shifts, in the low bit of funct7
+	uint32_t shamt5 = XLEN == 64 ? (insn >> 12) & 1 : 0;
+	// the offset of c.j and c.jal
+	int32_t j_off = ((insn >> 1) & 0x800) | ((insn >> 7) & 0x10) | ((insn >> 1) & 0x300)
+		| ((insn << 2) & 0x400) | ((insn >> 1) & 0x40) | ((insn << 1) & 0x80)
+		| ((insn >> 2) & 0xe) | ((insn << 3) & 0x20);
+	if(j_off & 0x800)
+		j_off |= ~0x7ff;
+	// the offset of c.beqz and c.bnez
+	int32_t b_off = ((insn >> 4) & 0x100) | ((insn >> 7) & 0x18) | ((insn << 1) & 0xc0)
+		| ((insn >> 2) & 6) | ((insn << 3) & 0x20);
+	if(b_off & 0x100)
+		b_off |= ~0xff;
+
+	switch(((insn & 3) << 3) | funct3)	// the quadrant and funct3, in octal
+	{
+	default:
+		return 0;
+
+	case 000:	// c.addi4spn
+		{
+			int32_t imm = ((insn >> 7) & 0x30) | ((insn >> 1) & 0x3c0)
+				| ((insn >> 4) & 4) | ((insn >> 2) & 8);
+			if(imm == 0)
+				return 0;
+			return encode_i(imm, 2, funct3_addi, rd_p, opcode_itype);
+		}
+	case 002:	// c.lw
+		return encode_i(lw_off, rs1_p, funct3_lw, rd_p, opcode_load_imm);
+	case 003:	// c.ld
+		if(XLEN == 32)
+			return 0;
+		return encode_i(ld_off, rs1_p, funct3_ld, rd_p, opcode_load_imm);
+	case 006:	// c.sw
+		return encode_s(lw_off, rd_p, rs1_p, funct3_sw, opcode_stype);
+	case 007:	// c.sd
+		if(XLEN == 32)
+			return 0;
+		return encode_s(ld_off, rd_p, rs1_p, funct3_sd, opcode_stype);
+
+	case 010:	// c.addi (c.nop)
+		return encode_i(imm6, rd, funct3_addi, rd, opcode_itype);
+	case 011:
+		if(XLEN == 32)	// c.jal
+			return encode_j(j_off, 1, opcode_jal);
+		if(rd == 0)	// c.addiw
+			return 0;
+		return encode_i(imm6, rd, funct3_addi, rd, opcode_itype32);
+	case 012:	// c.li
+		return encode_i(imm6, 0, funct3_addi, rd, opcode_itype);
+	case 013:
+		if(rd == 2)	// c.addi16sp
+		{
+			int32_t imm = ((insn >> 3) & 0x200) | ((insn >> 2) & 0x10) | ((insn << 1) & 0x40)
+				| ((insn << 4) & 0x180) | ((insn << 3) & 0x20);
+			if(imm == 0)
+				return 0;
+			if(imm & 0x200)
+				imm |= ~0x1ff;
+			return encode_i(imm, 2, funct3_addi, 2, opcode_itype);
+		}
+		if(imm6 == 0)	// c.lui
+			return 0;
+		return ((uint32_t)imm6 << 12) | (rd << 7) | opcode_lui;
+	case 014:
+		switch((insn >> 10) & 3)
+		{
+		case 0:		// c.srli
+		case 1:		// c.srai
+			if(XLEN == 32 && (insn & 0x1000))
+				return 0;	// shamt[5] is for RV64
+			return encode_r(((insn & 0x400) ? funct7_sub : funct7_add) | shamt5, rs2, rs1_p,
+				funct3_srli, rs1_p, opcode_itype);
+		case 2:		// c.andi
+			return encode_i(imm6, rs1_p, funct3_andi, rs1_p, opcode_itype);
+		default:	// c.sub, c.xor, c.or, c.and
+			{
+				static const uint32_t funct3s[4] = { funct3_add, funct3_xor, funct3_or, funct3_and };
+				uint32_t op = (insn >> 5) & 3;
+				if(insn & 0x1000)
+				{
+					if(XLEN == 32 || op > 1)
+						return 0;	// c.subw and c.addw are for RV64
+					return encode_r(op == 0 ? funct7_sub : funct7_add, rd_p, rs1_p,
+						funct3_add, rs1_p, opcode_rtype32);
+				}
+				return encode_r(op == 0 ? funct7_sub : funct7_add, rd_p, rs1_p,
+					funct3s[op], rs1_p, opcode_rtype);
+			}
+		}
+	case 015:	// c.j
+		return encode_j(j_off, 0, opcode_jal);
+	case 016:	// c.beqz
+		return encode_b(b_off, 0, rs1_p, funct3_beq, opcode_btype);
+	case 017:	// c.bnez
+		return encode_b(b_off, 0, rs1_p, funct3_bne, opcode_btype);
+
+	case 020:	// c.slli
+		if(XLEN == 32 && (insn & 0x1000))
+			return 0;
+		return encode_r(funct7_add | shamt5, rs2, rd, funct3_slli, rd, opcode_itype);
+	case 022:	// c.lwsp
+		if(rd == 0)
+			return 0;
+		return encode_i(((insn >> 7) & 0x20) | ((insn >> 2) & 0x1c) | ((insn << 4) & 0xc0),
+			2, funct3_lw, rd, opcode_load_imm);
+	case 023:	// c.ldsp
+		if(XLEN == 32 || rd == 0)
+			return 0;
+		return encode_i(((insn >> 7) & 0x20) | ((insn >> 2) & 0x18) | ((insn << 4) & 0x1c0),
+			2, funct3_ld, rd, opcode_load_imm);
+	case 024:
+		if(!(insn & 0x1000))
+		{
+			if(rs2 == 0)	// c.jr
+				return rd == 0 ? 0 : encode_i(0, rd, 0, 0, opcode_jalr);
+			return encode_r(funct7_add, rs2, 0, funct3_add, rd, opcode_rtype);	// c.mv
+		}
+		if(rs2 == 0)
+		{
+			if(rd == 0)	// c.ebreak
+				return encode_i(1, 0, 0, 0, opcode_ecall_ebreak);
+			return encode_i(0, rd, 0, 1, opcode_jalr);	// c.jalr
+		}
+		return encode_r(funct7_add, rs2, rd, funct3_add, rd, opcode_rtype);	// c.add
+	case 026:	// c.swsp
+		return encode_s(((insn >> 7) & 0x3c) | ((insn >> 1) & 0xc0), rs2, 2, funct3_sw, opcode_stype);
+	case 027:	// c.sdsp
+		if(XLEN == 32)
+			return 0;
+		return encode_s(((insn >> 7) & 0x38) | ((insn >> 1) & 0x1c0), rs2, 2, funct3_sd, opcode_stype);
+	}
+}
+
+/**
+* Tells the kind of the instructions with the given opcode, funct3,
+* funct7 and rs2. This is the only place that knows the encodings of
+* the 32-bit instructions, it is only run at compile time to fill
+* decode_table. rs2 matters for the unary group of clz, ecall and
+* ebreak, and zext.h, orc.b and rev8, which are only themselves with
+* one rs2 (the others are instructions of Zbkb, like pack and brev8,
+* or none at all.) For these, rs2_any gives the kind decode_kind()
+* looks up again by rs2. The
+* RV64 instructions are illegal with XLEN 32, and with XLEN 64 the low
+* bit of funct7 is shamt[5] for the immediate shifts. The .w and .uw
+* forms of Zba/Zbb in RV64 are not implemented.
+*
+* @param opcode is the 7-bit opcode
+* @param funct3 is the funct3 field
+* @param funct7 is the funct7 field
+* @param rs2 is the rs2 field, or rs2_any
+*
+* @return the kind of the instructions, kind_illegal if there is none
+**********************************************************************/
+template<uint32_t XLEN>
+constexpr typename rv_hart<XLEN>::insn_kind rv_hart<XLEN>::classify(uint32_t opcode, uint32_t funct3, uint32_t funct7, uint32_t rs2)
+{
+	switch(opcode)
+	{
+		default:				return kind_illegal;
+		case opcode_lui:			return kind_lui;
+		case opcode_auipc:			return kind_auipc;
+		case opcode_jal:			return kind_jal;
+		case opcode_jalr:			return kind_jalr;
+		case opcode_ecall_ebreak:		return funct3 == 0 && funct7 == 0 && (rs2 == 0 || rs2 == rs2_any) ? kind_ecall : kind_ebreak;
+		case opcode_fence:			return kind_fence;
+		case opcode_btype:
+			switch(funct3)
+			{
+			default:			return kind_illegal;
+			case funct3_beq:		return kind_beq;
+			case funct3_bne:		return kind_bne;
+			case funct3_blt:		return kind_blt;
+			case funct3_bge:		return kind_bge;
+			case funct3_bltu:		return kind_bltu;
+			case funct3_bgeu:		return kind_bgeu;
+			}
+		case opcode_itype:
+			switch(funct3)
+			{
+			default:			return kind_illegal;
+			case funct3_addi:		return kind_addi;
+			case funct3_slti:		return kind_slti;
+			case funct3_sltiu:		return kind_sltiu;
+			case funct3_xori:		return kind_xori;
+			case funct3_ori:		return kind_ori;
+			case funct3_andi:		return kind_andi;
+			case funct3_slli:
+				if(funct7 != funct7_rotate)
+					return kind_slli;
+				switch(rs2)
+				{
+				default:		return kind_illegal;
+				case rs2_any:
+				case rs2_clz:		return kind_clz;
+				case rs2_ctz:		return kind_ctz;
+				case rs2_cpop:		return kind_cpop;
+				case rs2_sextb:		return kind_sext_b;
+				case rs2_sexth:		return kind_sext_h;
+				}
+			case funct3_srli:
+				if(funct7 == funct7_orcb)
+					return rs2 == rs2_orcb || rs2 == rs2_any ? kind_orc_b : kind_illegal;
+				if(funct7 == funct7_rev8)
+					return rs2 == rs2_rev8 || rs2 == rs2_any ? kind_rev8 : kind_illegal;
+				switch(XLEN == 64 ? funct7 & ~funct7_shamt5 : funct7)
+				{
+				default:		return kind_illegal;
+				case funct7_add:	return kind_srli;
+				case funct7_sub:	return kind_srai;
+				case funct7_rotate:	return kind_rori;
+				}
+			}
+		case opcode_itype32:
+			if(XLEN == 32)
+				return kind_illegal;
+			switch(funct7 << 3 | funct3)
+			{
+			default:			return funct3 == funct3_addi ? kind_addiw : kind_illegal;
+			case funct7_add << 3 | funct3_slli:	return kind_slliw;
+			case funct7_add << 3 | funct3_srli:	return kind_srliw;
+			case funct7_sub << 3 | funct3_srli:	return kind_sraiw;
+			}
+		case opcode_load_imm:
+			switch(funct3)
+			{
+			default:			return kind_illegal;
+			case funct3_lb:			return kind_lb;
+			case funct3_lh:			return kind_lh;
+			case funct3_lw:			return kind_lw;
+			case funct3_lbu:		return kind_lbu;
+			case funct3_lhu:		return kind_lhu;
+			case funct3_lwu:		return XLEN == 64 ? kind_lwu : kind_illegal;
+			case funct3_ld:			return XLEN == 64 ? kind_ld : kind_illegal;
+			}
+		case opcode_stype:
+			switch(funct3)
+			{
+			default:			return kind_illegal;
+			case funct3_sb:			return kind_sb;
+			case funct3_sh:			return kind_sh;
+			case funct3_sw:			return kind_sw;
+			case funct3_sd:			return XLEN == 64 ? kind_sd : kind_illegal;
+			}
+		case opcode_rtype:
+			if(funct7 == funct7_muldiv)
+			{
+				switch(funct3)
+				{
+				default:
+				case funct3_mul:	return kind_mul;
+				case funct3_mulh:	return kind_mulh;
+				case funct3_mulhsu:	return kind_mulhsu;
+				case funct3_mulhu:	return kind_mulhu;
+				case funct3_div:	return kind_div;
+				case funct3_divu:	return kind_divu;
+				case funct3_rem:	return kind_rem;
+				case funct3_remu:	return kind_remu;
+				}
+			}
+			switch(funct7 << 3 | funct3)
+			{
+			default:			break;
+			case funct7_shadd << 3 | funct3_sh1add:	return kind_sh1add;
+			case funct7_shadd << 3 | funct3_sh2add:	return kind_sh2add;
+			case funct7_shadd << 3 | funct3_sh3add:	return kind_sh3add;
+			case funct7_sub << 3 | funct3_andn:	return kind_andn;
+			case funct7_sub << 3 | funct3_orn:	return kind_orn;
+			case funct7_sub << 3 | funct3_xnor:	return kind_xnor;
+			case funct7_minmax << 3 | funct3_min:	return kind_min;
+			case funct7_minmax << 3 | funct3_minu:	return kind_minu;
+			case funct7_minmax << 3 | funct3_max:	return kind_max;
+			case funct7_minmax << 3 | funct3_maxu:	return kind_maxu;
+			case funct7_rotate << 3 | funct3_rol:	return kind_rol;
+			case funct7_rotate << 3 | funct3_ror:	return kind_ror;
+			case funct7_zexth << 3 | funct3_zexth:	return XLEN == 32 && (rs2 == 0 || rs2 == rs2_any) ? kind_zext_h : kind_illegal;
+			}
+			switch(funct3)
+			{
+			default:			return kind_illegal;
+			case funct3_add:
+				switch(funct7)
+				{
+				default:		return kind_illegal;
+				case funct7_add:	return kind_add;
+				case funct7_sub:	return kind_sub;
+				}
+			case funct3_sll:		return kind_sll;
+			case funct3_slt:		return kind_slt;
+			case funct3_sltu:		return kind_sltu;
+			case funct3_xor:		return kind_xor;
+			case funct3_srl:
+				switch(funct7)
+				{
+				default:		return kind_illegal;
+				case funct7_add:	return kind_srl;
+				case funct7_sub:	return kind_sra;
+				}
+			case funct3_or:			return kind_or;
+			case funct3_and:		return kind_and;
+			}
+		case opcode_rtype32:
+			if(XLEN == 32)
+				return kind_illegal;
+			switch(funct7 << 3 | funct3)
+			{
+			default:			return kind_illegal;
+			case funct7_add << 3 | funct3_add:	return kind_addw;
+			case funct7_sub << 3 | funct3_add:	return kind_subw;
+			case funct7_add << 3 | funct3_sll:	return kind_sllw;
+			case funct7_add << 3 | funct3_srl:	return kind_srlw;
+			case funct7_sub << 3 | funct3_srl:	return kind_sraw;
+			case funct7_muldiv << 3 | funct3_mul:	return kind_mulw;
+			case funct7_muldiv << 3 | funct3_div:	return kind_divw;
+			case funct7_muldiv << 3 | funct3_divu:	return kind_divuw;
+			case funct7_muldiv << 3 | funct3_rem:	return kind_remw;
+			case funct7_muldiv << 3 | funct3_remu:	return kind_remuw;
+			case funct7_zexth << 3 | funct3_zexth:	return rs2 == 0 || rs2 == rs2_any ? kind_zext_h : kind_illegal;
+			}
+	}
+}
+
+/**
+* Classifies every key of decode_table, see decode_key(), with rs2_any,
+* and every rs2 of the unary group, the system instructions, zext.h,
+* orc.b and rev8, see decode_kind().
+*
+* @return the table
+**********************************************************************/
+template<uint32_t XLEN>
+constexpr typename rv_hart<XLEN>::kind_table rv_hart<XLEN>::make_decode_table()
+{
+	kind_table t = {};
+	for(uint32_t key = 0; key < decode_table_size; ++key)
+		t.kind[key] = classify(((key >> 8) & 0x7c) | 3, (key >> 7) & 7, key & 0x7f, rs2_any);
+	for(uint32_t rs2 = 0; rs2 < 32; ++rs2)
+	{
+		t.by_rs2[row_unary][rs2] = classify(opcode_itype, funct3_slli, funct7_rotate, rs2);
+		t.by_rs2[row_system][rs2] = classify(opcode_ecall_ebreak, 0, 0, rs2);
+		t.by_rs2[row_zext_h][rs2] = classify(XLEN == 32 ? opcode_rtype : opcode_rtype32, funct3_zexth, funct7_zexth, rs2);
+		t.by_rs2[row_orc_b][rs2] = classify(opcode_itype, funct3_srli, funct7_orcb, rs2);
+		t.by_rs2[row_rev8][rs2] = classify(opcode_itype, funct3_srli, funct7_rev8, rs2);
+	}
+	t.row[kind_clz] = row_unary;
+	t.row[kind_ecall] = row_system;
+	t.row[kind_zext_h] = row_zext_h;
+	t.row[kind_orc_b] = row_orc_b;
+	t.row[kind_rev8] = row_rev8;
+	return t;
+}
+
+template<uint32_t XLEN>
+constexpr typename rv_hart<XLEN>::kind_table rv_hart<XLEN>::decode_table = rv_hart<XLEN>::make_decode_table();
+
+/**
+* The mnemonic and format of each insn_kind, indexed by the kind.
+**********************************************************************/
+template<uint32_t XLEN>
+const typename rv_hart<XLEN>::kind_info rv_hart<XLEN>::kind_infos[kind_count] =
+{
+	{ "", format_illegal },		{ "", format_illegal },
+	{ "ebreak", format_system },	{ "ecall", format_system },
+	{ "fence", format_fence },
+	{ "lui", format_u },		{ "auipc", format_u },
+	{ "jal", format_j },		{ "jalr", format_i_load },
+	{ "beq", format_b },		{ "bne", format_b },
+	{ "blt", format_b },		{ "bge", format_b },
+	{ "bltu", format_b },		{ "bgeu", format_b },
+	{ "lb", format_i_load },	{ "lh", format_i_load },
+	{ "lw", format_i_load },	{ "lbu", format_i_load },
+	{ "lhu", format_i_load },
+	{ "sb", format_s },		{ "sh", format_s },
+	{ "sw", format_s },
+	{ "addi", format_i_alu },	{ "slti", format_i_alu },
+	{ "sltiu", format_i_alu },	{ "xori", format_i_alu },
+	{ "ori", format_i_alu },	{ "andi", format_i_alu },
+	{ "slli", format_i_shift },	{ "srli", format_i_shift },
+	{ "srai", format_i_shift },
+	{ "add", format_r },		{ "sub", format_r },
+	{ "sll", format_r },		{ "slt", format_r },
+	{ "sltu", format_r },		{ "xor", format_r },
+	{ "srl", format_r },		{ "sra", format_r },
+	{ "or", format_r },		{ "and", format_r },
+	{ "mul", format_r },		{ "mulh", format_r },
+	{ "mulhsu", format_r },		{ "mulhu", format_r },
+	{ "div", format_r },		{ "divu", format_r },
+	{ "rem", format_r },		{ "remu", format_r },
+	{ "sh1add", format_r },		{ "sh2add", format_r },
+	{ "sh3add", format_r },
+	{ "andn", format_r },		{ "orn", format_r },
+	{ "xnor", format_r },
+	{ "min", format_r },		{ "minu", format_r },
+	{ "max", format_r },		{ "maxu", format_r },
+	{ "rol", format_r },		{ "ror", format_r },
+	{ "rori", format_i_shift },
+	{ "clz", format_unary },	{ "ctz", format_unary },
+	{ "cpop", format_unary },	{ "sext.b", format_unary },
+	{ "sext.h", format_unary },	{ "zext.h", format_unary },
+	{ "orc.b", format_unary },	{ "rev8", format_unary },
+	{ "lwu", format_i_load },	{ "ld", format_i_load },
+	{ "sd", format_s },
+	{ "addiw", format_i_alu },	{ "slliw", format_i_shift },
+	{ "srliw", format_i_shift },	{ "sraiw", format_i_shift },
+	{ "addw", format_r },		{ "subw", format_r },
+	{ "sllw", format_r },		{ "srlw", format_r },
+	{ "sraw", format_r },
+	{ "mulw", format_r },		{ "divw", format_r },
+	{ "divuw", format_r },		{ "remw", format_r },
+	{ "remuw", format_r },
+};
+
+/**
+* Decodes the given instruction into a decoded_insn that can be stored
+* in the instruction cache. The kind comes from decode_table like in
+* dcex(), so that a cached instruction behaves like an uncached one,
+* and the format of the kind tells which immediate it has.
+*
+* @param insn is the instruction to be decoded, as returned by fetch()
+* @param len is its length in memory, insn_len after the fetch()
+*
+* @return the decoded form of the instruction
+**********************************************************************/
+template<uint32_t XLEN>
+typename rv_hart<XLEN>::decoded_insn rv_hart<XLEN>::predecode(uint32_t insn, uint32_t len)
+{
+	decoded_insn d;
+	d.rd = get_rd(insn);
+	d.rs1 = get_rs1(insn);
+	d.rs2 = get_rs2(insn);
+	d.kind = decode_kind(insn);
+	d.len = len;
+	d.exec = len == 2 ? fast_handlers<2>[d.kind] : fast_handlers<4>[d.kind];
+
+	switch(kind_infos[d.kind].format)
+	{
+		default:				d.imm = 0; break;
+		case format_i_alu:
+		case format_i_load:			d.imm = get_imm_i(insn); break;
+		case format_i_shift:			d.imm = (insn >> 20) & (XLEN - 1); break;
+		case format_s:				d.imm = get_imm_s(insn); break;
+		case format_b:				d.imm = get_imm_b(insn); break;
+		case format_u:				d.imm = get_imm_u(insn); break;
+		case format_j:				d.imm = get_imm_j(insn); break;
+	}
+
+	return d;
+}
+
+/**
+* Fuses the instruction freshly decoded into the slot at pc with the
+* one after it when the two are one of the idioms compilers emit all
+* the time, so that the threaded engine runs them with one dispatch:
+*	- lui rd + addi rd,rd (a 32-bit constant)
+*	- auipc rd + jalr rs1=rd (a far call or jump)
+*	- slt, sltu, slti or sltiu rd + beq or bne of rd against x0
+*	- addi rd + a backward branch on rd (a loop counter)
+* Either of them may be compressed. Only the kind of the first slot
+* changes (exec still runs the first instruction alone for
+* the other engines), the second one is decoded into the slot after
+* the first one if it is not there yet. The second slot is in the same
+* 4 KiB page, so that both are in the same chunk of the icache.
+*
+* @param d is the slot at pc, just decoded
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::fuse_pair(decoded_insn *d)
+{
+	reg_t second = pc + d->len;
+	if((pc & 0xfff) + d->len > 0xffe || (uint64_t)second + 4 > mem->get_size())
+		return;
+
+	uint8_t first = d->kind;
+	if(first != kind_lui && first != kind_auipc && first != kind_addi && first != kind_slt
+		&& first != kind_sltu && first != kind_slti && first != kind_sltiu)
+		return;
+	if(d->rd == 0)
+		return;
+
+	decoded_insn next = fetch_decoded(second);
+	bool is_branch = next.kind >= kind_beq && next.kind <= kind_bgeu;
+	uint8_t fused = kind_decode;
+
+	switch(first)
+	{
+	case kind_lui:
+		if(next.kind == kind_addi && next.rd == d->rd && next.rs1 == d->rd)
+			fused = kind_lui_addi;
+		break;
+	case kind_auipc:
+		if(next.kind == kind_jalr && next.rs1 == d->rd)
+			fused = kind_auipc_jalr;
+		break;
+	case kind_addi:
+		if(is_branch && next.imm < 0 && (next.rs1 == d->rd || next.rs2 == d->rd))
+			fused = kind_addi_branch;
+		break;
+	default:
+		if((next.kind == kind_beq || next.kind == kind_bne)
+			&& ((next.rs1 == d->rd && next.rs2 == 0) || (next.rs2 == d->rd && next.rs1 == 0)))
+		{
+			fused = first == kind_slt ? kind_slt_branch :
+				first == kind_sltu ? kind_sltu_branch :
+				first == kind_slti ? kind_slti_branch : kind_sltiu_branch;
+		}
+		break;
+	}
+
+	if(fused == kind_decode)
+		return;
+
+	decoded_insn *s = d + (d->len >> 1);
+	if(s->kind == kind_decode)
+		*s = next;
+	d->kind = fused;
+}
+
+/**
+* The handler for each insn_kind, indexed by the kind, for instructions
+* of len bytes.
+**********************************************************************/
+template<uint32_t XLEN>
+template<uint32_t len>
+void (* const rv_hart<XLEN>::fast_handlers[kind_count])(rv_hart *h, const decoded_insn &d) =
+{
+	fast_decode, fast_illegal, fast_ebreak, fast_ecall<len>, fast_fence<len>,
+	fast_lui<len>, fast_auipc<len>, fast_jal<len>, fast_jalr<len>,
+	fast_beq<len>, fast_bne<len>, fast_blt<len>, fast_bge<len>, fast_bltu<len>, fast_bgeu<len>,
+	fast_lb<len>, fast_lh<len>, fast_lw<len>, fast_lbu<len>, fast_lhu<len>,
+	fast_sb<len>, fast_sh<len>, fast_sw<len>,
+	fast_addi<len>, fast_slti<len>, fast_sltiu<len>, fast_xori<len>, fast_ori<len>, fast_andi<len>,
+	fast_slli<len>, fast_srli<len>, fast_srai<len>,
+	fast_add<len>, fast_sub<len>, fast_sll<len>, fast_slt<len>, fast_sltu<len>,
+	fast_xor<len>, fast_srl<len>, fast_sra<len>, fast_or<len>, fast_and<len>,
+	fast_mul<len>, fast_mulh<len>, fast_mulhsu<len>, fast_mulhu<len>,
+	fast_div<len>, fast_divu<len>, fast_rem<len>, fast_remu<len>,
+	fast_sh1add<len>, fast_sh2add<len>, fast_sh3add<len>,
+	fast_andn<len>, fast_orn<len>, fast_xnor<len>,
+	fast_min<len>, fast_minu<len>, fast_max<len>, fast_maxu<len>,
+	fast_rol<len>, fast_ror<len>, fast_rori<len>,
+	fast_clz<len>, fast_ctz<len>, fast_cpop<len>, fast_sext_b<len>, fast_sext_h<len>, fast_zext_h<len>,
+	fast_orc_b<len>, fast_rev8<len>,
+	fast_lwu<len>, fast_ld<len>, fast_sd<len>, fast_addiw<len>, fast_slliw<len>, fast_srliw<len>,
+	fast_sraiw<len>, fast_addw<len>, fast_subw<len>, fast_sllw<len>, fast_srlw<len>, fast_sraw<len>,
+	fast_mulw<len>, fast_divw<len>, fast_divuw<len>, fast_remw<len>, fast_remuw<len>,
+};
+
+/**
+* The handler of a slot that has not been decoded yet. It decodes the
+* instruction at pc into the slot and then executes it.
+*
+* @param h is the hart executing the instruction
+*
+* @param d is the slot (ignored, it is found again from pc)
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::fast_decode(rv_hart *h, const decoded_insn &d)
+{
+	(void)d;
+
+	decoded_insn &slot = h->icache.at(h->pc);
+	slot = h->fetch_decoded(h->pc);
+	slot.exec(h, slot);
+}
+
+/*
+* The fast_xxx() handlers below execute a decoded instruction the same
+* way as the matching exec_xxx() method does, without any rendering.
+*
+* @tparam len is the length of the instruction in memory, 2 if it is
+* compressed
+*
+* @param h is the hart executing the instruction
+*
+* @param d is the decoded instruction
+**********************************************************************/
+template<uint32_t XLEN>
+void rv_hart<XLEN>::fast_illegal(rv_hart *h, const decoded_insn &d)
+{
+	(void)d;
+	h->stop(halt_illegal);
+}
+
+template<uint32_t XLEN>
+void rv_hart<XLEN>::fast_ebreak(rv_hart *h, const decoded_insn &d)
+{
+	(void)d;
+	h->stop(halt_ebreak);
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_ecall(rv_hart *h, const decoded_insn &d)
+{
+	(void)d;
+	if(h->system_call())
+		h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_fence(rv_hart *h, const decoded_insn &d)
+{
+	(void)d;
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_lui(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, d.imm);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_auipc(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, d.imm + h->pc);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_jal(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->pc + len);
+	h->note_edge(h->pc, h->pc + d.imm);
+	h->pc += d.imm;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_jalr(rv_hart *h, const decoded_insn &d)
+{
+	reg_t target = ((reg_t)h->regs.get(d.rs1) + d.imm) & ~(reg_t)1;
+	h->regs.set(d.rd, h->pc + len);
+	h->note_edge(h->pc, target);
+	h->pc = target;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_beq(rv_hart *h, const decoded_insn &d)
+{
+	h->branch(h->regs.get(d.rs1) == h->regs.get(d.rs2), d.imm, len);
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_bne(rv_hart *h, const decoded_insn &d)
+{
+	h->branch(h->regs.get(d.rs1) != h->regs.get(d.rs2), d.imm, len);
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_blt(rv_hart *h, const decoded_insn &d)
+{
+	h->branch(h->regs.get(d.rs1) < h->regs.get(d.rs2), d.imm, len);
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_bge(rv_hart *h, const decoded_insn &d)
+{
+	h->branch(h->regs.get(d.rs1) >= h->regs.get(d.rs2), d.imm, len);
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_bltu(rv_hart *h, const decoded_insn &d)
+{
+	h->branch((reg_t)h->regs.get(d.rs1) < (reg_t)h->regs.get(d.rs2), d.imm, len);
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_bgeu(rv_hart *h, const decoded_insn &d)
+{
+	h->branch((reg_t)h->regs.get(d.rs1) >= (reg_t)h->regs.get(d.rs2), d.imm, len);
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_lb(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int8_t)h->mem->get8((reg_t)h->regs.get(d.rs1) + d.imm));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_lh(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int16_t)h->mem->get16((reg_t)h->regs.get(d.rs1) + d.imm));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_lw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int32_t)h->mem->get32((reg_t)h->regs.get(d.rs1) + d.imm));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_lbu(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->mem->get8((reg_t)h->regs.get(d.rs1) + d.imm));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_lhu(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->mem->get16((reg_t)h->regs.get(d.rs1) + d.imm));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sb(rv_hart *h, const decoded_insn &d)
+{
+	reg_t address = (reg_t)h->regs.get(d.rs1) + d.imm;
+	h->mem->set8(address, h->regs.get(d.rs2));
+	h->invalidate_icache(address, 1);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sh(rv_hart *h, const decoded_insn &d)
+{
+	reg_t address = (reg_t)h->regs.get(d.rs1) + d.imm;
+	h->mem->set16(address, h->regs.get(d.rs2));
+	h->invalidate_icache(address, 2);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sw(rv_hart *h, const decoded_insn &d)
+{
+	reg_t address = (reg_t)h->regs.get(d.rs1) + d.imm;
+	h->mem->set32(address, h->regs.get(d.rs2));
+	h->invalidate_icache(address, 4);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_addi(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (reg_t)h->regs.get(d.rs1) + d.imm);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_slti(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (h->regs.get(d.rs1) < d.imm) ? 1 : 0);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sltiu(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, ((reg_t)h->regs.get(d.rs1) < (reg_t)d.imm) ? 1 : 0);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_xori(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) ^ d.imm);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_ori(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) | d.imm);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_andi(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) & d.imm);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_slli(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (reg_t)h->regs.get(d.rs1) << d.imm);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_srli(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (reg_t)h->regs.get(d.rs1) >> d.imm);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_srai(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) >> d.imm);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_add(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (reg_t)h->regs.get(d.rs1) + h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sub(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (reg_t)h->regs.get(d.rs1) - h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sll(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (reg_t)h->regs.get(d.rs1) << (h->regs.get(d.rs2) & (XLEN - 1)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_slt(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (h->regs.get(d.rs1) < h->regs.get(d.rs2)) ? 1 : 0);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sltu(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, ((reg_t)h->regs.get(d.rs1) < (reg_t)h->regs.get(d.rs2)) ? 1 : 0);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_xor(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) ^ h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_srl(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (reg_t)h->regs.get(d.rs1) >> (h->regs.get(d.rs2) & (XLEN - 1)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sra(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) >> (h->regs.get(d.rs2) & (XLEN - 1)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_or(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) | h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_and(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) & h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_mul(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (reg_t)h->regs.get(d.rs1) * (reg_t)h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_mulh(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_mulh(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_mulhsu(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_mulhsu(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_mulhu(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_mulhu(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_div(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_div(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_divu(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_divu(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_rem(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_rem(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_remu(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_remu(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sh1add(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, ((reg_t)h->regs.get(d.rs1) << 1) + (reg_t)h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sh2add(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, ((reg_t)h->regs.get(d.rs1) << 2) + (reg_t)h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sh3add(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, ((reg_t)h->regs.get(d.rs1) << 3) + (reg_t)h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_andn(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) & ~h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_orn(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) | ~h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_xnor(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, ~(h->regs.get(d.rs1) ^ h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_min(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) < h->regs.get(d.rs2) ? h->regs.get(d.rs1) : h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_minu(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (reg_t)h->regs.get(d.rs1) < (reg_t)h->regs.get(d.rs2) ? h->regs.get(d.rs1) : h->regs.get(d.rs2));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_max(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) < h->regs.get(d.rs2) ? h->regs.get(d.rs2) : h->regs.get(d.rs1));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_maxu(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (reg_t)h->regs.get(d.rs1) < (reg_t)h->regs.get(d.rs2) ? h->regs.get(d.rs2) : h->regs.get(d.rs1));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_rol(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_rol(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_ror(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_ror(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_rori(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_ror(h->regs.get(d.rs1), d.imm));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_clz(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_clz(h->regs.get(d.rs1)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_ctz(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_ctz(h->regs.get(d.rs1)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_cpop(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_cpop(h->regs.get(d.rs1)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sext_b(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int8_t)h->regs.get(d.rs1));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sext_h(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int16_t)h->regs.get(d.rs1));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_zext_h(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->regs.get(d.rs1) & 0xffff);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_orc_b(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_orc_b(h->regs.get(d.rs1)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_rev8(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_rev8(h->regs.get(d.rs1)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_lwu(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->mem->get32((reg_t)h->regs.get(d.rs1) + d.imm));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_ld(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, h->mem->get64((reg_t)h->regs.get(d.rs1) + d.imm));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sd(rv_hart *h, const decoded_insn &d)
+{
+	reg_t address = (reg_t)h->regs.get(d.rs1) + d.imm;
+	h->mem->set64(address, h->regs.get(d.rs2));
+	h->invalidate_icache(address, 8);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_addiw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int32_t)((reg_t)h->regs.get(d.rs1) + d.imm));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_slliw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int32_t)((uint32_t)h->regs.get(d.rs1) << d.imm));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_srliw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int32_t)((uint32_t)h->regs.get(d.rs1) >> d.imm));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sraiw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int32_t)h->regs.get(d.rs1) >> d.imm);
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_addw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int32_t)((uint32_t)h->regs.get(d.rs1) + (uint32_t)h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_subw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int32_t)((uint32_t)h->regs.get(d.rs1) - (uint32_t)h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sllw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int32_t)((uint32_t)h->regs.get(d.rs1) << (h->regs.get(d.rs2) & 0x1f)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_srlw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int32_t)((uint32_t)h->regs.get(d.rs1) >> (h->regs.get(d.rs2) & 0x1f)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_sraw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int32_t)h->regs.get(d.rs1) >> (h->regs.get(d.rs2) & 0x1f));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_mulw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, (int32_t)((uint32_t)h->regs.get(d.rs1) * (uint32_t)h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_divw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_divw(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_divuw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_divuw(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_remw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_remw(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+template<uint32_t XLEN>
+template<uint32_t len>
+void rv_hart<XLEN>::fast_remuw(rv_hart *h, const decoded_insn &d)
+{
+	h->regs.set(d.rd, calc_remuw(h->regs.get(d.rs1), h->regs.get(d.rs2)));
+	h->pc += len;
+}
+
+/*
+* The jit_xxx() helpers are called by the native code of the JIT for
+* the loads and stores, so that they go through memory (with its range
+* checks and warnings) and the instruction cache invalidation exactly
+* like the fast_xxx() handlers.
+*
+* @param h is the hart executing the instruction
+*
+* @param addr is the effective address
+*
+* @return loads: the value to write to rd. stores: true if the store
+* hit a translated block, so the native code has to return at once.
+**********************************************************************/
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_lb(rv_hart *h, uint32_t addr)
+{
+	return (int8_t)h->mem->get8(addr);
+}
+
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_lh(rv_hart *h, uint32_t addr)
+{
+	return (int16_t)h->mem->get16(addr);
+}
+
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_lw(rv_hart *h, uint32_t addr)
+{
+	return h->mem->get32(addr);
+}
+
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_lbu(rv_hart *h, uint32_t addr)
+{
+	return h->mem->get8(addr);
+}
+
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_lhu(rv_hart *h, uint32_t addr)
+{
+	return h->mem->get16(addr);
+}
+
+template<uint32_t XLEN>
+bool rv_hart<XLEN>::jit_sb(rv_hart *h, uint32_t addr, uint32_t val)
+{
+	h->mem->set8(addr, val);
+	h->invalidate_icache(addr, 1);
+	return h->blocks_stale;
+}
+
+template<uint32_t XLEN>
+bool rv_hart<XLEN>::jit_sh(rv_hart *h, uint32_t addr, uint32_t val)
+{
+	h->mem->set16(addr, val);
+	h->invalidate_icache(addr, 2);
+	return h->blocks_stale;
+}
+
+template<uint32_t XLEN>
+bool rv_hart<XLEN>::jit_sw(rv_hart *h, uint32_t addr, uint32_t val)
+{
+	h->mem->set32(addr, val);
+	h->invalidate_icache(addr, 4);
+	return h->blocks_stale;
+}
+
+/**
+* Counts a jalr edge for the native code, which only knows the target
+* at run time.
+*
+* @param h is the hart
+* @param to is the target of the jump
+* @param from is the address of the jump
+*
+* @return to, so that the native code gets it back in eax
+***********************************************************************/
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_edge(rv_hart *h, uint32_t to, uint32_t from)
+{
+	h->note_edge(from, to);
+	return to;
+}
+
+/*
+* The divisions of the M extension for the native code, which would
+* have to check for division by zero and overflow around every idiv.
+*
+* @param h is the hart (unused)
+* @param a is the value of rs1
+* @param b is the value of rs2
+*
+* @return the value to write to rd
+**********************************************************************/
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_div(rv_hart *h, uint32_t a, uint32_t b)
+{
+	(void)h;
+	return calc_div(a, b);
+}
+
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_divu(rv_hart *h, uint32_t a, uint32_t b)
+{
+	(void)h;
+	return calc_divu(a, b);
+}
+
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_rem(rv_hart *h, uint32_t a, uint32_t b)
+{
+	(void)h;
+	return calc_rem(a, b);
+}
+
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_remu(rv_hart *h, uint32_t a, uint32_t b)
+{
+	(void)h;
+	return calc_remu(a, b);
+}
+
+/*
+* The counting instructions of Zbb for the native code, so that they
+* use the same builtins as the interpreter whatever the x86-64 host
+* has (lzcnt, tzcnt and popcnt are not everywhere.)
+*
+* @param h is the hart (unused)
+* @param a is the value of rs1
+*
+* @return the value to write to rd
+**********************************************************************/
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_clz(rv_hart *h, uint32_t a)
+{
+	(void)h;
+	return calc_clz(a);
+}
+
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_ctz(rv_hart *h, uint32_t a)
+{
+	(void)h;
+	return calc_ctz(a);
+}
+
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_cpop(rv_hart *h, uint32_t a)
+{
+	(void)h;
+	return calc_cpop(a);
+}
+
+template<uint32_t XLEN>
+uint32_t rv_hart<XLEN>::jit_orc_b(rv_hart *h, uint32_t a)
+{
+	(void)h;
+	return calc_orc_b(a);
+}
+
+template class rv_hart<RV_HART_XLEN>;
+
+// dcex() is part of the interface, make both policies available
+template void rv_hart<RV_HART_XLEN>::dcex<no_trace>(uint32_t insn, const no_trace &trace);
+template void rv_hart<RV_HART_XLEN>::dcex<text_trace>(uint32_t insn, const text_trace &trace);
+
@@ -1,89 +1,369 @@
+#ifndef rv32i_H
+#define rv32i_H
+
 #include<cstdint>
 #include<string>
+#include<vector>
+#include<iostream>
+#include<limits>
+#include<type_traits>
 #include"memory.h"
 #include"registerfile.h"
+#include"jit.h"
+#include"word_table.h"
+#include"coverage.h"
+#include"trace.h"
+#include"hex.h"
+#include"syscalls.h"
 
 /*
 * The documentation of most of the functions is included in the .cpp file.
 */
 
-class rv32i
+template<uint32_t XLEN> class rv_hart;
+template<uint32_t XLEN> class async_tracer;
+class elf_loader;
+
+typedef rv_hart<32> rv32i;
+typedef rv_hart<64> rv64i;
+
+__extension__ typedef __int128 int128_t;		// for the high half of an RV64 product
+__extension__ typedef unsigned __int128 uint128_t;
+
+/**
+* Tracing policies for tick(), dcex() and the exec_xxx() methods.
+* Since enabled is a compile-time constant, the no_trace instantiations
+* contain none of the rendering code (pos is only there so that the
+* dead code still compiles.)
+***********************************************************************/
+struct no_trace
+{
+	static constexpr bool enabled = false;
+	std::ostream *pos = nullptr;
+};
+
+struct text_trace
+{
+	static constexpr bool enabled = true;
+	std::ostream *pos = nullptr;	// rendered instructions, or nullptr
+};
+
+/**
+* One slot of the pre-decoded instruction cache. The fields of the
+* instruction word are extracted and the immediate is sign-extended
+* once, so that executing the slot again costs only an indirect call.
+* A compressed instruction is cached in the form of the instruction it
+* expands to, with len 2 and a handler that steps pc by 2. There is one
+* slot for every halfword of the memory.
+***********************************************************************/
+template<uint32_t XLEN>
+struct decoded_insn
+{
+	void (*exec)(rv_hart<XLEN> *hart, const decoded_insn &d);
+	int32_t imm;
+	uint8_t rd;
+	uint8_t rs1;
+	uint8_t rs2;
+	uint8_t kind;
+	uint8_t len;			// of the instruction in memory, 2 or 4
+};
+
+/**
+* One slot of the cache of rendered instructions: the text decode()
+* made of insn, at pc if it is a pc-relative form (jal and the
+* branches.) A slot with len zero is empty. Kept at 64 bytes, one
+* cache line.
+***********************************************************************/
+struct rendered_insn
+{
+	uint32_t insn;
+	uint32_t pc;			// only compared for the pc-relative forms
+	uint8_t len;			// of text
+	alignas(16) char text[48];
+};
+
+/**
+* A basic block translated into decoded micro-ops: a straight run of
+* instructions that ends with a jump, a branch, an ecall, an ebreak or
+* an illegal instruction. chain[] holds the blocks execution continued
+* with before, so that they can be entered again without a lookup. The
+* addresses fit in 32 bits with either XLEN, the memory is at most 4 GiB.
+***********************************************************************/
+template<uint32_t XLEN>
+struct translated_block
+{
+	uint32_t start;				// address of the first insn
+	uint32_t end;				// address after the last insn
+	std::vector<decoded_insn<XLEN>> ops;
+	translated_block *chain[2];
+	uint32_t heat;				// times run by the interpreter
+	jit::native_block native;		// compiled code or nullptr, only with XLEN 32
+};
+
+/**
+* A hart of XLEN bits: rv32i (RV32I) or rv64i (RV64I), with the same
+* extensions. The registers, pc and addresses are reg_t (sreg_t when
+* signed); the instruction words, immediates and the memory size stay
+* 32 bits wide for both.
+***********************************************************************/
+template<uint32_t XLEN>
+class rv_hart
 {
+	static_assert(XLEN == 32 || XLEN == 64, "XLEN is 32 or 64");
+
 public:
-	rv32i(memory *m)
+	typedef typename std::conditional<XLEN == 32, uint32_t, uint64_t>::type reg_t;
+	typedef typename std::make_signed<reg_t>::type sreg_t;
+	typedef ::decoded_insn<XLEN> decoded_insn;
+	typedef ::translated_block<XLEN> translated_block;
+
+	rv_hart(memory *m)
 	{
 		mem = m;
+		mem->set_xlen(XLEN);
+		entry = 0;
+		pc = 0;
+		halt = false;
+		show_instructions = false;
+		show_registers = false;
+		compressed = false;
+		insn_len = 4;
 		insn_counter = 0;
+		engine = engine_cached;
+		jitter = nullptr;
+		cov_map = nullptr;
+		render_cache.assign(render_cache_size, rendered_insn());
+		trace_out = nullptr;
+		tracer = nullptr;
+		sys = nullptr;
+		replay_syscall = false;
+		replay_result = 0;
+		halted_by = halt_none;
+		exit_status = 0;
+		out = &std::cout;
+		dump_out = &std::cout;
+		flush_icache();
 	}
 
-	void disasm(void);
+	~rv_hart();
+
+	void disasm(const elf_loader *symbols);
 
 	std::string decode(uint32_t insn) const;
+	void decode(text_line &line, uint32_t insn) const;
 
 	void reset();
 	void dump() const;
 
 	void set_show_instructions(bool b);
 	void set_show_registers(bool b);
+	void set_compressed(bool b);
+	void set_entry(reg_t addr);
+	void set_coverage(uint8_t *map);
+	void set_trace_writer(trace_writer *w);
+	void set_tracer(async_tracer<XLEN> *t);
+	void set_syscalls(syscalls *s);
+	void set_output(std::ostream *os);
+	void set_dump_output(std::ostream *os);
+	void start_replay();
+	void replay(const trace_record &r);
+	bool replay(trace_reader &in);
 	bool is_halted() const;
-	void dcex(uint32_t insn, std::ostream*);
+	bool is_compressed() const;
+	bool has_exited() const;
+	uint32_t get_exit_status() const;
+
+	/**
+	* Why execution stopped, set along with halt.
+	***************************************************************/
+	enum halt_reason
+	{
+		halt_none,		// not halted
+		halt_ebreak,		// ebreak, or ecall without emulation
+		halt_illegal,		// an illegal instruction
+		halt_exit,		// an exit system call
+		halt_limit		// the instruction limit was reached
+	};
+
+	halt_reason get_halt_reason() const;
+
+	/**
+	* Fetches the instruction at addr and sets insn_len to its length.
+	* Without the C extension it is always the 32-bit word at addr.
+	* With it, a halfword whose two low bits are not 11 is a whole
+	* compressed instruction, which is expanded to the 32-bit
+	* instruction it stands for.
+	*
+	* @param addr is the address of the instruction
+	*
+	* @return the instruction, for dcex() or predecode()
+	***************************************************************/
+	uint32_t fetch(reg_t addr)
+	{
+		if(!compressed)
+		{
+			insn_len = 4;
+			return mem->get32(addr);
+		}
+
+		uint32_t insn = mem->get16(addr);
+		if((insn & 3) != 3)
+		{
+			insn_len = 2;
+			return expand_compressed(insn);
+		}
+		insn_len = 4;
+		return insn | (uint32_t)mem->get16(addr + 2) << 16;
+	}
+
+	/**
+	* @param addr is the address of the instruction
+	*
+	* @return the instruction at addr, fetched and pre-decoded
+	***************************************************************/
+	decoded_insn fetch_decoded(reg_t addr)
+	{
+		uint32_t insn = fetch(addr);
+		return predecode(insn, insn_len);
+	}
+
+	static uint32_t expand_compressed(uint32_t insn);
+
+	template<typename T> void dcex(uint32_t insn, const T &trace);
 	void tick();
+	template<typename T> void tick(const T &trace);
+	void flush_icache();
+	void snapshot();
+	bool restore();
+	void inject(reg_t addr, const uint8_t *data, uint32_t len);
 	void run(uint64_t limit);
+	void execute(uint64_t limit);
+	bool run_to(reg_t addr);
+	reg_t get_pc() const;
+	uint64_t get_insn_counter() const;
+
+	template<typename T> void exec_illegal_insn(uint32_t insn, const T &trace);
+	template<typename T> void exec_ebreak(uint32_t insn, const T &trace);
+	template<typename T> void exec_ecall(uint32_t insn, const T &trace);
+	template<typename T> void exec_lui(uint32_t insn, const T &trace);
+	template<typename T> void exec_auipc(uint32_t insn, const T &trace);
+	template<typename T> void exec_jal(uint32_t insn, const T &trace);
+	template<typename T> void exec_jalr(uint32_t insn, const T &trace);
+	template<typename T> void exec_bne(uint32_t insn, const T &trace);
+	template<typename T> void exec_blt(uint32_t insn, const T &trace);
+	template<typename T> void exec_bge(uint32_t insn, const T &trace);
+	template<typename T> void exec_bltu(uint32_t insn, const T &trace);
+	template<typename T> void exec_bgeu(uint32_t insn, const T &trace);
+	template<typename T> void exec_beq(uint32_t insn, const T &trace);
+	template<typename T> void exec_addi(uint32_t insn, const T &trace);
+	template<typename T> void exec_lbu(uint32_t insn, const T &trace);
+	template<typename T> void exec_lhu(uint32_t insn, const T &trace);
+	template<typename T> void exec_lb(uint32_t insn, const T &trace);
+	template<typename T> void exec_lh(uint32_t insn, const T &trace);
+	template<typename T> void exec_lw(uint32_t insn, const T &trace);
+	template<typename T> void exec_sb(uint32_t insn, const T &trace);
+	template<typename T> void exec_sh(uint32_t insn, const T &trace);
+	template<typename T> void exec_sw(uint32_t insn, const T &trace);
+	template<typename T> void exec_slti(uint32_t insn, const T &trace);
+	template<typename T> void exec_sltiu(uint32_t insn, const T &trace);
+	template<typename T> void exec_xori(uint32_t insn, const T &trace);
+	template<typename T> void exec_ori(uint32_t insn, const T &trace);
+	template<typename T> void exec_andi(uint32_t insn, const T &trace);
+	template<typename T> void exec_slli(uint32_t insn, const T &trace);
+	template<typename T> void exec_srli(uint32_t insn, const T &trace);
+	template<typename T> void exec_srai(uint32_t insn, const T &trace);
+	template<typename T> void exec_add(uint32_t insn, const T &trace);
+	template<typename T> void exec_sub(uint32_t insn, const T &trace);
+	template<typename T> void exec_sll(uint32_t insn, const T &trace);
+	template<typename T> void exec_slt(uint32_t insn, const T &trace);
+	template<typename T> void exec_sltu(uint32_t insn, const T &trace);
+	template<typename T> void exec_xor(uint32_t insn, const T &trace);
+	template<typename T> void exec_srl(uint32_t insn, const T &trace);
+	template<typename T> void exec_sra(uint32_t insn, const T &trace);
+	template<typename T> void exec_or(uint32_t insn, const T &trace);
+	template<typename T> void exec_and(uint32_t insn, const T &trace);
+	template<typename T> void exec_fence(uint32_t insn, const T &trace);
+	template<typename T> void exec_mul(uint32_t insn, const T &trace);
+	template<typename T> void exec_mulh(uint32_t insn, const T &trace);
+	template<typename T> void exec_mulhsu(uint32_t insn, const T &trace);
+	template<typename T> void exec_mulhu(uint32_t insn, const T &trace);
+	template<typename T> void exec_div(uint32_t insn, const T &trace);
+	template<typename T> void exec_divu(uint32_t insn, const T &trace);
+	template<typename T> void exec_rem(uint32_t insn, const T &trace);
+	template<typename T> void exec_remu(uint32_t insn, const T &trace);
+	template<typename T> void exec_sh1add(uint32_t insn, const T &trace);
+	template<typename T> void exec_sh2add(uint32_t insn, const T &trace);
+	template<typename T> void exec_sh3add(uint32_t insn, const T &trace);
+	template<typename T> void exec_andn(uint32_t insn, const T &trace);
+	template<typename T> void exec_orn(uint32_t insn, const T &trace);
+	template<typename T> void exec_xnor(uint32_t insn, const T &trace);
+	template<typename T> void exec_min(uint32_t insn, const T &trace);
+	template<typename T> void exec_minu(uint32_t insn, const T &trace);
+	template<typename T> void exec_max(uint32_t insn, const T &trace);
+	template<typename T> void exec_maxu(uint32_t insn, const T &trace);
+	template<typename T> void exec_rol(uint32_t insn, const T &trace);
+	template<typename T> void exec_ror(uint32_t insn, const T &trace);
+	template<typename T> void exec_rori(uint32_t insn, const T &trace);
+	template<typename T> void exec_clz(uint32_t insn, const T &trace);
+	template<typename T> void exec_ctz(uint32_t insn, const T &trace);
+	template<typename T> void exec_cpop(uint32_t insn, const T &trace);
+	template<typename T> void exec_sext_b(uint32_t insn, const T &trace);
+	template<typename T> void exec_sext_h(uint32_t insn, const T &trace);
+	template<typename T> void exec_zext_h(uint32_t insn, const T &trace);
+	template<typename T> void exec_orc_b(uint32_t insn, const T &trace);
+	template<typename T> void exec_rev8(uint32_t insn, const T &trace);
+	template<typename T> void exec_lwu(uint32_t insn, const T &trace);
+	template<typename T> void exec_ld(uint32_t insn, const T &trace);
+	template<typename T> void exec_sd(uint32_t insn, const T &trace);
+	template<typename T> void exec_addiw(uint32_t insn, const T &trace);
+	template<typename T> void exec_slliw(uint32_t insn, const T &trace);
+	template<typename T> void exec_srliw(uint32_t insn, const T &trace);
+	template<typename T> void exec_sraiw(uint32_t insn, const T &trace);
+	template<typename T> void exec_addw(uint32_t insn, const T &trace);
+	template<typename T> void exec_subw(uint32_t insn, const T &trace);
+	template<typename T> void exec_sllw(uint32_t insn, const T &trace);
+	template<typename T> void exec_srlw(uint32_t insn, const T &trace);
+	template<typename T> void exec_sraw(uint32_t insn, const T &trace);
+	template<typename T> void exec_mulw(uint32_t insn, const T &trace);
+	template<typename T> void exec_divw(uint32_t insn, const T &trace);
+	template<typename T> void exec_divuw(uint32_t insn, const T &trace);
+	template<typename T> void exec_remw(uint32_t insn, const T &trace);
+	template<typename T> void exec_remuw(uint32_t insn, const T &trace);
+
+	void render_parcel(text_line &line, uint32_t insn) const;
+	void render_insn(text_line &line, uint32_t insn) const;
+	static void render_mnemonic(text_line &line, const char *mnemonic);
+
+	/**
+	* Appends the value of a register as XLEN/4 hex digits.
+	***************************************************************/
+	static text_line &render_reg(text_line &line, reg_t val)
+	{
+		return XLEN == 32 ? line.hex32(val) : line.hex64(val);
+	}
 
-	void exec_illegal_insn(uint32_t insn, std::ostream* pos);
-	void exec_ebreak(uint32_t insn, std::ostream* pos);
-	void exec_lui(uint32_t insn, std::ostream* pos);
-	void exec_auipc(uint32_t insn, std::ostream* pos);
-	void exec_jal(uint32_t insn, std::ostream* pos);
-	void exec_jalr(uint32_t insn, std::ostream* pos);
-	void exec_bne(uint32_t insn, std::ostream* pos);
-	void exec_blt(uint32_t insn, std::ostream* pos);
-	void exec_bge(uint32_t insn, std::ostream* pos);
-	void exec_bltu(uint32_t insn, std::ostream* pos);
-	void exec_bgeu(uint32_t insn, std::ostream* pos);
-	void exec_beq(uint32_t insn, std::ostream* pos);
-	void exec_addi(uint32_t insn, std::ostream* pos);
-	void exec_lbu(uint32_t insn, std::ostream* pos);
-	void exec_lhu(uint32_t insn, std::ostream* pos);
-	void exec_lb(uint32_t insn, std::ostream* pos);
-	void exec_lh(uint32_t insn, std::ostream* pos);
-	void exec_lw(uint32_t insn, std::ostream* pos);
-	void exec_sb(uint32_t insn, std::ostream* pos);
-	void exec_sh(uint32_t insn, std::ostream* pos);
-	void exec_sw(uint32_t insn, std::ostream* pos);
-	void exec_slti(uint32_t insn, std::ostream* pos);
-	void exec_sltiu(uint32_t insn, std::ostream* pos);
-	void exec_xori(uint32_t insn, std::ostream* pos);
-	void exec_ori(uint32_t insn, std::ostream* pos);
-	void exec_andi(uint32_t insn, std::ostream* pos);
-	void exec_slli(uint32_t insn, std::ostream* pos);
-	void exec_srli(uint32_t insn, std::ostream* pos);
-	void exec_srai(uint32_t insn, std::ostream* pos);
-	void exec_add(uint32_t insn, std::ostream* pos);
-	void exec_sub(uint32_t insn, std::ostream* pos);
-	void exec_sll(uint32_t insn, std::ostream* pos);
-	void exec_slt(uint32_t insn, std::ostream* pos);
-	void exec_sltu(uint32_t insn, std::ostream* pos);
-	void exec_xor(uint32_t insn, std::ostream* pos);
-	void exec_srl(uint32_t insn, std::ostream* pos);
-	void exec_sra(uint32_t insn, std::ostream* pos);
-	void exec_or(uint32_t insn, std::ostream* pos);
-	void exec_and(uint32_t insn, std::ostream* pos);
-	void exec_fence(uint32_t insn, std::ostream* pos);
-
-	std::string render_illegal_insn() const;
-	std::string render_lui(uint32_t insn) const;
-	std::string render_auipc(uint32_t insn) const;
-	std::string render_jal(uint32_t insn) const;
-	std::string render_jalr(uint32_t insn) const;
-	std::string render_btype(uint32_t insn, const char *mnemonic) const;
-	std::string render_itype_load(uint32_t insn, const char *mnemonic) const;
-	std::string render_stype(uint32_t insn, const char *mnemonic) const;
-	std::string render_itype_alu(uint32_t insn, const char *mnemonic, int32_t imm_i) const;
-	std::string render_itype_shift(uint32_t insn, const char *mnemonic) const;
-	std::string render_rtype(uint32_t insn, const char *mnemonic) const;
-	std::string render_fence(uint32_t insn) const;
-	std::string render_ecall_ebreak(uint32_t insn) const;
+	/**
+	* @return the value of a register as 0x and XLEN/4 hex digits, for
+	* the comments of the rendered instructions.
+	***************************************************************/
+	static std::string hex0x(reg_t val)
+	{
+		return XLEN == 32 ? hex0x32(val) : hex0x64(val);
+	}
+
+	void render_illegal_insn(text_line &line) const;
+	void render_utype(text_line &line, uint32_t insn, const char *mnemonic) const;
+	void render_jal(text_line &line, uint32_t insn) const;
+	void render_jalr(text_line &line, uint32_t insn) const;
+	void render_btype(text_line &line, uint32_t insn, const char *mnemonic) const;
+	void render_itype_load(text_line &line, uint32_t insn, const char *mnemonic) const;
+	void render_stype(text_line &line, uint32_t insn, const char *mnemonic) const;
+	void render_itype_alu(text_line &line, uint32_t insn, const char *mnemonic, int32_t imm_i) const;
+	void render_itype_shift(text_line &line, uint32_t insn, const char *mnemonic) const;
+	void render_rtype(text_line &line, uint32_t insn, const char *mnemonic) const;
+	void render_unary(text_line &line, uint32_t insn, const char *mnemonic) const;
+	void render_fence(text_line &line, uint32_t insn) const;
+	void render_ecall_ebreak(text_line &line, uint32_t insn) const;
 
 	static uint32_t get_opcode(uint32_t insn);
 	static uint32_t get_rd(uint32_t insn);
@@ -96,21 +376,530 @@ public:
 	static int32_t get_imm_b(uint32_t insn);
 	static int32_t get_imm_s(uint32_t insn);
 	static int32_t get_imm_j(uint32_t insn);
+
+	/**
+	* The operations a decoded_insn can hold. kind_decode marks a
+	* slot that has not been decoded yet. The order does not matter,
+	* kind_count must stay after the single instructions. The pairs
+	* fused by the threaded engine come after it, see fuse_pair().
+	* The kinds from kind_lwu on only exist in RV64, classify() gives
+	* kind_illegal for them with XLEN 32.
+	***************************************************************/
+	enum insn_kind : uint8_t
+	{
+		kind_decode, kind_illegal, kind_ebreak, kind_ecall, kind_fence,
+		kind_lui, kind_auipc, kind_jal, kind_jalr,
+		kind_beq, kind_bne, kind_blt, kind_bge, kind_bltu, kind_bgeu,
+		kind_lb, kind_lh, kind_lw, kind_lbu, kind_lhu,
+		kind_sb, kind_sh, kind_sw,
+		kind_addi, kind_slti, kind_sltiu, kind_xori, kind_ori, kind_andi,
+		kind_slli, kind_srli, kind_srai,
+		kind_add, kind_sub, kind_sll, kind_slt, kind_sltu,
+		kind_xor, kind_srl, kind_sra, kind_or, kind_and,
+		kind_mul, kind_mulh, kind_mulhsu, kind_mulhu,
+		kind_div, kind_divu, kind_rem, kind_remu,
+		kind_sh1add, kind_sh2add, kind_sh3add,
+		kind_andn, kind_orn, kind_xnor,
+		kind_min, kind_minu, kind_max, kind_maxu,
+		kind_rol, kind_ror, kind_rori,
+		kind_clz, kind_ctz, kind_cpop, kind_sext_b, kind_sext_h, kind_zext_h,
+		kind_orc_b, kind_rev8,
+		kind_lwu, kind_ld, kind_sd,
+		kind_addiw, kind_slliw, kind_srliw, kind_sraiw,
+		kind_addw, kind_subw, kind_sllw, kind_srlw, kind_sraw,
+		kind_mulw, kind_divw, kind_divuw, kind_remw, kind_remuw,
+		kind_count,
+		kind_lui_addi = kind_count, kind_auipc_jalr,
+		kind_slt_branch, kind_sltu_branch, kind_slti_branch, kind_sltiu_branch,
+		kind_addi_branch,
+		kind_fused_end
+	};
+
+	/**
+	* The available execution engines, which execute() only picks
+	* from for a run that is not traced. A run recorded into the
+	* binary trace (-t) or into the ring of the thread that renders
+	* -i and -r goes through run_recorded(), which executes each
+	* instruction with exec_cached() whatever the engine. -i or -r
+	* without that thread are rendered inline by dcex(), like the
+	* switch engine.
+	***************************************************************/
+	enum engine_kind
+	{
+		engine_switch,		// dcex() on every fetched word
+		engine_cached,		// pre-decoded slots, one call per insn
+		engine_threaded,	// pre-decoded slots, computed goto
+		engine_block,		// chained basic-block translations
+		engine_jit		// engine_block, hot blocks compiled to x86-64 (RV32)
+	};
+
+	void set_engine(engine_kind e);
+
+	static decoded_insn predecode(uint32_t insn, uint32_t len);
+
+	/**
+	* Looks up the kind of an instruction in decode_table. Words whose
+	* two low bits are not 11 are not 32-bit instructions. The unary
+	* bit-manipulation instructions only differ in their rs2 field,
+	* they share the key of clz and are told apart by a second look up
+	* in their row of by_rs2. So do ecall and ebreak, with the key of
+	* ecall, and zext.h, orc.b and rev8, which are only themselves with
+	* one rs2. Any other kind has no row, so it costs one test.
+	*
+	* @param insn is the instruction
+	*
+	* @return the kind of the instruction, kind_illegal if it is none
+	***************************************************************/
+	static insn_kind decode_kind(uint32_t insn)
+	{
+		insn_kind k = decode_table.kind[decode_key(insn)];
+		uint32_t row = decode_table.row[k];
+		if(row != row_none)
+			k = decode_table.by_rs2[row][(insn >> 20) & 0x1f];
+		return (insn & 3) == 3 ? k : kind_illegal;
+	}
+
 private:
+	/**
+	* The encoding formats, which tell how to extract the immediate
+	* of an instruction and how to render it.
+	***************************************************************/
+	enum insn_format : uint8_t
+	{
+		format_illegal,
+		format_r,		// rd, rs1, rs2
+		format_i_alu,		// rd, rs1, imm_i
+		format_i_shift,		// rd, rs1, shamt (rs2)
+		format_unary,		// rd, rs1
+		format_i_load,		// rd, imm_i(rs1), loads and jalr
+		format_s,
+		format_b,
+		format_u,
+		format_j,
+		format_fence,
+		format_system		// ecall and ebreak
+	};
+
+	/**
+	* The mnemonic and format of an insn_kind.
+	***************************************************************/
+	struct kind_info
+	{
+		const char *mnemonic;
+		insn_format format;
+	};
+
+	static const kind_info kind_infos[kind_count];
+
+	/**
+	* The rows of kind_table::by_rs2, one for each kind whose key
+	* stands for several instructions told apart by rs2.
+	***************************************************************/
+	enum rs2_row : uint8_t
+	{
+		row_none,		// the key is the whole instruction
+		row_unary,		// clz and the rest of the unary group
+		row_system,		// ecall and ebreak
+		row_zext_h,
+		row_orc_b,
+		row_rev8,
+		row_count
+	};
+
+	/**
+	* The kind of every combination of opcode[6:2], funct3 and funct7,
+	* and of every rs2 of the unary group of clz, of the system
+	* instructions, of zext.h, of orc.b and of rev8, generated at
+	* compile time by make_decode_table() from the one classify() that
+	* knows the encodings.
+	***************************************************************/
+	static constexpr uint32_t decode_table_size = 1 << 15;
+
+	struct kind_table
+	{
+		insn_kind kind[decode_table_size];
+		uint8_t row[kind_count];		// the row of by_rs2 of a kind
+		insn_kind by_rs2[row_count][32];	// by rs2
+	};
+
+	static const kind_table decode_table;
+
+	static constexpr insn_kind classify(uint32_t opcode, uint32_t funct3, uint32_t funct7, uint32_t rs2);
+	static constexpr kind_table make_decode_table();
+
+	/**
+	* @param insn is the instruction
+	*
+	* @return the index of insn in decode_table, opcode[6:2]|funct3|funct7
+	***************************************************************/
+	static uint32_t decode_key(uint32_t insn)
+	{
+		return ((insn & 0x7c) << 8) | ((insn & 0x7000) >> 5) | (insn >> 25);
+	}
+
+	template<typename T> void run_ticks(uint64_t limit, const T &trace);
+	void exec_cached();
+	template<bool C> void run_threaded(uint64_t limit);
+	template<typename W> void run_recorded(uint64_t limit, W &w);
+	bool system_call();
+	void run_blocks(uint64_t limit);
+	translated_block *lookup_block(reg_t addr);
+	translated_block *translate_block(reg_t addr);
+	reg_t run_native(const translated_block *b);
+	jit::native_block compile_native(const translated_block *b);
+	void flush_blocks();
+
+	friend class jit;
+	static uint32_t jit_lb(rv_hart *h, uint32_t addr);
+	static uint32_t jit_lh(rv_hart *h, uint32_t addr);
+	static uint32_t jit_lw(rv_hart *h, uint32_t addr);
+	static uint32_t jit_lbu(rv_hart *h, uint32_t addr);
+	static uint32_t jit_lhu(rv_hart *h, uint32_t addr);
+	static bool jit_sb(rv_hart *h, uint32_t addr, uint32_t val);
+	static bool jit_sh(rv_hart *h, uint32_t addr, uint32_t val);
+	static bool jit_sw(rv_hart *h, uint32_t addr, uint32_t val);
+	static uint32_t jit_edge(rv_hart *h, uint32_t to, uint32_t from);
+	static uint32_t jit_div(rv_hart *h, uint32_t a, uint32_t b);
+	static uint32_t jit_divu(rv_hart *h, uint32_t a, uint32_t b);
+	static uint32_t jit_rem(rv_hart *h, uint32_t a, uint32_t b);
+	static uint32_t jit_remu(rv_hart *h, uint32_t a, uint32_t b);
+	static uint32_t jit_clz(rv_hart *h, uint32_t a);
+	static uint32_t jit_ctz(rv_hart *h, uint32_t a);
+	static uint32_t jit_cpop(rv_hart *h, uint32_t a);
+	static uint32_t jit_orc_b(rv_hart *h, uint32_t a);
+
+	/*
+	* The arithmetic of the M extension, shared by every engine. They
+	* are defined here so that they can be inlined. Division by zero
+	* and the overflow of the most negative value divided by -1 do not
+	* trap, they give the results the specification asks for. The
+	* high half of a product comes from a product twice as wide as a
+	* register, and the *w versions of RV64 work on 32 bits.
+	*/
+	typedef typename std::conditional<XLEN == 32, int64_t, int128_t>::type wide_t;
+	typedef typename std::conditional<XLEN == 32, uint64_t, uint128_t>::type uwide_t;
+
+	static sreg_t calc_mulh(sreg_t a, sreg_t b)
+	{
+		return ((wide_t)a * b) >> XLEN;
+	}
+
+	static sreg_t calc_mulhsu(sreg_t a, reg_t b)
+	{
+		return ((wide_t)a * (wide_t)b) >> XLEN;
+	}
+
+	static reg_t calc_mulhu(reg_t a, reg_t b)
+	{
+		return ((uwide_t)a * b) >> XLEN;
+	}
+
+	static sreg_t calc_div(sreg_t a, sreg_t b)
+	{
+		if(b == 0)
+			return -1;
+		if(a == std::numeric_limits<sreg_t>::min() && b == -1)
+			return a;
+		return a / b;
+	}
+
+	static reg_t calc_divu(reg_t a, reg_t b)
+	{
+		return b == 0 ? ~(reg_t)0 : a / b;
+	}
+
+	static sreg_t calc_rem(sreg_t a, sreg_t b)
+	{
+		if(b == 0)
+			return a;
+		if(a == std::numeric_limits<sreg_t>::min() && b == -1)
+			return 0;
+		return a % b;
+	}
+
+	static reg_t calc_remu(reg_t a, reg_t b)
+	{
+		return b == 0 ? a : a % b;
+	}
+
+	static int32_t calc_divw(int32_t a, int32_t b)
+	{
+		if(b == 0)
+			return -1;
+		if(a == INT32_MIN && b == -1)
+			return a;
+		return a / b;
+	}
+
+	static int32_t calc_divuw(uint32_t a, uint32_t b)
+	{
+		return b == 0 ? 0xffffffff : a / b;
+	}
+
+	static int32_t calc_remw(int32_t a, int32_t b)
+	{
+		if(b == 0)
+			return a;
+		if(a == INT32_MIN && b == -1)
+			return 0;
+		return a % b;
+	}
+
+	static int32_t calc_remuw(uint32_t a, uint32_t b)
+	{
+		return b == 0 ? a : a % b;
+	}
+
+	/*
+	* The bit manipulation of Zbb that is more than one C operator,
+	* done with the builtins of the host compiler where there is one.
+	* clz and ctz of 0 are XLEN (the builtins leave it undefined.)
+	*/
+	static reg_t calc_clz(reg_t a)
+	{
+		if(!a)
+			return XLEN;
+		return XLEN == 32 ? __builtin_clz(a) : __builtin_clzll(a);
+	}
+
+	static reg_t calc_ctz(reg_t a)
+	{
+		if(!a)
+			return XLEN;
+		return XLEN == 32 ? __builtin_ctz(a) : __builtin_ctzll(a);
+	}
+
+	static reg_t calc_cpop(reg_t a)
+	{
+		return XLEN == 32 ? __builtin_popcount(a) : __builtin_popcountll(a);
+	}
+
+	static reg_t calc_rol(reg_t a, reg_t n)
+	{
+		n &= XLEN - 1;
+		return (a << n) | (a >> ((XLEN - n) & (XLEN - 1)));
+	}
+
+	static reg_t calc_ror(reg_t a, reg_t n)
+	{
+		n &= XLEN - 1;
+		return (a >> n) | (a << ((XLEN - n) & (XLEN - 1)));
+	}
+
+	static reg_t calc_orc_b(reg_t a)
+	{
+		// bit 7 of each byte is set if any bit of the byte is
+		const reg_t low7 = (reg_t)0x7f7f7f7f7f7f7f7full;
+		reg_t t = (((a & low7) + low7) | a) & ~low7;
+		return (t >> 7) * 0xff;
+	}
+
+	static reg_t calc_rev8(reg_t a)
+	{
+		return XLEN == 32 ? __builtin_bswap32(a) : __builtin_bswap64(a);
+	}
+
+	/**
+	* Counts the edge of a taken branch or jump in the coverage map,
+	* if there is one.
+	*
+	* @param from is the address of the branch or jump
+	* @param to is the address it goes to
+	***************************************************************/
+	void note_edge(reg_t from, reg_t to)
+	{
+		if(cov_map)
+			++cov_map[coverage::edge_index(from, to)];
+	}
+
+	/**
+	* Halts execution and records why.
+	*
+	* @param r is the reason
+	***************************************************************/
+	void stop(halt_reason r)
+	{
+		halt = true;
+		halted_by = r;
+	}
+
+	/**
+	* Moves pc to the target of a conditional branch or to the next
+	* instruction, counting the edge when the branch is taken.
+	*
+	* @param taken is the outcome of the comparison
+	* @param imm is the offset of the target
+	* @param len is the length of the branch
+	***************************************************************/
+	void branch(bool taken, int32_t imm, uint32_t len)
+	{
+		if(taken)
+			note_edge(pc, pc + imm);
+		pc += taken ? (reg_t)imm : (reg_t)len;
+	}
+
+	/**
+	* @param b is a decoded conditional branch
+	*
+	* @return the outcome of its comparison
+	***************************************************************/
+	bool branch_taken(const decoded_insn &b) const
+	{
+		sreg_t x = regs.get(b.rs1);
+		sreg_t y = regs.get(b.rs2);
+
+		switch(b.kind)
+		{
+		case kind_beq:		return x == y;
+		case kind_bne:		return x != y;
+		case kind_blt:		return x < y;
+		case kind_bge:		return x >= y;
+		case kind_bltu:		return (reg_t)x < (reg_t)y;
+		default:		return (reg_t)x >= (reg_t)y;
+		}
+	}
+
+	void fuse_pair(decoded_insn *d);
+	void invalidate_icache(reg_t addr, uint64_t len);
+	void invalidate_page(reg_t addr);
+
+	static void fast_decode(rv_hart *h, const decoded_insn &d);
+	static void fast_illegal(rv_hart *h, const decoded_insn &d);
+	static void fast_ebreak(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_ecall(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_fence(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_lui(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_auipc(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_jal(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_jalr(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_beq(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_bne(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_blt(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_bge(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_bltu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_bgeu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_lb(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_lh(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_lw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_lbu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_lhu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sb(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sh(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_addi(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_slti(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sltiu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_xori(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_ori(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_andi(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_slli(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_srli(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_srai(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_add(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sub(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sll(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_slt(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sltu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_xor(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_srl(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sra(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_or(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_and(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_mul(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_mulh(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_mulhsu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_mulhu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_div(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_divu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_rem(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_remu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sh1add(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sh2add(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sh3add(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_andn(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_orn(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_xnor(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_min(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_minu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_max(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_maxu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_rol(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_ror(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_rori(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_clz(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_ctz(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_cpop(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sext_b(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sext_h(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_zext_h(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_orc_b(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_rev8(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_lwu(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_ld(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sd(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_addiw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_slliw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_srliw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sraiw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_addw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_subw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sllw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_srlw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_sraw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_mulw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_divw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_divuw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_remw(rv_hart *h, const decoded_insn &d);
+	template<uint32_t len> static void fast_remuw(rv_hart *h, const decoded_insn &d);
+
+	template<uint32_t len>
+	static void (* const fast_handlers[kind_count])(rv_hart *h, const decoded_insn &d);
+
+	word_table<decoded_insn, 1> icache;	// one slot per halfword of mem
+
+	static constexpr uint32_t max_block_insns = 256;
+
+	std::vector<translated_block *> block_list;	// all the blocks
+	word_table<translated_block *, 1> block_map;	// by start address, or nullptr
+	word_table<uint8_t, 1> block_code;	// halfwords used by any block
+	bool blocks_stale;			// a store hit a block_code halfword
+	jit *jitter;				// only with engine_jit
+	uint8_t *cov_map;			// edge counters or nullptr
+	trace_writer *trace_out;		// binary trace or nullptr
+	async_tracer<XLEN> *tracer;		// -i/-r rendering thread or nullptr
+	syscalls *sys;				// ecall emulation, or nullptr to halt
+	bool replay_syscall;			// replay(): the ecall takes replay_result
+	int64_t replay_result;
+	halt_reason halted_by;			// halt_none while running
+	uint32_t exit_status;			// the status given to exit
+
 	memory * mem;
-	uint32_t pc;
-	static constexpr uint32_t XLEN = 32;
+	reg_t pc;
+	reg_t entry;				// pc after reset()
 
-	registerfile regs;
+	registerfile<XLEN> regs;
 
 	bool halt;
 	bool show_instructions;
 	bool show_registers;
+	bool compressed;			// the C extension is enabled
+	uint32_t insn_len;			// of the insn given to dcex(), set by fetch()
+	std::ostream *out;			// where -d and -i go, or nullptr
+	std::ostream *dump_out;			// where -r and dump() go, or nullptr
 	uint64_t insn_counter;
 
+	registerfile<XLEN> snap_regs;		// the hart at snapshot()
+	reg_t snap_pc;
+	uint64_t snap_insn_counter;
+	engine_kind engine;
+
 	static constexpr int mnemonic_width = 8;
 	static constexpr int instruction_width = 35;
 
+	static constexpr uint32_t render_cache_bits = 11;
+	static constexpr uint32_t render_cache_size = 1 << render_cache_bits;
+	mutable std::vector<rendered_insn> render_cache;	// by insn, or insn and pc
+
 	static constexpr uint32_t opcode_lui   = 0b0110111;
 	static constexpr uint32_t opcode_auipc = 0b0010111;
 	static constexpr uint32_t opcode_jal   = 0b1101111;
@@ -120,6 +909,8 @@ private:
 	static constexpr uint32_t opcode_stype   = 0b0100011;
 	static constexpr uint32_t opcode_itype  = 0b0010011;
 	static constexpr uint32_t opcode_rtype  = 0b0110011;
+	static constexpr uint32_t opcode_itype32 = 0b0011011;	// RV64 addiw, slliw..sraiw
+	static constexpr uint32_t opcode_rtype32 = 0b0111011;	// RV64 addw..sraw, mulw..remuw
 	static constexpr uint32_t opcode_fence  = 0b0001111;
 	static constexpr uint32_t opcode_ecall_ebreak  = 0b1110011;
 
@@ -137,6 +928,8 @@ private:
 	static constexpr uint32_t funct3_lw  = 0b010;
 	static constexpr uint32_t funct3_lbu = 0b100;
 	static constexpr uint32_t funct3_lhu = 0b101;
+	static constexpr uint32_t funct3_lwu = 0b110;
+	static constexpr uint32_t funct3_ld  = 0b011;
 
 	static constexpr uint32_t funct3_addi  = 0b000;
 	static constexpr uint32_t funct3_slti  = 0b010;
@@ -150,6 +943,7 @@ private:
 	static constexpr uint32_t funct3_sb  = 0b000;
 	static constexpr uint32_t funct3_sh  = 0b001;
 	static constexpr uint32_t funct3_sw  = 0b010;
+	static constexpr uint32_t funct3_sd  = 0b011;
 
 	static constexpr uint32_t funct3_beq  = 0b000;
 	static constexpr uint32_t funct3_bne  = 0b001;
@@ -160,4 +954,55 @@ private:
 
 	static constexpr uint32_t funct7_add  = 0b0000000;
 	static constexpr uint32_t funct7_sub  = 0b0100000;
+	static constexpr uint32_t funct7_muldiv = 0b0000001;
+
+	static constexpr uint32_t funct3_mul    = 0b000;
+	static constexpr uint32_t funct3_mulh   = 0b001;
+	static constexpr uint32_t funct3_mulhsu = 0b010;
+	static constexpr uint32_t funct3_mulhu  = 0b011;
+	static constexpr uint32_t funct3_div    = 0b100;
+	static constexpr uint32_t funct3_divu   = 0b101;
+	static constexpr uint32_t funct3_rem    = 0b110;
+	static constexpr uint32_t funct3_remu   = 0b111;
+
+	static constexpr uint32_t funct7_shadd  = 0b0010000;	// sh1add..sh3add
+	static constexpr uint32_t funct7_minmax = 0b0000101;
+	static constexpr uint32_t funct7_rotate = 0b0110000;	// rol, ror, rori and the unary group
+	static constexpr uint32_t funct7_zexth  = 0b0000100;
+	static constexpr uint32_t funct7_orcb   = 0b0010100;
+	static constexpr uint32_t funct7_rev8   = XLEN == 32 ? 0b0110100 : 0b0110101;
+	static constexpr uint32_t funct7_shamt5 = 0b0000001;	// shamt[5] of the RV64 shifts
+
+	static constexpr uint32_t funct3_sh1add = 0b010;
+	static constexpr uint32_t funct3_sh2add = 0b100;
+	static constexpr uint32_t funct3_sh3add = 0b110;
+	static constexpr uint32_t funct3_andn   = 0b111;
+	static constexpr uint32_t funct3_orn    = 0b110;
+	static constexpr uint32_t funct3_xnor   = 0b100;
+	static constexpr uint32_t funct3_min    = 0b100;
+	static constexpr uint32_t funct3_minu   = 0b101;
+	static constexpr uint32_t funct3_max    = 0b110;
+	static constexpr uint32_t funct3_maxu   = 0b111;
+	static constexpr uint32_t funct3_rol    = 0b001;
+	static constexpr uint32_t funct3_ror    = 0b101;
+	static constexpr uint32_t funct3_zexth  = 0b100;
+
+	static constexpr uint32_t rs2_clz    = 0b00000;	// the unary group, funct7_rotate and funct3_slli
+	static constexpr uint32_t rs2_ctz    = 0b00001;
+	static constexpr uint32_t rs2_cpop   = 0b00010;
+	static constexpr uint32_t rs2_sextb  = 0b00100;
+	static constexpr uint32_t rs2_sexth  = 0b00101;
+	static constexpr uint32_t rs2_orcb   = 0b00111;	// funct7_orcb and funct3_srli
+	static constexpr uint32_t rs2_rev8   = 0b11000;	// funct7_rev8 and funct3_srli
+	static constexpr uint32_t rs2_any    = 32;		// not a field value, see make_decode_table()
 };
+
+template<> uint32_t rv32i::run_native(const translated_block *b);
+template<> uint64_t rv64i::run_native(const translated_block *b);
+template<> jit::native_block rv32i::compile_native(const translated_block *b);
+template<> jit::native_block rv64i::compile_native(const translated_block *b);
+
+extern template class rv_hart<32>;
+extern template class rv_hart<64>;
+
+#endif
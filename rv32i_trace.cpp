@@ -0,0 +1,74 @@
+#include "rv32i.h"
+#include "trace.h"
+#include "sink.h"
+#include <stdlib.h>
+#include <iostream>
+#include <unistd.h>
+
+/**
+ * Prints the usage for the program and terminates the program
+ *********************************************************************/
+static void usage()
+{
+	std::cerr << "Usage: rv32i-trace [-r] tracefile" << std::endl;
+	std::cerr << "     -r show a dump of the hart status before each exec" << std::endl;
+	exit(1);
+}
+
+/**
+ * Replays the trace on a hart of the width it was written with.
+ *
+ * @param trace is the trace, its header already read.
+ * @param mem is the memory of the hart.
+ * @param r_is_on tells to dump the hart status before each instruction.
+ *
+ * @return false if the trace is cut short.
+ ********************************************************************/
+template<uint32_t XLEN>
+static bool replay(trace_reader &trace, memory &mem, bool r_is_on)
+{
+	rv_hart<XLEN> sim(&mem);
+	sim.set_entry(trace.get_entry());
+	sim.set_compressed(trace.is_compressed());
+	sim.set_show_instructions(true);
+	sim.set_show_registers(r_is_on);
+	return sim.replay(trace);
+}
+
+/**
+ * Read a binary trace written by rv32i -t and print it the way
+ * rv32i -i (or -ir) would have printed the traced run.
+ ********************************************************************/
+int main(int argc, char **argv)
+{
+	bool r_is_on = false;		// show a dump of the hart status before each instruction.
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r")) != -1)
+	{
+		switch (opt)
+		{
+		case 'r':
+			r_is_on = true;
+			break;
+		default: /* '?' */
+			usage();
+		}
+	}
+
+	if (optind >= argc)
+		usage();
+
+	trace_reader trace;
+	if (!trace.open(argv[optind]))
+		usage();
+
+	// std::cout goes through the sink of stdout from here on
+	sink_table sinks;
+
+	// only the pages the trace touches are allocated
+	memory mem(trace.get_mem_size(), true);
+
+	bool ok = trace.is_rv64() ? replay<64>(trace, mem, r_is_on) : replay<32>(trace, mem, r_is_on);
+	return sinks.flush() && ok ? 0 : 1;
+}
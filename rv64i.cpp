@@ -0,0 +1,7 @@
+/*
+* The RV64I hart: the same code as the RV32I one in rv32i.cpp,
+* instantiated in a translation unit of its own (see RV_HART_XLEN
+* there.)
+*/
+#define RV_HART_XLEN 64
+#include "rv32i.cpp"
@@ -0,0 +1,220 @@
+#include "sink.h"
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+* Creates a sink writing to fd, flushed only when its buffer is full.
+*
+* @param name is the name of the destination, for the error message.
+* @param fd is the file descriptor to write to.
+* @param owned closes fd when the sink goes away.
+***********************************************************************/
+sink::sink(const std::string &name, int fd, bool owned)
+	: name(name), fd(fd), owned(owned), failed(false), policy(flush_full), os(this)
+{
+	buffer.reserve(buffer_size);
+}
+
+/**
+* Writes out what is left in the buffer.
+***********************************************************************/
+sink::~sink()
+{
+	flush();
+	if(owned)
+		close(fd);
+}
+
+/**
+* Mutator for the flush policy.
+*
+* @param p is the policy.
+***********************************************************************/
+void sink::set_flush_policy(flush_policy p)
+{
+	policy = p;
+}
+
+/**
+* Writes out the buffer.
+*
+* @return false if a write to the destination has failed.
+***********************************************************************/
+bool sink::flush()
+{
+	if(!buffer.empty())
+		write_out(buffer.data(), buffer.size());
+	buffer.clear();
+	return !failed;
+}
+
+/**
+* Appends one character, the way std::ostream puts single characters
+* and numbers. There is no put area, so every character comes here.
+*
+* @param c is the character.
+*
+* @return c, or eof if the sink has failed.
+***********************************************************************/
+sink::int_type sink::overflow(int_type c)
+{
+	if(traits_type::eq_int_type(c, traits_type::eof()))
+		return traits_type::not_eof(c);
+
+	if(buffer.size() == buffer_size)
+		flush();
+	buffer.push_back(traits_type::to_char_type(c));
+	if(policy == flush_line && c == '\n')
+		flush();
+	return failed ? traits_type::eof() : c;
+}
+
+/**
+* Appends n characters. Text longer than the buffer is written straight
+* through once the buffer is out.
+*
+* @param s are the characters.
+* @param n is the number of characters.
+*
+* @return n, or 0 if the sink has failed.
+***********************************************************************/
+std::streamsize sink::xsputn(const char *s, std::streamsize n)
+{
+	size_t len = n;
+
+	if(buffer.size() + len > buffer_size)
+	{
+		flush();
+		if(len >= buffer_size)
+		{
+			write_out(s, len);
+			return failed ? 0 : n;
+		}
+	}
+	buffer.insert(buffer.end(), s, s + len);
+	if(policy == flush_line && memchr(s, '\n', len))
+		flush();
+	return failed ? 0 : n;
+}
+
+/**
+* Called by std::ostream::flush() and std::endl.
+*
+* @return 0, or -1 if the sink has failed.
+***********************************************************************/
+int sink::sync()
+{
+	return flush() ? 0 : -1;
+}
+
+/**
+* Writes n characters to the file descriptor. The first failure is
+* reported on stderr and everything after it is dropped.
+*
+* @param s are the characters.
+* @param n is the number of characters.
+*
+* @return false if the sink has failed.
+***********************************************************************/
+bool sink::write_out(const char *s, size_t n)
+{
+	while(n && !failed)
+	{
+		ssize_t w = write(fd, s, n);
+		if(w < 0 && errno == EINTR)
+			continue;
+		if(w <= 0)
+		{
+			// failed first: std::cerr flushes std::cout, maybe into this sink
+			failed = true;
+			std::cerr << "Can\'t write to file \'" << name << "\'.\n";
+			break;
+		}
+		s += w;
+		n -= w;
+	}
+	return !failed;
+}
+
+/**
+* Creates the sink of standard output and sends std::cout into it.
+***********************************************************************/
+sink_table::sink_table()
+{
+	std::cout.flush();
+
+	sink *out = new sink("-", STDOUT_FILENO, false);
+	if(isatty(STDOUT_FILENO))
+		out->set_flush_policy(sink::flush_line);
+	sinks["-"].reset(out);
+
+	cout_buf = std::cout.rdbuf(out);
+}
+
+/**
+* Gives std::cout its own buffer back. The sinks write out what is left
+* in theirs as they go away.
+***********************************************************************/
+sink_table::~sink_table()
+{
+	std::cout.rdbuf(cout_buf);
+}
+
+/**
+* Finds the stream of a destination, creating (or truncating) the file
+* the first time it is named.
+*
+* @param fname is the name of the file, "-" for standard output or ""
+* to discard the stream.
+* @param os is set to the stream, or nullptr if it is discarded.
+*
+* @return false if the file can not be created.
+***********************************************************************/
+bool sink_table::open(const std::string &fname, std::ostream *&os)
+{
+	os = nullptr;
+	if(fname.empty())
+		return true;
+
+	auto it = sinks.find(fname);
+	if(it == sinks.end())
+	{
+		int fd = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		if(fd < 0)
+		{
+			std::cerr << "Can\'t open file \'" << fname << "\' for writing.\n";
+			return false;
+		}
+		it = sinks.emplace(fname, std::unique_ptr<sink>(new sink(fname, fd, true))).first;
+	}
+	os = &it->second->stream();
+	return true;
+}
+
+/**
+* Sets the flush policy of every sink opened so far.
+*
+* @param p is the policy.
+***********************************************************************/
+void sink_table::set_flush_policy(sink::flush_policy p)
+{
+	for(auto &s : sinks)
+		s.second->set_flush_policy(p);
+}
+
+/**
+* Writes out the buffers of all the sinks.
+*
+* @return false if a write to any of them has failed.
+***********************************************************************/
+bool sink_table::flush()
+{
+	bool ok = true;
+	for(auto &s : sinks)
+		ok = s.second->flush() && ok;
+	return ok;
+}
@@ -0,0 +1,92 @@
+#ifndef sink_H
+#define sink_H
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+/*
+* The documentation of most of the functions is included in the .cpp file.
+*/
+
+/**
+* An output stream that writes to a file descriptor through a large
+* buffer of its own. Nothing is written until the buffer is full, the
+* sink is flushed or (with flush_line) a line is finished, so a whole
+* run usually takes a handful of write() calls however many lines it
+* prints.
+***********************************************************************/
+class sink : public std::streambuf
+{
+public:
+	enum flush_policy
+	{
+		flush_full,	// write when the buffer is full and at flush()
+		flush_line	// also write at the end of every line
+	};
+
+	sink(const std::string &name, int fd, bool owned);
+	~sink();
+
+	/**
+	* @return the stream that writes into the sink.
+	***************************************************************/
+	std::ostream &stream()
+	{
+		return os;
+	}
+
+	void set_flush_policy(flush_policy p);
+	bool flush();
+
+protected:
+	int_type overflow(int_type c) override;
+	std::streamsize xsputn(const char *s, std::streamsize n) override;
+	int sync() override;
+
+private:
+	sink(const sink &) = delete;
+	sink &operator=(const sink &) = delete;
+
+	bool write_out(const char *s, size_t n);
+
+	static constexpr size_t buffer_size = 1 << 20;
+
+	std::string name;		// for the error message
+	int fd;
+	bool owned;			// fd is closed with the sink
+	bool failed;			// a write failed, the rest is dropped
+	flush_policy policy;
+	std::vector<char> buffer;
+	std::ostream os;
+};
+
+/**
+* The sinks of a program, one per destination, so that the streams sent
+* to the same file share its buffer and stay in order. Standard output
+* is the sink named "-", std::cout is sent into it for as long as the
+* table lives. It is line flushed when it is a terminal.
+***********************************************************************/
+class sink_table
+{
+public:
+	sink_table();
+	~sink_table();
+
+	bool open(const std::string &fname, std::ostream *&os);
+	void set_flush_policy(sink::flush_policy p);
+	bool flush();
+
+private:
+	sink_table(const sink_table &) = delete;
+	sink_table &operator=(const sink_table &) = delete;
+
+	std::map<std::string, std::unique_ptr<sink>> sinks;	// by file name
+	std::streambuf *cout_buf;	// the buffer of std::cout before
+};
+
+#endif
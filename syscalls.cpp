@@ -0,0 +1,518 @@
+#include "syscalls.h"
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+* The open() flags of the guest, those of the generic Linux ABI that
+* RISC-V uses. They are translated one by one so that the host may
+* number its own flags any way it likes.
+*/
+static constexpr uint32_t guest_o_accmode = 03;
+static constexpr uint32_t guest_o_creat = 0100;
+static constexpr uint32_t guest_o_excl = 0200;
+static constexpr uint32_t guest_o_noctty = 0400;
+static constexpr uint32_t guest_o_trunc = 01000;
+static constexpr uint32_t guest_o_append = 02000;
+static constexpr uint32_t guest_o_nonblock = 04000;
+static constexpr uint32_t guest_o_directory = 0200000;
+static constexpr uint32_t guest_o_nofollow = 0400000;
+static constexpr int32_t guest_at_fdcwd = -100;
+
+static constexpr uint32_t guest_stat_size = 128;	// newlib's struct kernel_stat
+
+/**
+* Stores val in little-endian order at p.
+*
+* @param p is where to store it.
+* @param val is the value.
+* @param bytes is the size of the value.
+***********************************************************************/
+static void put_le(uint8_t *p, uint64_t val, int bytes)
+{
+	for(int i = 0; i < bytes; ++i)
+		p[i] = val >> (8*i);
+}
+
+/**
+* Maps the guest file descriptors 0-2 to those of the simulator and
+* puts the break at the first page after the program.
+*
+* @param m is the memory of the hart.
+* @param image_end is the address after the end of the loaded program.
+* @param is_rv64 tells that the guest is RV64.
+***********************************************************************/
+syscalls::syscalls(memory *m, uint64_t image_end, bool is_rv64)
+	: mem(m), fds{ 0, 1, 2 }, rv64(is_rv64)
+{
+	uint64_t start = (image_end + 0xfff) & ~(uint64_t)0xfff;
+	if(start > mem->get_size())
+		start = mem->get_size();
+	brk_start = start;
+	brk_end = start;
+	snap_brk_end = start;
+}
+
+/**
+* Closes the files the guest left open.
+***********************************************************************/
+syscalls::~syscalls()
+{
+	for(int fd : fds)
+		if(fd > 2)
+			close(fd);
+}
+
+/**
+* Runs one system call.
+*
+* @param number is the number of the call (a7).
+* @param args are its six arguments (a0-a5).
+* @param written_addr is set to the first guest address the call wrote.
+* @param written_len is set to the number of bytes it wrote, 0 if none,
+* so that the hart can forget the code it may have overwritten.
+*
+* @return the result for a0: a value, or a negated errno.
+***********************************************************************/
+int64_t syscalls::call(uint32_t number, const uint64_t *args, uint64_t &written_addr, uint64_t &written_len)
+{
+	int64_t ret;
+	bool time64;
+
+	written_addr = 0;
+	written_len = 0;
+
+	switch(number)
+	{
+	default:
+		return -ENOSYS;
+
+	case sys_openat:
+		return do_openat(args[0], args[1], args[2], args[3]);
+
+	case sys_close:
+		return do_close(args[0]);
+
+	case sys_lseek:
+		return do_lseek(args[0], signed_arg(args[1]), args[2]);
+
+	case sys_read:
+		ret = do_read(args[0], args[1], args[2]);
+		if(ret > 0)
+		{
+			written_addr = args[1];
+			written_len = ret;
+		}
+		return ret;
+
+	case sys_write:
+		return do_write(args[0], args[1], args[2]);
+
+	case sys_fstat:
+		ret = do_fstat(args[0], args[1]);
+		if(ret == 0)
+		{
+			written_addr = args[1];
+			written_len = guest_stat_size;
+		}
+		return ret;
+
+	case sys_exit:
+	case sys_exit_group:
+		return 0;		// the hart halts, see is_exit()
+
+	case sys_clock_gettime:
+	case sys_clock_gettime64:
+		time64 = rv64 || number == sys_clock_gettime64;
+		ret = do_clock_gettime(args[0], args[1], time64);
+		if(ret == 0)
+		{
+			written_addr = args[1];
+			written_len = time64 ? 16 : 8;
+		}
+		return ret;
+
+	case sys_brk:
+		return do_brk(args[0], written_addr, written_len);
+	}
+}
+
+/**
+* Saves the break, so that restore() can put it back. Open files are
+* not part of the snapshot.
+***********************************************************************/
+void syscalls::snapshot()
+{
+	snap_brk_end = brk_end;
+}
+
+/**
+* Puts the break back where it was at snapshot(). The memory above it
+* is restored with the rest of the memory.
+***********************************************************************/
+void syscalls::restore()
+{
+	brk_end = snap_brk_end;
+}
+
+/**
+* @param number is the number of a system call.
+*
+* @return true if the call ends the program.
+***********************************************************************/
+bool syscalls::is_exit(uint32_t number)
+{
+	return number == sys_exit || number == sys_exit_group;
+}
+
+/**
+* @param number is the number of a system call.
+*
+* @return its name, for the text of -i.
+***********************************************************************/
+const char *syscalls::name(uint32_t number)
+{
+	switch(number)
+	{
+	default:			return "unknown";
+	case sys_openat:		return "openat";
+	case sys_close:			return "close";
+	case sys_lseek:			return "lseek";
+	case sys_read:			return "read";
+	case sys_write:			return "write";
+	case sys_fstat:			return "fstat";
+	case sys_exit:			return "exit";
+	case sys_exit_group:		return "exit_group";
+	case sys_clock_gettime:		return "clock_gettime";
+	case sys_brk:			return "brk";
+	case sys_clock_gettime64:	return "clock_gettime64";
+	}
+}
+
+/**
+* Opens a file for the guest, in the lowest free guest descriptor.
+*
+* @param dirfd is the directory a relative path starts from, or
+* AT_FDCWD.
+* @param path is the guest address of the NUL-terminated path.
+* @param flags are the open() flags of the guest.
+* @param mode is the mode of a created file.
+*
+* @return the guest descriptor, or a negated errno.
+***********************************************************************/
+int64_t syscalls::do_openat(int32_t dirfd, uint64_t path, uint32_t flags, uint32_t mode)
+{
+	int hdir = AT_FDCWD;
+	if(dirfd != guest_at_fdcwd && (hdir = host_fd(dirfd)) < 0)
+		return -EBADF;
+
+	if(path >= mem->get_size())
+		return -EFAULT;
+	uint32_t len = std::min<uint64_t>(max_path, mem->get_size() - path);
+	char name[max_path];
+	mem->get_block(path, reinterpret_cast<uint8_t *>(name), len);
+	if(!memchr(name, 0, len))
+		return len == max_path ? -ENAMETOOLONG : -EFAULT;
+
+	int hflags = 0;
+	switch(flags & guest_o_accmode)
+	{
+	case 0:		hflags = O_RDONLY; break;
+	case 1:		hflags = O_WRONLY; break;
+	default:	hflags = O_RDWR; break;
+	}
+	if(flags & guest_o_creat)	hflags |= O_CREAT;
+	if(flags & guest_o_excl)	hflags |= O_EXCL;
+	if(flags & guest_o_noctty)	hflags |= O_NOCTTY;
+	if(flags & guest_o_trunc)	hflags |= O_TRUNC;
+	if(flags & guest_o_append)	hflags |= O_APPEND;
+	if(flags & guest_o_nonblock)	hflags |= O_NONBLOCK;
+	if(flags & guest_o_directory)	hflags |= O_DIRECTORY;
+	if(flags & guest_o_nofollow)	hflags |= O_NOFOLLOW;
+
+	int fd = openat(hdir, name, hflags | O_CLOEXEC, mode);
+	if(fd < 0)
+		return -errno;
+
+	for(size_t i = 0; i < fds.size(); ++i)
+	{
+		if(fds[i] < 0)
+		{
+			fds[i] = fd;
+			return i;
+		}
+	}
+	fds.push_back(fd);
+	return fds.size() - 1;
+}
+
+/**
+* Closes a guest descriptor. The host descriptors 0-2 stay open, the
+* simulator still writes to them.
+*
+* @param fd is the guest descriptor.
+*
+* @return 0 or a negated errno.
+***********************************************************************/
+int64_t syscalls::do_close(int32_t fd)
+{
+	int h = host_fd(fd);
+	if(h < 0)
+		return -EBADF;
+	fds[fd] = -1;
+	if(h > 2 && close(h) != 0)
+		return -errno;
+	return 0;
+}
+
+/**
+* Moves the offset of a guest descriptor.
+*
+* @param fd is the guest descriptor.
+* @param offset is the signed offset.
+* @param whence is SEEK_SET, SEEK_CUR or SEEK_END (0, 1 or 2.)
+*
+* @return the new offset, or a negated errno.
+***********************************************************************/
+int64_t syscalls::do_lseek(int32_t fd, int64_t offset, uint64_t whence)
+{
+	int h = host_fd(fd);
+	if(h < 0)
+		return -EBADF;
+	if(whence > 2)
+		return -EINVAL;
+
+	off_t pos = lseek(h, offset, whence == 0 ? SEEK_SET : whence == 1 ? SEEK_CUR : SEEK_END);
+	if(pos < 0)
+		return -errno;
+	if(!rv64 && pos > INT32_MAX)
+		return -EOVERFLOW;
+	return pos;
+}
+
+/**
+* Reads from a guest descriptor straight into the guest memory: in
+* place with the flat memory, through the bounce buffer with the
+* sparse one, stopping at the first short read.
+*
+* @param fd is the guest descriptor.
+* @param buf is the guest address of the buffer.
+* @param count is the size of the buffer.
+*
+* @return the number of bytes read, or a negated errno.
+***********************************************************************/
+int64_t syscalls::do_read(int32_t fd, uint64_t buf, uint64_t count)
+{
+	int h = host_fd(fd);
+	if(h < 0)
+		return -EBADF;
+	if(!in_memory(buf, count))
+		return -EFAULT;
+	count = std::min<uint64_t>(count, INT32_MAX);
+
+	uint8_t *p = mem->write_span(buf, count);
+	if(p)
+	{
+		ssize_t n;
+		while((n = read(h, p, count)) < 0 && errno == EINTR)
+			;
+		return n < 0 ? -errno : n;
+	}
+
+	bounce.resize(bounce_size);
+	uint32_t done = 0;
+	while(done < count)
+	{
+		uint32_t want = std::min<uint64_t>(count - done, bounce_size);
+		ssize_t n;
+		while((n = read(h, bounce.data(), want)) < 0 && errno == EINTR)
+			;
+		if(n < 0)
+			return done ? done : -errno;
+		mem->set_block(buf + done, bounce.data(), n);
+		done += n;
+		if((uint32_t)n < want)
+			break;
+	}
+	return done;
+}
+
+/**
+* Writes guest memory to a guest descriptor: in place with the flat
+* memory, through the bounce buffer with the sparse one, stopping at
+* the first short write.
+*
+* @param fd is the guest descriptor.
+* @param buf is the guest address of the data.
+* @param count is the number of bytes.
+*
+* @return the number of bytes written, or a negated errno.
+***********************************************************************/
+int64_t syscalls::do_write(int32_t fd, uint64_t buf, uint64_t count)
+{
+	int h = host_fd(fd);
+	if(h < 0)
+		return -EBADF;
+	if(!in_memory(buf, count))
+		return -EFAULT;
+	count = std::min<uint64_t>(count, INT32_MAX);
+
+	const uint8_t *p = mem->read_span(buf, count);
+	if(p)
+	{
+		ssize_t n;
+		while((n = write(h, p, count)) < 0 && errno == EINTR)
+			;
+		return n < 0 ? -errno : n;
+	}
+
+	bounce.resize(bounce_size);
+	uint32_t done = 0;
+	while(done < count)
+	{
+		uint32_t want = std::min<uint64_t>(count - done, bounce_size);
+		mem->get_block(buf + done, bounce.data(), want);
+		ssize_t n;
+		while((n = write(h, bounce.data(), want)) < 0 && errno == EINTR)
+			;
+		if(n < 0)
+			return done ? done : -errno;
+		done += n;
+		if((uint32_t)n < want)
+			break;
+	}
+	return done;
+}
+
+/**
+* Stores the status of a guest descriptor in the layout of newlib's
+* struct kernel_stat (the generic Linux stat with 64-bit times.)
+*
+* @param fd is the guest descriptor.
+* @param buf is the guest address of the structure.
+*
+* @return 0 or a negated errno.
+***********************************************************************/
+int64_t syscalls::do_fstat(int32_t fd, uint64_t buf)
+{
+	int h = host_fd(fd);
+	if(h < 0)
+		return -EBADF;
+	if(!in_memory(buf, guest_stat_size))
+		return -EFAULT;
+
+	struct stat st;
+	if(fstat(h, &st) != 0)
+		return -errno;
+
+	uint8_t s[guest_stat_size] = {};
+	put_le(s + 0, st.st_dev, 8);
+	put_le(s + 8, st.st_ino, 8);
+	put_le(s + 16, st.st_mode, 4);
+	put_le(s + 20, st.st_nlink, 4);
+	put_le(s + 24, st.st_uid, 4);
+	put_le(s + 28, st.st_gid, 4);
+	put_le(s + 32, st.st_rdev, 8);
+	put_le(s + 48, st.st_size, 8);
+	put_le(s + 56, st.st_blksize, 4);
+	put_le(s + 64, st.st_blocks, 8);
+	put_le(s + 72, st.st_atim.tv_sec, 8);
+	put_le(s + 80, st.st_atim.tv_nsec, 4);
+	put_le(s + 88, st.st_mtim.tv_sec, 8);
+	put_le(s + 96, st.st_mtim.tv_nsec, 4);
+	put_le(s + 104, st.st_ctim.tv_sec, 8);
+	put_le(s + 112, st.st_ctim.tv_nsec, 4);
+	mem->set_block(buf, s, guest_stat_size);
+	return 0;
+}
+
+/**
+* Reads a host clock into a guest struct timespec: two 32-bit words,
+* or a 64-bit tv_sec, a 32-bit tv_nsec and padding with time64 (the
+* 64-bit tv_nsec of RV64 in little-endian order.)
+*
+* @param clock is the clock id, the same on the host.
+* @param buf is the guest address of the structure.
+* @param time64 selects the 64-bit layout (clock_gettime64 or RV64.)
+*
+* @return 0 or a negated errno.
+***********************************************************************/
+int64_t syscalls::do_clock_gettime(uint32_t clock, uint64_t buf, bool time64)
+{
+	uint32_t len = time64 ? 16 : 8;
+	if(!in_memory(buf, len))
+		return -EFAULT;
+
+	struct timespec ts;
+	if(clock_gettime(clock, &ts) != 0)
+		return -errno;
+
+	uint8_t s[16] = {};
+	if(time64)
+	{
+		put_le(s, ts.tv_sec, 8);
+		put_le(s + 8, ts.tv_nsec, 4);
+	}
+	else
+	{
+		put_le(s, ts.tv_sec, 4);
+		put_le(s + 4, ts.tv_nsec, 4);
+	}
+	mem->set_block(buf, s, len);
+	return 0;
+}
+
+/**
+* Moves the break like Linux: an address below the end of the program
+* or past the memory leaves it where it is (brk(0) just asks for it.)
+* The memory the break grows over is zeroed, as newlib's malloc
+* expects of fresh memory.
+*
+* @param addr is the new break.
+* @param written_addr is set to the start of the zeroed memory.
+* @param written_len is set to its length.
+*
+* @return the break.
+***********************************************************************/
+int64_t syscalls::do_brk(uint64_t addr, uint64_t &written_addr, uint64_t &written_len)
+{
+	if(addr < brk_start || addr > mem->get_size())
+		return brk_end;
+
+	if(addr > brk_end)
+	{
+		mem->zero_block(brk_end, addr - brk_end);
+		written_addr = brk_end;
+		written_len = addr - brk_end;
+	}
+	brk_end = addr;
+	return brk_end;
+}
+
+/**
+* @param fd is a guest descriptor.
+*
+* @return the host descriptor, or -1 if fd is not open.
+***********************************************************************/
+int syscalls::host_fd(int32_t fd) const
+{
+	if(fd < 0 || (size_t)fd >= fds.size())
+		return -1;
+	return fds[fd];
+}
+
+/**
+* @param addr is a guest address.
+* @param len is a number of bytes.
+*
+* @return true if the len bytes at addr are all in the memory.
+***********************************************************************/
+bool syscalls::in_memory(uint64_t addr, uint64_t len) const
+{
+	return addr <= mem->get_size() && len <= mem->get_size() - addr;
+}
@@ -0,0 +1,85 @@
+#ifndef syscalls_H
+#define syscalls_H
+
+#include <cstdint>
+#include <vector>
+#include "memory.h"
+
+/*
+* The documentation of most of the functions is included in the .cpp file.
+*/
+
+/**
+* Emulates the system calls a program built with newlib (or for Linux)
+* makes with ecall: the number in a7, the arguments in a0-a5 and the
+* result, or a negated Linux errno, back in a0. The guest file
+* descriptors are mapped to host ones, 0-2 being those of the
+* simulator. An RV64 guest passes 64-bit arguments and gets the 64-bit
+* struct timespec from clock_gettime. Guest buffers are handed to the
+* host read() and write() in place when the memory is flat, and through
+* a bounce buffer a page range at a time when it is sparse, never a byte
+* at a time.
+***********************************************************************/
+class syscalls
+{
+public:
+	static constexpr uint32_t sys_openat = 56;
+	static constexpr uint32_t sys_close = 57;
+	static constexpr uint32_t sys_lseek = 62;
+	static constexpr uint32_t sys_read = 63;
+	static constexpr uint32_t sys_write = 64;
+	static constexpr uint32_t sys_fstat = 80;
+	static constexpr uint32_t sys_exit = 93;
+	static constexpr uint32_t sys_exit_group = 94;
+	static constexpr uint32_t sys_clock_gettime = 113;
+	static constexpr uint32_t sys_brk = 214;
+	static constexpr uint32_t sys_clock_gettime64 = 403;
+
+	syscalls(memory *m, uint64_t image_end, bool is_rv64);
+	~syscalls();
+
+	int64_t call(uint32_t number, const uint64_t *args, uint64_t &written_addr, uint64_t &written_len);
+
+	void snapshot();
+	void restore();
+
+	static bool is_exit(uint32_t number);
+	static const char *name(uint32_t number);
+
+private:
+	syscalls(const syscalls &) = delete;
+	syscalls &operator=(const syscalls &) = delete;
+
+	int64_t do_openat(int32_t dirfd, uint64_t path, uint32_t flags, uint32_t mode);
+	int64_t do_close(int32_t fd);
+	int64_t do_lseek(int32_t fd, int64_t offset, uint64_t whence);
+	int64_t do_read(int32_t fd, uint64_t buf, uint64_t count);
+	int64_t do_write(int32_t fd, uint64_t buf, uint64_t count);
+	int64_t do_fstat(int32_t fd, uint64_t buf);
+	int64_t do_clock_gettime(uint32_t clock, uint64_t buf, bool time64);
+	int64_t do_brk(uint64_t addr, uint64_t &written_addr, uint64_t &written_len);
+
+	int host_fd(int32_t fd) const;
+	bool in_memory(uint64_t addr, uint64_t len) const;
+
+	/**
+	* @return a signed argument, sign-extended from 32 bits on RV32.
+	***************************************************************/
+	int64_t signed_arg(uint64_t arg) const
+	{
+		return rv64 ? (int64_t)arg : (int32_t)arg;
+	}
+
+	static constexpr uint32_t bounce_size = 1 << 16;	// sparse memory chunks
+	static constexpr uint32_t max_path = 4096;
+
+	memory *mem;
+	std::vector<int> fds;		// host fd of every guest fd, or -1
+	bool rv64;			// the guest is RV64
+	uint64_t brk_start;		// the lowest break, the end of the program
+	uint64_t brk_end;		// the current break
+	uint64_t snap_brk_end;		// brk_end at snapshot()
+	std::vector<uint8_t> bounce;
+};
+
+#endif
@@ -0,0 +1,316 @@
+#include "trace.h"
+#include <cstdint>
+#include <iostream>
+
+static const char trace_magic[8] = { 'R', 'V', '3', '2', 'T', 'R', 'C', '4' };
+
+/**
+* Flushes what is left in the buffer.
+***********************************************************************/
+trace_writer::~trace_writer()
+{
+	if(out.is_open())
+		flush();
+}
+
+/**
+* Creates the trace file and writes its header.
+*
+* @param fname is the name of the file.
+* @param mem_size is the size of the simulated memory.
+* @param entry is the address execution starts at.
+* @param compressed tells that the C extension is on.
+* @param is_rv64 tells that the hart is RV64.
+*
+* @return false if the file can not be created.
+***********************************************************************/
+bool trace_writer::open(const std::string &fname, uint64_t mem_size, uint32_t entry, bool compressed, bool is_rv64)
+{
+	out.open(fname, std::ios::out | std::ios::binary);
+	if(!out)
+	{
+		std::cerr << "Can\'t open file \'" << fname << "\' for writing.\n";
+		return false;
+	}
+
+	buffer.resize(buffer_size);
+	sent.reset(mem_size, UINT64_MAX);
+
+	for(char c : trace_magic)
+		put(c);
+	for(int i = 0; i < 8; ++i)
+		put(mem_size >> (8*i));
+	for(int i = 0; i < 4; ++i)
+		put(entry >> (8*i));
+	put((compressed ? trace_record::ext_compressed : 0) | (is_rv64 ? trace_record::ext_rv64 : 0));
+	rv64 = is_rv64;
+	return true;
+}
+
+/**
+* Appends the record of one instruction.
+*
+* @param pc is the address of the instruction.
+* @param insn is the instruction word (the 32 bits at pc, even for a
+* compressed instruction.)
+* @param fetched is false if insn could not be read (pc is out of the
+* memory), the renderer then reads it the same way the hart did.
+* @param load_addr is the address read by a load.
+* @param load_width is the number of bytes read by a load: 1, 2, 4 or 8,
+* or 0 if the instruction is not a load.
+* @param load are the bytes read by the load.
+* @param syscall tells that the instruction was an emulated ecall.
+* @param sys_ret is the result of that call, for replay().
+***********************************************************************/
+void trace_writer::record(uint32_t pc, uint32_t insn, bool fetched, uint64_t load_addr,
+	uint32_t load_width, const uint8_t *load, bool syscall, int64_t sys_ret)
+{
+	bool send = false;
+	if(fetched)
+	{
+		if((pc & 1) == 0)
+		{
+			uint64_t &s = sent.at(pc);
+			send = s != insn;
+			s = insn;
+		}
+		else
+			send = true;
+	}
+
+	uint8_t flags = send ? trace_record::has_insn : 0;
+	if(load_width)
+	{
+		uint8_t log2 = load_width == 8 ? 3 : load_width == 4 ? 2 : load_width == 2 ? 1 : 0;
+		flags |= trace_record::has_load | (log2 << trace_record::width_shift);
+	}
+	if(syscall)
+		flags |= trace_record::has_syscall;
+	put(flags);
+
+	if(send)
+	{
+		for(int i = 0; i < 4; ++i)
+			put(insn >> (8*i));
+	}
+
+	if(load_width)
+	{
+		uint64_t delta = load_addr - last_load;
+		uint64_t zz = (delta << 1) ^ (0ull - (delta >> 63));
+		while(zz >= 0x80)
+		{
+			put(zz | 0x80);
+			zz >>= 7;
+		}
+		put(zz);
+		last_load = load_addr;
+
+		for(uint32_t i = 0; i < load_width; ++i)
+			put(load[i]);
+	}
+
+	if(syscall)
+	{
+		for(int i = 0; i < (rv64 ? 8 : 4); ++i)
+			put((uint64_t)sys_ret >> (8*i));
+	}
+}
+
+/**
+* Appends the end record and writes out the buffer.
+*
+* @param insn_count is the number of instructions executed.
+*
+* @return false if the file could not be written.
+***********************************************************************/
+bool trace_writer::finish(uint64_t insn_count)
+{
+	put(trace_record::trace_end);
+	for(int i = 0; i < 8; ++i)
+		put(insn_count >> (8*i));
+	flush();
+	return bool(out);
+}
+
+/**
+* Writes out the buffer.
+***********************************************************************/
+void trace_writer::flush()
+{
+	out.write(reinterpret_cast<const char *>(buffer.data()), used);
+	used = 0;
+}
+
+/**
+* Opens a trace file and reads its header.
+*
+* @param fname is the name of the file.
+*
+* @return false if the file can not be read or is not a trace.
+***********************************************************************/
+bool trace_reader::open(const std::string &fname)
+{
+	in.open(fname, std::ios::in | std::ios::binary);
+	if(!in)
+	{
+		std::cerr << "Can\'t open file \'" << fname << "\' for reading.\n";
+		return false;
+	}
+	buffer.resize(buffer_size);
+
+	bool ok = true;
+	for(char c : trace_magic)
+	{
+		uint8_t b;
+		ok = ok && get(b) && b == (uint8_t)c;
+	}
+
+	uint64_t size, start;
+	uint8_t ext;
+	if(!ok || !get_le(size, 8) || !get_le(start, 4) || !get(ext))
+	{
+		std::cerr << "File \'" << fname << "\' is not an rv32i trace.\n";
+		return false;
+	}
+	mem_size = size;
+	entry = start;
+	compressed = ext & trace_record::ext_compressed;
+	rv64 = ext & trace_record::ext_rv64;
+	return true;
+}
+
+/**
+* Reads the next record.
+*
+* @param r is set to the record.
+*
+* @return false at the end of the file (a trace that ends without a
+* trace_end record was cut short.)
+***********************************************************************/
+bool trace_reader::next(trace_record &r)
+{
+	uint64_t v;
+
+	if(!get(r.flags))
+		return false;
+
+	if(r.flags & trace_record::trace_end)
+	{
+		if(!get_le(v, 8))
+			return false;
+		r.insn_count = v;
+		return true;
+	}
+
+	if(r.flags & trace_record::has_insn)
+	{
+		if(!get_le(v, 4))
+			return false;
+		r.insn = v;
+	}
+
+	r.load_width = 0;
+	if(r.flags & trace_record::has_load)
+	{
+		uint64_t zz = 0;
+		uint8_t b;
+		for(int shift = 0; ; shift += 7)
+		{
+			if(!get(b) || shift > 63)
+				return false;
+			zz |= (uint64_t)(b & 0x7f) << shift;
+			if(!(b & 0x80))
+				break;
+		}
+		last_load += (zz >> 1) ^ (0ull - (zz & 1));
+		r.load_addr = last_load;
+
+		r.load_width = 1 << ((r.flags >> trace_record::width_shift) & 3);
+		for(uint32_t i = 0; i < r.load_width; ++i)
+			if(!get(r.load[i]))
+				return false;
+	}
+
+	if(r.flags & trace_record::has_syscall)
+	{
+		if(!get_le(v, rv64 ? 8 : 4))
+			return false;
+		r.sys_ret = rv64 ? (int64_t)v : (int32_t)v;
+	}
+	return true;
+}
+
+/**
+* @return the size of the memory of the traced run.
+***********************************************************************/
+uint64_t trace_reader::get_mem_size() const
+{
+	return mem_size;
+}
+
+/**
+* @return the address the traced run started at.
+***********************************************************************/
+uint32_t trace_reader::get_entry() const
+{
+	return entry;
+}
+
+/**
+* @return true if the C extension was on in the traced run.
+***********************************************************************/
+bool trace_reader::is_compressed() const
+{
+	return compressed;
+}
+
+/**
+* @return true if the traced hart was RV64.
+***********************************************************************/
+bool trace_reader::is_rv64() const
+{
+	return rv64;
+}
+
+/**
+* Reads one byte, refilling the buffer when it is empty.
+*
+* @param b is set to the byte.
+*
+* @return false at the end of the file.
+***********************************************************************/
+bool trace_reader::get(uint8_t &b)
+{
+	if(used == avail)
+	{
+		in.read(reinterpret_cast<char *>(buffer.data()), buffer_size);
+		avail = in.gcount();
+		used = 0;
+		if(avail == 0)
+			return false;
+	}
+	b = buffer[used++];
+	return true;
+}
+
+/**
+* Reads a little-endian value.
+*
+* @param v is set to the value.
+* @param bytes is the size of the value.
+*
+* @return false at the end of the file.
+***********************************************************************/
+bool trace_reader::get_le(uint64_t &v, int bytes)
+{
+	v = 0;
+	for(int i = 0; i < bytes; ++i)
+	{
+		uint8_t b;
+		if(!get(b))
+			return false;
+		v |= (uint64_t)b << (8*i);
+	}
+	return true;
+}
@@ -0,0 +1,316 @@
+#ifndef trace_H
+#define trace_H
+
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "word_table.h"
+
+/*
+* The documentation of most of the functions is included in the .cpp file.
+*/
+
+/**
+* The binary execution trace written by rv32i -t and rendered back into
+* the text of -i by rv32i-trace. The renderer runs the instructions
+* again on a hart of its own, so a record only has to carry what that
+* hart can not know by itself:
+*	- the instruction word (32 bits even for a compressed one), the
+*	  first time an address is executed and whenever the word there
+*	  has changed since,
+*	- the bytes read by a load (the address as a zigzag varint delta
+*	  from the address of the previous load.)
+*	- the result of an emulated system call (4 bytes, 8 for RV64.)
+*	  What the call wrote into the memory comes with the loads that
+*	  read it.
+*
+* The file starts with an 8 byte magic, the memory size (8 bytes), the
+* entry point (4 bytes), all little-endian, and a byte of extension
+* flags. Each record starts with a flags byte. The last record is
+* trace_end, followed by the final instruction count (8 bytes.)
+***********************************************************************/
+struct trace_record
+{
+	static constexpr uint8_t has_insn = 0x01;	// insn follows
+	static constexpr uint8_t has_load = 0x02;	// load address and bytes follow
+	static constexpr uint8_t width_shift = 2;	// log2 of the load width in bits 2-3
+	static constexpr uint8_t has_syscall = 0x10;	// the result of an ecall follows
+	static constexpr uint8_t trace_end = 0x80;
+
+	static constexpr uint8_t ext_compressed = 0x01;	// header: the C extension is on
+	static constexpr uint8_t ext_rv64 = 0x02;	// header: the hart is RV64
+
+	uint8_t flags;
+	uint32_t insn;
+	uint64_t load_addr;
+	uint32_t load_width;
+	uint8_t load[8];		// the bytes read, in address order
+	int64_t sys_ret;		// with has_syscall
+	uint64_t insn_count;		// with trace_end
+};
+
+/**
+* Writes the binary trace through a large buffer.
+***********************************************************************/
+class trace_writer
+{
+public:
+	trace_writer()
+	{
+		used = 0;
+		last_load = 0;
+		rv64 = false;
+	}
+
+	~trace_writer();
+
+	bool open(const std::string &fname, uint64_t mem_size, uint32_t entry, bool compressed, bool is_rv64);
+	void record(uint32_t pc, uint32_t insn, bool fetched, uint64_t load_addr,
+		uint32_t load_width, const uint8_t *load, bool syscall, int64_t sys_ret);
+	bool finish(uint64_t insn_count);
+
+private:
+	void flush();
+
+	/**
+	* Appends one byte to the buffer.
+	***************************************************************/
+	void put(uint8_t b)
+	{
+		if(used == buffer_size)
+			flush();
+		buffer[used++] = b;
+	}
+
+	static constexpr size_t buffer_size = 1 << 20;
+
+	std::ofstream out;
+	std::vector<uint8_t> buffer;
+	size_t used;
+	uint64_t last_load;		// address of the previous load
+	bool rv64;			// sys_ret takes 8 bytes
+	word_table<uint64_t, 1> sent;	// last insn sent for each halfword, or more than 32 bits
+};
+
+/**
+* Reads the binary trace through a large buffer.
+***********************************************************************/
+class trace_reader
+{
+public:
+	trace_reader()
+	{
+		used = 0;
+		avail = 0;
+		last_load = 0;
+		mem_size = 0;
+		entry = 0;
+		compressed = false;
+		rv64 = false;
+	}
+
+	bool open(const std::string &fname);
+	bool next(trace_record &r);
+
+	uint64_t get_mem_size() const;
+	uint32_t get_entry() const;
+	bool is_compressed() const;
+	bool is_rv64() const;
+
+private:
+	bool get(uint8_t &b);
+	bool get_le(uint64_t &v, int bytes);
+
+	static constexpr size_t buffer_size = 1 << 20;
+
+	std::ifstream in;
+	std::vector<uint8_t> buffer;
+	size_t used;
+	size_t avail;
+	uint64_t last_load;
+	uint64_t mem_size;
+	uint32_t entry;
+	bool compressed;
+	bool rv64;
+};
+
+
+/**
+* A single-producer/single-consumer lock-free ring of trace records,
+* filled by the simulating thread through the same record() call as a
+* trace_writer and drained by the thread of an async_tracer. Each side
+* keeps a copy of the other side's index and only reads the shared one
+* again when its copy says the ring is full (or empty), so the
+* producer's cost per record is a store into the slot and a release
+* store of head. The producer only waits when the ring is full. A
+* consumer that finds the ring empty for a while parks in wait()
+* instead of spinning. The producer only looks for a parked consumer
+* (and takes the lock to wake it) at a trace_end record, which it
+* waits on, and when the ring is full, so a parked consumer takes the
+* records in one batch and the records in between cost nothing more.
+***********************************************************************/
+class trace_ring
+{
+public:
+	trace_ring() : slots(ring_size)
+	{
+		head = 0;
+		tail = 0;
+		head_seen = 0;
+		tail_seen = 0;
+		waiting = false;
+		woken = false;
+	}
+
+	/**
+	* Appends the record of one instruction, see trace_writer::record().
+	* The instruction word is always sent (when it was fetched), the
+	* consumer compares it with its own memory.
+	***************************************************************/
+	void record(uint32_t pc, uint32_t insn, bool fetched, uint64_t load_addr,
+		uint32_t load_width, const uint8_t *load, bool syscall, int64_t sys_ret)
+	{
+		(void)pc;
+		trace_record &r = claim();
+		r.flags = fetched ? trace_record::has_insn : 0;
+		if(syscall)
+			r.flags |= trace_record::has_syscall;
+		r.insn = insn;
+		r.sys_ret = sys_ret;
+		r.load_addr = load_addr;
+		r.load_width = load_width;
+		for(uint32_t i = 0; i < load_width; ++i)
+			r.load[i] = load[i];
+		publish();
+	}
+
+	/**
+	* Appends a trace_end record.
+	*
+	* @param insn_count is the number of instructions executed.
+	***************************************************************/
+	void record_end(uint64_t insn_count)
+	{
+		trace_record &r = claim();
+		r.flags = trace_record::trace_end;
+		r.insn_count = insn_count;
+		publish();
+		notify();
+	}
+
+	/**
+	* Takes the oldest record out of the ring.
+	*
+	* @param r is set to the record.
+	*
+	* @return false if the ring is empty.
+	***************************************************************/
+	bool pop(trace_record &r)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if(t == head_seen)
+		{
+			head_seen = head.load(std::memory_order_acquire);
+			if(t == head_seen)
+				return false;
+		}
+		r = slots[t & (ring_size - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	* Parks the consumer until a record is published or wake() is
+	* called. Returns at once if the ring is not empty.
+	***************************************************************/
+	void wait()
+	{
+		std::unique_lock<std::mutex> l(lock);
+		// the fence pairs with the one of notify(): either the
+		// consumer sees the record or the producer sees waiting
+		waiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		ready.wait(l, [this] {
+			return woken || head.load(std::memory_order_acquire) != tail.load(std::memory_order_relaxed);
+		});
+		waiting.store(false, std::memory_order_relaxed);
+		woken = false;
+	}
+
+	/**
+	* Wakes the consumer if it is parked in wait(), or makes its next
+	* wait() return at once.
+	***************************************************************/
+	void wake()
+	{
+		{
+			std::lock_guard<std::mutex> l(lock);
+			woken = true;
+		}
+		ready.notify_one();
+	}
+
+private:
+	/**
+	* @return the slot to fill next, once there is one.
+	***************************************************************/
+	trace_record &claim()
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		while(h - tail_seen == ring_size)
+		{
+			tail_seen = tail.load(std::memory_order_acquire);
+			if(h - tail_seen == ring_size)
+			{
+				notify();
+				std::this_thread::yield();
+			}
+		}
+		return slots[h & (ring_size - 1)];
+	}
+
+	/**
+	* Hands the slot filled after claim() to the consumer.
+	***************************************************************/
+	void publish()
+	{
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/**
+	* Wakes the consumer if it is parked in wait(), now that there are
+	* records it has not seen.
+	***************************************************************/
+	void notify()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(waiting.load(std::memory_order_relaxed))
+			wake();
+	}
+
+	static constexpr size_t ring_size = 1 << 16;	// a power of two
+	static constexpr size_t line_size = 64;
+
+	std::vector<trace_record> slots;
+
+	// the indexes only grow, each side on a cache line of its own
+	char pad0[line_size];
+	std::atomic<size_t> head;	// next slot to fill, written by the producer
+	size_t tail_seen;		// producer's copy of tail
+	char pad1[line_size];
+	std::atomic<size_t> tail;	// next slot to take, written by the consumer
+	size_t head_seen;		// consumer's copy of head
+	char pad2[line_size];
+	std::atomic<bool> waiting;	// the consumer is parked in wait()
+	char pad3[line_size];
+	std::mutex lock;
+	std::condition_variable ready;
+	bool woken;			// wake() was called, under lock
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef word_table_H
+#define word_table_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+/**
+* A table holding one T for every 4-byte word of the simulated memory
+* (or every halfword, with granule_bits 1.) It is split into chunks
+* covering one 4 KiB page of memory each. A chunk is only allocated
+* (and filled with the initial value) the first time one of its
+* entries is asked for with at(), so that a sparse 4 GiB memory does
+* not need a table for all of its words.
+*
+* The chunk pointers are calloc()ed, so that for a big memory the host
+* only backs the parts of the pointer array that are actually used.
+*
+* The addresses given to find() and at() must be inside the size given
+* to reset().
+***********************************************************************/
+template<typename T, uint32_t granule_bits = 2>
+class word_table
+{
+public:
+	static constexpr uint32_t page_bits = 12;
+	static constexpr uint32_t entries_per_page = 1 << (page_bits - granule_bits);
+
+	word_table()
+	{
+		pages = nullptr;
+		npages = 0;
+	}
+
+	/**
+	* Frees all the chunks.
+	***************************************************************/
+	~word_table()
+	{
+		clear();
+	}
+
+	/**
+	* Frees all the chunks and makes the table cover mem_size bytes.
+	*
+	* @param mem_size is the size of the memory in bytes
+	*
+	* @param initial is the value of the entries of new chunks
+	***************************************************************/
+	void reset(uint64_t mem_size, const T &initial)
+	{
+		clear();
+		npages = (mem_size + (1u << page_bits) - 1) >> page_bits;
+		pages = static_cast<T **>(calloc(npages ? npages : 1, sizeof(T *)));
+		if(!pages)
+			throw std::bad_alloc();
+		fill = initial;
+	}
+
+	/**
+	* @param addr is an address in the word
+	*
+	* @return the entry of the word, or nullptr if its chunk has not
+	* been allocated.
+	***************************************************************/
+	T *find(uint32_t addr) const
+	{
+		T *p = pages[addr >> page_bits];
+		return p ? &p[(addr >> granule_bits) & (entries_per_page - 1)] : nullptr;
+	}
+
+	/**
+	* @param addr is an address in the word
+	*
+	* @return the entry of the word, allocating its chunk if needed.
+	***************************************************************/
+	T &at(uint32_t addr)
+	{
+		T *&p = pages[addr >> page_bits];
+		if(!p)
+		{
+			p = new T[entries_per_page];
+			for(uint32_t i = 0; i < entries_per_page; ++i)
+				p[i] = fill;
+		}
+		return p[(addr >> granule_bits) & (entries_per_page - 1)];
+	}
+
+private:
+	word_table(const word_table &) = delete;
+	word_table &operator=(const word_table &) = delete;
+
+	/**
+	* Frees all the chunks.
+	***************************************************************/
+	void clear()
+	{
+		for(size_t i = 0; i < npages; ++i)
+			delete[] pages[i];
+		free(pages);
+		pages = nullptr;
+		npages = 0;
+	}
+
+	T **pages;			// one chunk pointer per 4 KiB page
+	size_t npages;
+	T fill;
+};
+
+#endif